@@ -5,88 +5,184 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "cJSON.h"
+#include "binlog.h"
 #include "thread_utils.h"
+#include "thread_cmd.h"
 #include "actuator_utils.h"
+#include "crc_utils.h"
+#include "frame_codec.h"
 
 static const char *TAG = "actuator_node";
 
+// Status codes returned to the hub in the command ACK
+#define CMD_STATUS_OK           0
+#define CMD_STATUS_BAD_REQUEST  1
+#define CMD_STATUS_SUPERSEDED   2   // a newer command took over its servos
+#define CMD_STATUS_BUSY         3   // servo queue full
+#define CMD_STATUS_RELAY_FAULT  4   // a relay pin did not read back as set
+
+// Multicast groups this node answers to (thread_cmd group commands), e.g.
+// every blind in the house; must match the hub's group table
+static const uint16_t s_groups[] = { 1 };
+
+/**
+ * @brief Command whose ACK waits for its servo moves to finish. Only one
+ *        at a time: a new command with servo moves supersedes it.
+ */
+typedef struct {
+    bool     active;
+    uint16_t src_id;
+    uint16_t group;
+    uint8_t  seq;
+    uint8_t  moves_left;
+    uint8_t  status;
+    uint32_t gen;           ///< Tags the servo callbacks of this command
+} pending_cmd_t;
+
+static pending_cmd_t s_pending;
+static uint32_t      s_pending_gen;     // OpenThread task only
+static portMUX_TYPE  s_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Account for one finished move of pending command @p gen, or for
+ *        all of them if @p whole is set, and send the ACK once none is left.
+ *        A non-OK @p status becomes the command's final status.
+ */
+static void pending_finish(uint32_t gen, uint8_t status, bool whole)
+{
+    pending_cmd_t done;
+    bool finish = false;
+
+    taskENTER_CRITICAL(&s_pending_lock);
+    if (s_pending.active && s_pending.gen == gen) {
+        if (status != CMD_STATUS_OK) {
+            s_pending.status = status;
+        }
+        if (whole || --s_pending.moves_left == 0) {
+            s_pending.active = false;
+            done = s_pending;
+            finish = true;
+        }
+    }
+    taskEXIT_CRITICAL(&s_pending_lock);
+
+    // Sent outside the spinlock: thread_send() takes the OpenThread lock
+    if (finish) {
+        thread_cmd_complete(done.src_id, done.group, done.seq, done.status);
+    }
+}
+
+/**
+ * @brief Servo completion; runs on the servo task.
+ */
+static void on_servo_done(uint8_t servo, bool reached, void *arg)
+{
+    BINLOG_I(TAG, "Servo %u %s", servo, reached ? "reached target" : "redirected");
+    pending_finish((uint32_t)(uintptr_t)arg, CMD_STATUS_OK, false);
+}
+
+/**
+ * @brief Apply one actuator command: every relay and servo it names is
+ *        switched together. Called by the command transport once per
+ *        command; retransmissions are answered without calling it again.
+ *
+ * Relays switch at once. Servo moves run in the background and the ACK is
+ * deferred until the last of them has finished.
+ *
+ * @param src_id   Thread node ID of the sender (hub)
+ * @param group    Multicast group the command was sent to, 0 for unicast
+ * @param seq      Command sequence number
+ * @param payload  Encoded actuator_cmd_t
+ * @param length   Payload bytes
+ * @return Status code for the ACK, or THREAD_CMD_STATUS_PENDING
+ */
+static uint8_t handle_command(uint16_t src_id, uint16_t group, uint8_t seq,
+                              const uint8_t *payload, size_t length)
+{
+    actuator_cmd_t cmd;
+    if (!actuator_cmd_decode(payload, length, &cmd)) {
+        ESP_LOGW(TAG, "Malformed command from node %u", src_id);
+        return CMD_STATUS_BAD_REQUEST;
+    }
+
+    // Validate the whole batch first, so it is applied all or nothing
+    if ((cmd.relay_mask >> ACTUATOR_RELAY_COUNT) || (cmd.servo_mask >> ACTUATOR_SERVO_COUNT)) {
+        ESP_LOGW(TAG, "Command names missing outputs (relays 0x%02X, servos 0x%02X)",
+                 cmd.relay_mask, cmd.servo_mask);
+        return CMD_STATUS_BAD_REQUEST;
+    }
+
+    BINLOG_I(TAG, "Command from node %u: relays 0x%02X=0x%02X, servos 0x%02X",
+             src_id, cmd.relay_mask, cmd.relay_values, cmd.servo_mask);
+    uint8_t relay_status = CMD_STATUS_OK;
+    if (cmd.relay_mask) {
+        relay_set_mask(cmd.relay_mask, cmd.relay_values);
+        // Relays still waiting for their staggered switch-on are off for
+        // now; only the outputs already driven can be checked
+        uint32_t pending = relay_get_pending_mask();
+        uint32_t actual = relay_get_mask() & cmd.relay_mask & ~pending;
+        uint32_t expected = cmd.relay_values & cmd.relay_mask & ~pending;
+        if (actual != expected) {
+            ESP_LOGE(TAG, "Relay readback 0x%02lX, expected 0x%02lX",
+                     (unsigned long)actual, (unsigned long)expected);
+            relay_status = CMD_STATUS_RELAY_FAULT;
+        }
+    }
+    if (!cmd.servo_mask) {
+        return relay_status;
+    }
+
+    // The previous command loses its servos to this one
+    pending_finish(s_pending_gen, CMD_STATUS_SUPERSEDED, true);
+
+    uint8_t moves = 0;
+    for (int i = 0; i < ACTUATOR_SERVO_COUNT; i++) {
+        moves += (cmd.servo_mask >> i) & 1u;
+    }
+    uint32_t gen = ++s_pending_gen;
+    taskENTER_CRITICAL(&s_pending_lock);
+    s_pending = (pending_cmd_t){
+        .active = true, .src_id = src_id, .group = group, .seq = seq,
+        .moves_left = moves, .status = relay_status, .gen = gen,
+    };
+    taskEXIT_CRITICAL(&s_pending_lock);
+
+    for (int i = 0; i < ACTUATOR_SERVO_COUNT; i++) {
+        if ((cmd.servo_mask & (1u << i))
+            && servo_move(i, cmd.servo_angle[i], on_servo_done, (void *)(uintptr_t)gen) != ESP_OK) {
+            pending_finish(gen, CMD_STATUS_BUSY, false);
+        }
+    }
+    return THREAD_CMD_STATUS_PENDING;
+}
+
 /**
  * @brief Callback invoked when a Thread packet arrives.
  *
- * @param data    Pointer to buffer containing JSON command + CRC8
- * @param length  Total length of buffer (including CRC byte)
- * @param src_id  Thread node ID of the sender (hub)
+ * @param buf  Borrowed receive buffer: command frame + CRC8, sent by the hub
  */
-static void thread_receive_callback(const uint8_t *data, size_t length, uint16_t src_id)
+static void thread_receive_callback(thread_buf_t *buf)
 {
-    ESP_LOGI(TAG, "Thread RX from node %u, length=%u", src_id, length);
+    BINLOG_I(TAG, "Thread RX from node %u, length=%u", buf->src_id, buf->length);
 
     // 1. Validate packet length (must contain at least 1-byte payload + 1-byte CRC)
-    if (length < 2) {
+    if (buf->length < 2) {
         ESP_LOGW(TAG, "Packet too short, dropping");
         return;
     }
 
     // 2. Verify CRC8
-    uint8_t received_crc = data[length - 1];
-    uint8_t computed_crc = compute_crc8(data, length - 1);
+    uint8_t received_crc = buf->data[buf->length - 1];
+    uint8_t computed_crc = compute_crc8(buf->data, buf->length - 1);
     if (received_crc != computed_crc) {
         ESP_LOGW(TAG, "CRC mismatch: got 0x%02X expected 0x%02X", received_crc, computed_crc);
         return;
     }
 
-    // 3. Extract JSON payload (exclude CRC byte)
-    size_t json_len = length - 1;
-    char json_str[256];
-    if (json_len >= sizeof(json_str)) {
-        json_len = sizeof(json_str) - 1;
-    }
-    memcpy(json_str, data, json_len);
-    json_str[json_len] = '\0';
-    ESP_LOGI(TAG, "Command JSON: %s", json_str);
-
-    // 4. Parse JSON for relay command
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root) {
-        ESP_LOGW(TAG, "JSON parse error");
-        return;
-    }
-    cJSON *relay = cJSON_GetObjectItem(root, "relay");
-    cJSON *state = cJSON_GetObjectItem(root, "state");
-    if (!cJSON_IsNumber(relay) || !cJSON_IsNumber(state)) {
-        ESP_LOGW(TAG, "Invalid JSON format");
-        cJSON_Delete(root);
-        return;
-    }
-    uint8_t relay_id    = (uint8_t)relay->valueint;
-    uint8_t relay_state = (uint8_t)state->valueint;
-    cJSON_Delete(root);
-
-    // 5. Execute relay action
-    if (relay_state) {
-        relay_on(relay_id);
-        ESP_LOGI(TAG, "Relay %u → ON", relay_id);
-    } else {
-        relay_off(relay_id);
-        ESP_LOGI(TAG, "Relay %u → OFF", relay_id);
-    }
-
-    // 6. Send ACK back to the hub: { "status": 0 }
-    cJSON *ack = cJSON_CreateObject();
-    cJSON_AddNumberToObject(ack, "status", 0);
-    char *ack_str = cJSON_PrintUnformatted(ack);
-    cJSON_Delete(ack);
-    if (ack_str) {
-        size_t ack_len = strlen(ack_str);
-        uint8_t buf[128];
-        if (ack_len + 1 <= sizeof(buf)) {
-            memcpy(buf, ack_str, ack_len);
-            buf[ack_len] = compute_crc8(buf, ack_len);
-            thread_send(buf, ack_len + 1, src_id);
-            ESP_LOGI(TAG, "ACK sent to node %u", src_id);
-        }
-        cJSON_free(ack_str);
+    // 3. The command transport deduplicates, runs handle_command() and
+    //    sends the ACK
+    if (!thread_cmd_handle_rx(buf->src_id, buf->data, buf->length - 1)) {
+        ESP_LOGW(TAG, "Unexpected frame type 0x%02X from node %u", buf->data[0], buf->src_id);
     }
 }
 
@@ -94,18 +190,24 @@ void app_main(void)
 {
     ESP_LOGI(TAG, "Starting actuator node (ESP32-H2)");
 
+    // Hot-path logs are queued as binary records and printed by this task
+    ESP_ERROR_CHECK(binlog_start());
+
     // Initialize Thread stack
     ESP_ERROR_CHECK(thread_init());
 
     // Initialize actuators (GPIOs, PWM, etc.)
     actuator_init();
 
-    // Register callback for incoming Thread commands
+    // Register callback for incoming Thread commands, sent to this node
+    // or to one of its groups
+    ESP_ERROR_CHECK(thread_cmd_init(NULL, handle_command));
+    for (size_t i = 0; i < sizeof(s_groups) / sizeof(s_groups[0]); i++) {
+        thread_group_join(s_groups[i]);
+    }
     thread_register_receive_cb(thread_receive_callback);
 
-    // Main loop: process Thread events
-    while (true) {
-        thread_process();
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
+    // Process Thread events on the OpenThread mainloop task; commands are
+    // handled as soon as the radio delivers them
+    ESP_ERROR_CHECK(thread_start_mainloop());
 }
\ No newline at end of file
@@ -2,115 +2,523 @@
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
 
 static const char *TAG = "actuator_utils";
 
-// GPIO для реле
-#define RELAY_GPIO_1    5
-#define RELAY_GPIO_2    18
+/*
+ * Опис каналу реле. Усі виводи мають бути < 32: банк перемикається
+ * записом одного 32-бітного регістра GPIO_OUT
+ */
+typedef struct {
+    gpio_num_t gpio;
+    bool       active_low;      // модуль реле вмикається низьким рівнем
+} relay_desc_t;
+
+// Таблиця реле: індекс n - реле n+1
+static const relay_desc_t s_relays[ACTUATOR_RELAY_COUNT] = {
+    { .gpio = 5,  .active_low = false },
+    { .gpio = 18, .active_low = false },
+};
+
+#define RELAY_ALL_MASK  ((uint32_t)((1ULL << ACTUATOR_RELAY_COUNT) - 1))
+
+static uint32_t     s_relay_pins;           // маска виводів усіх реле в GPIO_OUT
+static uint32_t     s_relay_inverted;       // виводи з active_low
+static uint16_t     s_relay_stagger_ms;
+static portMUX_TYPE s_relay_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     s_stagger_pending;      // виводи, що ще чекають вмикання (під s_relay_lock)
+static esp_timer_handle_t s_stagger_timer;
 
 // Параметри для PWM-сервоприводів (LEDC)
 #define SERVO_LEDC_TIMER      LEDC_TIMER_0
 #define SERVO_LEDC_MODE       LEDC_LOW_SPEED_MODE
-#define SERVO_LEDC_CHANNEL    LEDC_CHANNEL_0
-#define SERVO_LEDC_GPIO       19
 #define SERVO_FREQ_HZ         50     // Частота 50 Hz
-#define SERVO_DUTY_MIN        40     // Мінімальний duty (1 ms)
-#define SERVO_DUTY_MAX        115    // Максимальний duty (2.5 ms)
+#define SERVO_PERIOD_US       (1000000 / SERVO_FREQ_HZ)
+#define SERVO_DUTY_BITS       14     // 16384 відліків на період, ~0.15° на відлік
+#define SERVO_PULSE_MIN_US    1000   // 0°
+#define SERVO_PULSE_MAX_US    2500   // 180°
+#define SERVO_US_TO_DUTY(us)  ((uint32_t)(((uint64_t)(us) << SERVO_DUTY_BITS) / SERVO_PERIOD_US))
+#define SERVO_DUTY_MIN        SERVO_US_TO_DUTY(SERVO_PULSE_MIN_US)
+#define SERVO_DUTY_MAX        SERVO_US_TO_DUTY(SERVO_PULSE_MAX_US)
+
+// Траєкторія: не більше SERVO_SEGMENTS_MAX лінійних fade-відрізків,
+// кожен не коротший за SERVO_SEGMENT_MIN_MS
+#define SERVO_SEGMENTS_MAX    8
+#define SERVO_SEGMENT_MIN_MS  40
+#define SERVO_QUEUE_LEN       8
+#define SERVO_TASK_STACK      3072
+#define SERVO_TASK_PRIORITY   4
+
+/*
+ * Стан одного сервопривода. Поля руху змінює лише завдання сервоприводів
+ */
+typedef struct {
+    gpio_num_t      gpio;
+    ledc_channel_t  channel;
+    uint16_t        speed_dps;
+    uint16_t        accel_dps2;
+    volatile bool   moving;
+    uint32_t        duty;           // duty у кінці поточного відрізка (або в спокої)
+    // План поточного руху: трапеція швидкості у відліках duty
+    uint32_t        from_duty;
+    uint32_t        dist;           // шлях у відліках, знак - у dir
+    int8_t          dir;
+    uint32_t        accel;          // відліків/с²
+    uint32_t        vpeak;          // відліків/с
+    uint32_t        t_acc_ms;
+    uint32_t        total_ms;
+    uint8_t         seg;
+    uint8_t         seg_count;
+    int64_t         start_us;
+    int64_t         seg_end_us;
+    servo_done_cb_t cb;
+    void           *arg;
+} servo_t;
+
+/*
+ * Запит руху, що передається завданню сервоприводів
+ */
+typedef struct {
+    uint8_t         servo;
+    uint8_t         angle;
+    servo_done_cb_t cb;
+    void           *arg;
+} servo_req_t;
+
+static servo_t s_servos[ACTUATOR_SERVO_COUNT] = {
+    { .gpio = 19, .channel = LEDC_CHANNEL_0 },
+    { .gpio = 4,  .channel = LEDC_CHANNEL_1 },
+};
+static QueueHandle_t s_servo_queue;
+
+static void servo_task(void *arg);
+static void relay_stagger_cb(void *arg);
 
 /*
  * Ініціалізує GPIO для керування реле та PWM для сервопривода
  */
 void actuator_init(void) {
-    // 1. Конфігурація реле
+    // 1. Конфігурація реле: вихід із читанням назад, спершу всі вимкнені
+    for (int i = 0; i < ACTUATOR_RELAY_COUNT; i++) {
+        if (s_relays[i].gpio >= 32) {
+            ESP_LOGE(TAG, "Реле %d: GPIO%d поза регістром GPIO_OUT", i + 1, s_relays[i].gpio);
+            continue;
+        }
+        s_relay_pins |= 1u << s_relays[i].gpio;
+        if (s_relays[i].active_low) {
+            s_relay_inverted |= 1u << s_relays[i].gpio;
+        }
+    }
+    REG_WRITE(GPIO_OUT_W1TC_REG, s_relay_pins & ~s_relay_inverted);
+    REG_WRITE(GPIO_OUT_W1TS_REG, s_relay_inverted);
     gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << RELAY_GPIO_1) | (1ULL << RELAY_GPIO_2),
-        .mode = GPIO_MODE_OUTPUT,
+        .pin_bit_mask = s_relay_pins,
+        .mode = GPIO_MODE_INPUT_OUTPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE
     };
     gpio_config(&io_conf);
-    gpio_set_level(RELAY_GPIO_1, 0);
-    gpio_set_level(RELAY_GPIO_2, 0);
+    esp_timer_create_args_t stagger_args = {
+        .callback = relay_stagger_cb,
+        .name     = "relay_stagger",
+    };
+    esp_timer_create(&stagger_args, &s_stagger_timer);
 
-    // 2. Налаштування LEDC для серво
+    // 2. Налаштування LEDC для серво: 14 біт замість 8 і апаратний fade
     ledc_timer_config_t ledc_timer = {
         .speed_mode = SERVO_LEDC_MODE,
         .timer_num = SERVO_LEDC_TIMER,
-        .duty_resolution = LEDC_TIMER_8_BIT,
+        .duty_resolution = SERVO_DUTY_BITS,
         .freq_hz = SERVO_FREQ_HZ,
         .clk_cfg = LEDC_AUTO_CLK
     };
     ledc_timer_config(&ledc_timer);
 
-    ledc_channel_config_t ledc_channel = {
-        .speed_mode = SERVO_LEDC_MODE,
-        .channel = SERVO_LEDC_CHANNEL,
-        .timer_sel = SERVO_LEDC_TIMER,
-        .intr_type = LEDC_INTR_DISABLE,
-        .gpio_num = SERVO_LEDC_GPIO,
-        .duty = 0,
-        .hpoint = 0
-    };
-    ledc_channel_config(&ledc_channel);
+    for (int i = 0; i < ACTUATOR_SERVO_COUNT; i++) {
+        ledc_channel_config_t ledc_channel = {
+            .speed_mode = SERVO_LEDC_MODE,
+            .channel = s_servos[i].channel,
+            .timer_sel = SERVO_LEDC_TIMER,
+            .intr_type = LEDC_INTR_DISABLE,
+            .gpio_num = s_servos[i].gpio,
+            .duty = 0,
+            .hpoint = 0
+        };
+        ledc_channel_config(&ledc_channel);
+        s_servos[i].speed_dps = SERVO_SPEED_DPS_DEFAULT;
+        s_servos[i].accel_dps2 = SERVO_ACCEL_DPS2_DEFAULT;
+    }
+    ledc_fade_func_install(0);
+
+    s_servo_queue = xQueueCreate(SERVO_QUEUE_LEN, sizeof(servo_req_t));
+    xTaskCreate(servo_task, "servo", SERVO_TASK_STACK, NULL, SERVO_TASK_PRIORITY, NULL);
 
     ESP_LOGI(TAG, "Актуатори ініціалізовані");
 }
 
 /*
- * relay_on: вмикає реле на заданому каналі (1 або 2)
+ * relay_on: вмикає реле на заданому каналі (1..ACTUATOR_RELAY_COUNT)
  */
 void relay_on(uint8_t channel) {
-    if (channel == 1) {
-        gpio_set_level(RELAY_GPIO_1, 1);
-        ESP_LOGI(TAG, "Реле 1 увімкнено");
-    } else if (channel == 2) {
-        gpio_set_level(RELAY_GPIO_2, 1);
-        ESP_LOGI(TAG, "Реле 2 увімкнено");
+    if (channel >= 1 && channel <= ACTUATOR_RELAY_COUNT) {
+        relay_set_mask(1u << (channel - 1), RELAY_ALL_MASK);
     }
 }
 
 /*
- * relay_off: вимикає реле на каналі (1 або 2)
+ * relay_off: вимикає реле на каналі (1..ACTUATOR_RELAY_COUNT)
  */
 void relay_off(uint8_t channel) {
-    if (channel == 1) {
-        gpio_set_level(RELAY_GPIO_1, 0);
-        ESP_LOGI(TAG, "Реле 1 вимкнено");
-    } else if (channel == 2) {
-        gpio_set_level(RELAY_GPIO_2, 0);
-        ESP_LOGI(TAG, "Реле 2 вимкнено");
+    if (channel >= 1 && channel <= ACTUATOR_RELAY_COUNT) {
+        relay_set_mask(1u << (channel - 1), 0);
     }
 }
 
 /*
- * servo_set_angle: встановлює кут сервопривода (0..180)
+ * Переводить біти реле у біти виводів GPIO_OUT
  */
-void servo_set_angle(uint8_t angle) {
+static uint32_t relay_to_pins(uint32_t relays) {
+    uint32_t pins = 0;
+    for (int i = 0; i < ACTUATOR_RELAY_COUNT; i++) {
+        // Реле поза GPIO_OUT пропущені ще в actuator_init; зсув на >= 32 - UB
+        if ((relays & (1u << i)) && s_relays[i].gpio < 32) {
+            pins |= 1u << s_relays[i].gpio;
+        }
+    }
+    return pins & s_relay_pins;
+}
+
+/*
+ * Записує рівні виводів pins (логічні стани з on, до інверсії) одним
+ * read-modify-write регістра GPIO_OUT. Спінлок не дає перерванню чи іншому
+ * ядру вклинитися між читанням і записом
+ */
+static void relay_write_pins_locked(uint32_t pins, uint32_t on) {
+    uint32_t levels = (on ^ s_relay_inverted) & pins;
+    uint32_t out = REG_READ(GPIO_OUT_REG);
+    REG_WRITE(GPIO_OUT_REG, (out & ~pins) | levels);
+}
+
+/*
+ * Запускає таймер наступного відкладеного вмикання. ESP_ERR_INVALID_STATE
+ * означає, що його щойно перезапустив зворотний виклик - строк той самий
+ */
+static void relay_stagger_arm(void) {
+    esp_err_t err = esp_timer_start_once(s_stagger_timer, (uint64_t)s_relay_stagger_ms * 1000);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Таймер вмикання реле: %s", esp_err_to_name(err));
+    }
+}
+
+/*
+ * Наступне відкладене вмикання (завдання esp_timer). Таймер одноразовий
+ * і перезапускається, доки є виводи в черзі
+ */
+static void relay_stagger_cb(void *arg) {
+    taskENTER_CRITICAL(&s_relay_lock);
+    uint32_t pin = s_stagger_pending & (~s_stagger_pending + 1);
+    if (pin) {
+        relay_write_pins_locked(pin, pin);
+        s_stagger_pending &= ~pin;
+    }
+    bool more = s_stagger_pending != 0;
+    taskEXIT_CRITICAL(&s_relay_lock);
+    if (more) {
+        relay_stagger_arm();
+    }
+}
+
+/*
+ * relay_set_mask: виставляє рівні всіх реле з маски одним записом регістра.
+ * Із затримкою вмикань перше нове вмикання відбувається одразу, решта -
+ * з таймера, тож викликач (зокрема завдання OpenThread) не блокується
+ */
+void relay_set_mask(uint32_t mask, uint32_t values) {
+    mask &= RELAY_ALL_MASK;
+    uint32_t pins = relay_to_pins(mask);
+    uint32_t on = relay_to_pins(mask & values);
+
+    taskENTER_CRITICAL(&s_relay_lock);
+    // Нова команда скасовує відкладені вмикання своїх реле
+    bool was_pending = s_stagger_pending != 0;
+    bool armed = (s_stagger_pending & ~pins) != 0;
+    s_stagger_pending &= ~pins;
+    // Виводи, що зараз вимкнені і мають увімкнутися
+    uint32_t rising = on & ~(REG_READ(GPIO_OUT_REG) ^ s_relay_inverted);
+    if (s_relay_stagger_ms == 0 || (rising & (rising - 1)) == 0) {
+        relay_write_pins_locked(pins, on);
+        rising = 0;
+    } else {
+        // Разом усе, крім нових вмикань, і перше з них; решта - у чергу
+        uint32_t first = rising & (~rising + 1);
+        relay_write_pins_locked(pins, (on & ~rising) | first);
+        rising &= ~first;
+        s_stagger_pending |= rising;
+    }
+    taskEXIT_CRITICAL(&s_relay_lock);
+    if (was_pending && !armed) {
+        // Скасовано все відкладене: старий строк таймера більше не діє
+        esp_timer_stop(s_stagger_timer);
+    }
+    if (rising && !armed) {
+        relay_stagger_arm();
+    }
+    ESP_LOGI(TAG, "Реле: маска 0x%02lX, стани 0x%02lX",
+             (unsigned long)mask, (unsigned long)(values & mask));
+}
+
+/*
+ * relay_set_stagger: затримка між вмиканнями реле (мс)
+ */
+void relay_set_stagger(uint16_t ms) {
+    s_relay_stagger_ms = ms;
+}
+
+/*
+ * relay_get_mask: читає рівні виводів реле з GPIO_IN
+ */
+uint32_t relay_get_mask(void) {
+    uint32_t levels = (REG_READ(GPIO_IN_REG) ^ s_relay_inverted) & s_relay_pins;
+    uint32_t relays = 0;
+    for (int i = 0; i < ACTUATOR_RELAY_COUNT; i++) {
+        if (s_relays[i].gpio < 32 && (levels & (1u << s_relays[i].gpio))) {
+            relays |= 1u << i;
+        }
+    }
+    return relays;
+}
+
+/*
+ * relay_get_pending_mask: реле з черги відкладених вмикань
+ */
+uint32_t relay_get_pending_mask(void) {
+    taskENTER_CRITICAL(&s_relay_lock);
+    uint32_t pending = s_stagger_pending;
+    taskEXIT_CRITICAL(&s_relay_lock);
+    uint32_t relays = 0;
+    for (int i = 0; i < ACTUATOR_RELAY_COUNT; i++) {
+        if (s_relays[i].gpio < 32 && (pending & (1u << s_relays[i].gpio))) {
+            relays |= 1u << i;
+        }
+    }
+    return relays;
+}
+
+/*
+ * Цілий квадратний корінь (метод Ньютона)
+ */
+static uint32_t isqrt64(uint64_t v) {
+    if (v < 2) return (uint32_t)v;
+    uint64_t x = v, y = (x + 1) / 2;
+    while (y < x) {
+        x = y;
+        y = (x + v / x) / 2;
+    }
+    return (uint32_t)x;
+}
+
+static uint32_t servo_angle_to_duty(uint8_t angle) {
     if (angle > 180) angle = 180;
-    // Переводимо кут у duty
-    uint32_t duty = ((angle * (SERVO_DUTY_MAX - SERVO_DUTY_MIN)) / 180) + SERVO_DUTY_MIN;
-    ledc_set_duty(SERVO_LEDC_MODE, SERVO_LEDC_CHANNEL, duty);
-    ledc_update_duty(SERVO_LEDC_MODE, SERVO_LEDC_CHANNEL);
-    ESP_LOGI(TAG, "Сервопривід: кут=%d°, duty=%d", angle, duty);
+    return SERVO_DUTY_MIN + (uint32_t)angle * (SERVO_DUTY_MAX - SERVO_DUTY_MIN) / 180;
+}
+
+/*
+ * Пройдений шлях (у відліках) через t_ms від початку руху за трапецією
+ * швидкості: розгін з accel, рух з vpeak, гальмування з accel
+ */
+static uint32_t servo_profile_pos(const servo_t *s, uint32_t t_ms) {
+    if (t_ms >= s->total_ms) {
+        return s->dist;
+    }
+    uint32_t d_acc = (uint32_t)((uint64_t)s->accel * s->t_acc_ms * s->t_acc_ms / 2000000);
+    if (t_ms <= s->t_acc_ms) {
+        return (uint32_t)((uint64_t)s->accel * t_ms * t_ms / 2000000);
+    }
+    uint32_t t_dec = s->total_ms - s->t_acc_ms;
+    if (t_ms <= t_dec) {
+        return d_acc + (uint32_t)((uint64_t)s->vpeak * (t_ms - s->t_acc_ms) / 1000);
+    }
+    uint32_t left = s->total_ms - t_ms;
+    uint32_t tail = (uint32_t)((uint64_t)s->accel * left * left / 2000000);
+    return tail < s->dist ? s->dist - tail : 0;
+}
+
+/*
+ * Планує рух від поточного duty до target: трапеція або трикутник,
+ * якщо шлях закороткий для розгону до максимальної швидкості
+ */
+static void servo_plan(servo_t *s, uint32_t target) {
+    const uint32_t range = SERVO_DUTY_MAX - SERVO_DUTY_MIN;
+    uint32_t v = s->speed_dps * range / 180;
+    uint32_t a = s->accel_dps2 * range / 180;
+    if (v == 0) v = 1;
+    if (a == 0) a = 1;
+
+    s->from_duty = s->duty;
+    s->dir = target >= s->duty ? 1 : -1;
+    s->dist = s->dir > 0 ? target - s->duty : s->duty - target;
+    s->accel = a;
+
+    uint64_t d_acc = (uint64_t)v * v / (2 * a);
+    uint32_t t_cruise_ms;
+    if (2 * d_acc >= s->dist) {
+        s->t_acc_ms = isqrt64((uint64_t)s->dist * 1000000 / a);
+        s->vpeak = (uint32_t)((uint64_t)a * s->t_acc_ms / 1000);
+        t_cruise_ms = 0;
+    } else {
+        s->t_acc_ms = v * 1000 / a;
+        s->vpeak = v;
+        t_cruise_ms = (uint32_t)((s->dist - 2 * d_acc) * 1000 / v);
+    }
+    s->total_ms = 2 * s->t_acc_ms + t_cruise_ms;
+
+    uint32_t segs = s->total_ms / SERVO_SEGMENT_MIN_MS;
+    s->seg_count = segs < 1 ? 1 : segs > SERVO_SEGMENTS_MAX ? SERVO_SEGMENTS_MAX : (uint8_t)segs;
+    s->seg = 0;
+}
+
+/*
+ * Запускає апаратний fade наступного відрізка. Якщо попередній fade ще
+ * не закінчився, драйвер LEDC дочекається його кінця, тож відрізки
+ * стикуються без зупинок
+ */
+static void servo_start_segment(servo_t *s) {
+    uint32_t t_prev = s->total_ms * s->seg / s->seg_count;
+    uint32_t t_next = s->total_ms * (s->seg + 1) / s->seg_count;
+    uint32_t pos = servo_profile_pos(s, t_next);
+    uint32_t duty = s->dir > 0 ? s->from_duty + pos : s->from_duty - pos;
+
+    ledc_set_fade_with_time(SERVO_LEDC_MODE, s->channel, duty, (int)(t_next - t_prev));
+    ledc_fade_start(SERVO_LEDC_MODE, s->channel, LEDC_FADE_NO_WAIT);
+    s->duty = duty;
+    s->seg_end_us = s->start_us + (int64_t)t_next * 1000;
+    s->seg++;
+}
+
+static void servo_finish(uint8_t index, bool reached) {
+    servo_t *s = &s_servos[index];
+    servo_done_cb_t cb = s->cb;
+    s->moving = false;
+    s->cb = NULL;
+    if (cb) {
+        cb(index, reached, s->arg);
+    }
 }
 
 /*
- * compute_crc8: обчислення CRC-8 (поліном 0x8C)
+ * Обробка запиту руху в завданні сервоприводів
  */
-uint8_t compute_crc8(const uint8_t *data, size_t length) {
-    uint8_t crc = 0x00;
-    for (size_t i = 0; i < length; i++) {
-        uint8_t extract = data[i];
-        for (uint8_t tempI = 8; tempI; tempI--) {
-            uint8_t sum = (crc ^ extract) & 0x01;
-            crc >>= 1;
-            if (sum) {
-                crc ^= 0x8C;
+static void servo_begin(const servo_req_t *req) {
+    servo_t *s = &s_servos[req->servo];
+    uint32_t target = servo_angle_to_duty(req->angle);
+
+    if (s->moving) {
+        // Поточний рух зупиняється там, де є, і звідти планується новий
+        ledc_fade_stop(SERVO_LEDC_MODE, s->channel);
+        s->duty = ledc_get_duty(SERVO_LEDC_MODE, s->channel);
+        servo_finish(req->servo, false);
+    }
+    s->cb = req->cb;
+    s->arg = req->arg;
+
+    if (s->duty == 0 || s->duty == target) {
+        // Положення до першої команди невідоме - одразу в ціль
+        ledc_set_duty(SERVO_LEDC_MODE, s->channel, target);
+        ledc_update_duty(SERVO_LEDC_MODE, s->channel);
+        s->duty = target;
+        ESP_LOGI(TAG, "Сервопривід %u: кут=%u°, duty=%lu", req->servo, req->angle, (unsigned long)target);
+        servo_finish(req->servo, true);
+        return;
+    }
+
+    servo_plan(s, target);
+    s->moving = true;
+    s->start_us = esp_timer_get_time();
+    servo_start_segment(s);
+    ESP_LOGI(TAG, "Сервопривід %u: %u° за %lu мс, %u відрізків",
+             req->servo, req->angle, (unsigned long)s->total_ms, s->seg_count);
+}
+
+/*
+ * Коли завданню треба діяти для сервопривода s: за тік до межі відрізка,
+ * щоб наступний fade стартував одразу після кінця поточного, і точно в
+ * кінці останнього відрізка
+ */
+static int64_t servo_next_event_us(const servo_t *s) {
+    int64_t lead_us = s->seg < s->seg_count ? (int64_t)portTICK_PERIOD_MS * 1000 : 0;
+    return s->seg_end_us - lead_us;
+}
+
+/*
+ * Завдання сервоприводів: спить до межі наступного відрізка або до
+ * нового запиту; проміжні положення формує апаратний fade LEDC
+ */
+static void servo_task(void *arg) {
+    const int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    servo_req_t req;
+    while (true) {
+        TickType_t wait = portMAX_DELAY;
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < ACTUATOR_SERVO_COUNT; i++) {
+            if (s_servos[i].moving) {
+                int64_t left_us = servo_next_event_us(&s_servos[i]) - now;
+                TickType_t ticks = left_us > 0 ? (TickType_t)((left_us + tick_us - 1) / tick_us) : 0;
+                if (ticks < wait) wait = ticks;
             }
-            extract >>= 1;
         }
+
+        if (xQueueReceive(s_servo_queue, &req, wait) == pdTRUE) {
+            servo_begin(&req);
+        }
+
+        now = esp_timer_get_time();
+        for (int i = 0; i < ACTUATOR_SERVO_COUNT; i++) {
+            servo_t *s = &s_servos[i];
+            if (!s->moving || servo_next_event_us(s) > now) {
+                continue;
+            }
+            if (s->seg < s->seg_count) {
+                servo_start_segment(s);
+            } else {
+                servo_finish((uint8_t)i, true);
+            }
+        }
+    }
+}
+
+esp_err_t servo_move(uint8_t servo, uint8_t angle, servo_done_cb_t cb, void *arg) {
+    if (servo >= ACTUATOR_SERVO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    servo_req_t req = { .servo = servo, .angle = angle > 180 ? 180 : angle, .cb = cb, .arg = arg };
+    if (xQueueSend(s_servo_queue, &req, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Черга сервоприводів переповнена");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void servo_set_limits(uint8_t servo, uint16_t speed_dps, uint16_t accel_dps2) {
+    if (servo < ACTUATOR_SERVO_COUNT) {
+        s_servos[servo].speed_dps = speed_dps ? speed_dps : 1;
+        s_servos[servo].accel_dps2 = accel_dps2 ? accel_dps2 : 1;
     }
-    return crc;
+}
+
+bool servo_is_moving(uint8_t servo) {
+    return servo < ACTUATOR_SERVO_COUNT && s_servos[servo].moving;
+}
+
+/*
+ * servo_set_angle: плавний рух сервопривода 0 (0..180), без очікування
+ */
+void servo_set_angle(uint8_t angle) {
+    servo_move(0, angle, NULL, NULL);
 }
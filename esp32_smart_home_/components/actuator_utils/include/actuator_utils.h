@@ -1,6 +1,11 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define ACTUATOR_RELAY_COUNT  2   // реле 1..2
+#define ACTUATOR_SERVO_COUNT  2   // сервоприводи 0..1
 
 /*
  * actuator_init: ініціалізує GPIO для реле та PWM для сервоприводів
@@ -8,21 +13,79 @@
 void actuator_init(void);
 
 /*
- * relay_on: вмикає реле на каналі (1 або 2)
+ * relay_on: вмикає реле на каналі (1..ACTUATOR_RELAY_COUNT)
  */
 void relay_on(uint8_t channel);
 
 /*
- * relay_off: вимикає реле на каналі (1 або 2)
+ * relay_off: вимикає реле на каналі (1..ACTUATOR_RELAY_COUNT)
  */
 void relay_off(uint8_t channel);
 
 /*
- * servo_set_angle: задає кут сервопривода (0..180°)
+ * relay_set_mask: перемикає разом усі реле з маски mask (біт n - реле n+1)
+ * у стани з values. Без затримки вмикання всі виводи змінюються одним
+ * записом у регістр GPIO_OUT, тобто одночасно
  */
-void servo_set_angle(uint8_t angle);
+void relay_set_mask(uint32_t mask, uint32_t values);
+
+/*
+ * relay_set_stagger: затримка між вмиканнями реле в одному relay_set_mask
+ * (мс, 0 - вимкнено), щоб обмежити пусковий струм. Вимикання завжди
+ * одночасне. relay_set_mask не чекає: решту вмикань виконує esp_timer
+ * протягом (N-1) * ms, а наступна команда скасовує ще не виконані для
+ * своїх реле
+ */
+void relay_set_stagger(uint16_t ms);
+
+/*
+ * relay_get_mask: фактичний стан реле (біт n - реле n+1), прочитаний
+ * з входів GPIO, а не з останньої команди
+ */
+uint32_t relay_get_mask(void);
+
+/*
+ * relay_get_pending_mask: реле, що ще чекають відкладеного вмикання
+ * (біт n - реле n+1). Їхній вихід поки вимкнений, тож перевірка
+ * relay_get_mask після relay_set_mask має їх виключати
+ */
+uint32_t relay_get_pending_mask(void);
+
+/*
+ * Рух сервоприводів не блокує викликача: траєкторія з обмеженням
+ * швидкості та прискорення розбивається на кілька відрізків, кожен з яких
+ * LEDC проходить апаратним fade; окреме завдання лише запускає наступний
+ * відрізок на межах. Новий рух того ж сервопривода замінює поточний
+ */
+#define SERVO_SPEED_DPS_DEFAULT   180   // °/с
+#define SERVO_ACCEL_DPS2_DEFAULT  720   // °/с²
 
 /*
- * compute_crc8: обчислення CRC-8 для масиву data довжиною length
+ * Колбек завершення руху (з завдання сервоприводів, не з переривання);
+ * reached = false, якщо рух замінено новим до досягнення цілі
  */
-uint8_t compute_crc8(const uint8_t *data, size_t length);
+typedef void (*servo_done_cb_t)(uint8_t servo, bool reached, void *arg);
+
+/*
+ * servo_move: плавно переводить сервопривід servo у кут angle (0..180°);
+ * cb (може бути NULL) викликається після завершення.
+ * Повертає ESP_ERR_INVALID_ARG для неіснуючого сервопривода і
+ * ESP_ERR_NO_MEM, якщо черга команд переповнена
+ */
+esp_err_t servo_move(uint8_t servo, uint8_t angle, servo_done_cb_t cb, void *arg);
+
+/*
+ * servo_set_limits: максимальна швидкість (°/с) і прискорення (°/с²)
+ * для наступних рухів сервопривода servo
+ */
+void servo_set_limits(uint8_t servo, uint16_t speed_dps, uint16_t accel_dps2);
+
+/*
+ * servo_is_moving: true, поки рух сервопривода не завершено
+ */
+bool servo_is_moving(uint8_t servo);
+
+/*
+ * servo_set_angle: задає кут сервопривода 0 (0..180°), без очікування
+ */
+void servo_set_angle(uint8_t angle);
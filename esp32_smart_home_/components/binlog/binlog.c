@@ -0,0 +1,134 @@
+#include "binlog.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "binlog";
+
+#define BINLOG_TASK_STACK     3072
+#define BINLOG_TASK_PRIORITY  1       // below every task that logs
+#define BINLOG_DRAIN_MS       20      // producers never wake the task
+#define BINLOG_LINE_SIZE      192
+
+/**
+ * @brief One deferred log call, 32 bytes.
+ */
+typedef struct {
+    uint32_t    ts_us;      ///< Low 32 bits of esp_timer_get_time()
+    const char *tag;
+    const char *fmt;
+    uint8_t     level;
+    uint8_t     nargs;
+    uint32_t    args[BINLOG_MAX_ARGS];
+} binlog_record_t;
+
+// Multi-producer ring; indices are free-running
+static binlog_record_t s_ring[BINLOG_RING_SIZE];
+static uint32_t        s_head;
+static uint32_t        s_tail;
+static uint32_t        s_dropped;
+static portMUX_TYPE    s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint32_t nargs,
+                  uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t ts_us = (uint32_t)esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_head - s_tail == BINLOG_RING_SIZE) {
+        s_dropped++;
+        taskEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    binlog_record_t *rec = &s_ring[s_head & (BINLOG_RING_SIZE - 1)];
+    rec->ts_us   = ts_us;
+    rec->tag     = tag;
+    rec->fmt     = fmt;
+    rec->level   = (uint8_t)level;
+    rec->nargs   = (uint8_t)nargs;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+    s_head++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/**
+ * @brief Take the oldest record out of the ring.
+ */
+static bool binlog_pop(binlog_record_t *rec)
+{
+    bool found = false;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_tail != s_head) {
+        *rec = s_ring[s_tail & (BINLOG_RING_SIZE - 1)];
+        s_tail++;
+        found = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return found;
+}
+
+/**
+ * @brief Format one record and hand it to esp_log with its original level,
+ *        tag and timestamp.
+ */
+static void binlog_print(const binlog_record_t *rec)
+{
+    static const char letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    char line[BINLOG_LINE_SIZE];
+
+    // Every argument is a 32-bit word, so unused trailing ones are harmless
+    snprintf(line, sizeof(line), rec->fmt,
+             rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+    esp_log_write((esp_log_level_t)rec->level, rec->tag, "%c (%lu) %s: %s\n",
+                  letters[rec->level < sizeof(letters) ? rec->level : 0],
+                  (unsigned long)(rec->ts_us / 1000), rec->tag, line);
+}
+
+void binlog_flush(void)
+{
+    static uint32_t reported_dropped;
+    binlog_record_t rec;
+
+    while (binlog_pop(&rec)) {
+        binlog_print(&rec);
+    }
+
+    uint32_t dropped = binlog_dropped();
+    if (dropped != reported_dropped) {
+        ESP_LOGW(TAG, "%lu records dropped, ring full", (unsigned long)(dropped - reported_dropped));
+        reported_dropped = dropped;
+    }
+}
+
+uint32_t binlog_dropped(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t dropped = s_dropped;
+    taskEXIT_CRITICAL(&s_lock);
+    return dropped;
+}
+
+/**
+ * @brief Background task that prints queued records.
+ */
+static void binlog_task(void *arg)
+{
+    while (true) {
+        binlog_flush();
+        vTaskDelay(pdMS_TO_TICKS(BINLOG_DRAIN_MS));
+    }
+}
+
+esp_err_t binlog_start(void)
+{
+    if (xTaskCreate(binlog_task, "binlog", BINLOG_TASK_STACK, NULL,
+                    BINLOG_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+/*
+ * Deferred logging for hot paths.
+ *
+ * BINLOG_x() stores a fixed-size binary record (timestamp, tag, format
+ * string pointer and up to four 32-bit arguments) in a RAM ring instead of
+ * formatting and printing on the spot. A low-priority task started with
+ * binlog_start() expands the records through esp_log_write() later, so the
+ * caller pays for a short critical section, not for vsnprintf and the UART.
+ * When the ring is full new records are dropped and counted; the caller
+ * never blocks.
+ *
+ * Arguments are stored as 32-bit words: integers, characters and pointers
+ * only (no float or 64-bit values). "%s" is allowed only for strings that
+ * outlive the record, e.g. literals, TAG or static tables; never for
+ * buffers on the stack.
+ *
+ * Levels are gated at compile time per file: define BINLOG_LOCAL_LEVEL
+ * (an esp_log_level_t) before including this header; records above it are
+ * compiled out. Runtime esp_log_level_set() filtering still applies when
+ * records are printed.
+ */
+
+#ifndef BINLOG_DEFAULT_LEVEL
+#define BINLOG_DEFAULT_LEVEL  ESP_LOG_INFO
+#endif
+
+#ifndef BINLOG_LOCAL_LEVEL
+#define BINLOG_LOCAL_LEVEL    BINLOG_DEFAULT_LEVEL
+#endif
+
+#ifndef BINLOG_RING_SIZE
+#define BINLOG_RING_SIZE      128     // records, power of two
+#endif
+
+#define BINLOG_MAX_ARGS       4
+
+/**
+ * @brief Start the task that prints queued records.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t binlog_start(void);
+
+/**
+ * @brief Print every queued record now, on the calling task. Use before
+ *        deep sleep or restart so the tail of the log is not lost.
+ */
+void binlog_flush(void);
+
+/**
+ * @brief Records dropped because the ring was full.
+ */
+uint32_t binlog_dropped(void);
+
+/**
+ * @brief Queue one record. Use the BINLOG_x() macros instead.
+ */
+void binlog_write(esp_log_level_t level, const char *tag, const char *fmt, uint32_t nargs,
+                  uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* Argument count (0..4) and conversion of each argument to a 32-bit word */
+#define BINLOG_NARG(...)                 BINLOG_NARG_(_, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define BINLOG_NARG_(_, a, b, c, d, n, ...)  n
+#define BINLOG_ARG(x)                    ((uint32_t)(uintptr_t)(x))
+#define BINLOG_ARGS_0()                  0, 0, 0, 0
+#define BINLOG_ARGS_1(a)                 BINLOG_ARG(a), 0, 0, 0
+#define BINLOG_ARGS_2(a, b)              BINLOG_ARG(a), BINLOG_ARG(b), 0, 0
+#define BINLOG_ARGS_3(a, b, c)           BINLOG_ARG(a), BINLOG_ARG(b), BINLOG_ARG(c), 0
+#define BINLOG_ARGS_4(a, b, c, d)        BINLOG_ARG(a), BINLOG_ARG(b), BINLOG_ARG(c), BINLOG_ARG(d)
+#define BINLOG_ARGS__(n, ...)            BINLOG_ARGS_##n(__VA_ARGS__)
+#define BINLOG_ARGS_(n, ...)             BINLOG_ARGS__(n, __VA_ARGS__)
+
+#define BINLOG_LEVEL(level, tag, fmt, ...) do {                                         \
+        if ((level) <= BINLOG_LOCAL_LEVEL) {                                            \
+            binlog_write((level), (tag), (fmt), BINLOG_NARG(__VA_ARGS__),               \
+                         BINLOG_ARGS_(BINLOG_NARG(__VA_ARGS__), ##__VA_ARGS__));        \
+        }                                                                               \
+    } while (0)
+
+#define BINLOG_E(tag, fmt, ...)  BINLOG_LEVEL(ESP_LOG_ERROR,   tag, fmt, ##__VA_ARGS__)
+#define BINLOG_W(tag, fmt, ...)  BINLOG_LEVEL(ESP_LOG_WARN,    tag, fmt, ##__VA_ARGS__)
+#define BINLOG_I(tag, fmt, ...)  BINLOG_LEVEL(ESP_LOG_INFO,    tag, fmt, ##__VA_ARGS__)
+#define BINLOG_D(tag, fmt, ...)  BINLOG_LEVEL(ESP_LOG_DEBUG,   tag, fmt, ##__VA_ARGS__)
+#define BINLOG_V(tag, fmt, ...)  BINLOG_LEVEL(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Режими контрольної суми кадру:
+ *   CRC_MODE_8      - CRC-8 (поліном 0x8C, як у вихідному compute_crc8), 1 байт
+ *   CRC_MODE_16     - CRC-16/CCITT-FALSE (поліном 0x1021, init 0xFFFF), 2 байти
+ */
+typedef enum {
+    CRC_MODE_8 = 0,
+    CRC_MODE_16,
+} crc_mode_t;
+
+/*
+ * Потоковий контекст: дозволяє рахувати CRC під час побудови кадру
+ */
+typedef struct {
+    crc_mode_t mode;
+    uint16_t   value;
+} crc_ctx_t;
+
+/*
+ * crc_init: починає обчислення CRC у вибраному режимі
+ */
+void crc_init(crc_ctx_t *ctx, crc_mode_t mode);
+
+/*
+ * crc_update: додає до CRC наступний фрагмент даних
+ */
+void crc_update(crc_ctx_t *ctx, const uint8_t *data, size_t length);
+
+/*
+ * crc_final: повертає підсумкове значення CRC
+ */
+uint16_t crc_final(const crc_ctx_t *ctx);
+
+/*
+ * crc_size: кількість байтів CRC у кадрі для режиму mode
+ */
+static inline size_t crc_size(crc_mode_t mode) {
+    return mode == CRC_MODE_16 ? 2 : 1;
+}
+
+/*
+ * crc8_update / crc16_ccitt_update: табличні функції без контексту;
+ * crc - попереднє значення (0x00 для CRC-8, 0xFFFF для CRC-16)
+ */
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, size_t length);
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *data, size_t length);
+
+/*
+ * compute_crc8: обчислення CRC-8 для масиву data довжиною length
+ */
+uint8_t compute_crc8(const uint8_t *data, size_t length);
+
+/*
+ * compute_crc16_ccitt: обчислення CRC-16/CCITT для масиву data довжиною length
+ */
+uint16_t compute_crc16_ccitt(const uint8_t *data, size_t length);
+
+/*
+ * compute_crc16_modbus: CRC-16/MODBUS (поліном 0xA001, init 0xFFFF),
+ * яким захищені відповіді датчика AM2320
+ */
+uint16_t compute_crc16_modbus(const uint8_t *data, size_t length);
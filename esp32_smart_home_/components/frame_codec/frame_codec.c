@@ -0,0 +1,222 @@
+#include "frame_codec.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/**
+ * @brief Number of payload bytes taken by the fields present in @p fields.
+ */
+static size_t telemetry_payload_len(uint16_t fields)
+{
+    size_t len = 0;
+    if (fields & TELEMETRY_F_TEMPERATURE) len += 2;
+    if (fields & TELEMETRY_F_HUMIDITY)    len += 2;
+    if (fields & TELEMETRY_F_CO2)         len += 2;
+    if (fields & TELEMETRY_F_TVOC)        len += 2;
+    if (fields & TELEMETRY_F_LIGHT)       len += 2;
+    if (fields & TELEMETRY_F_FLAGS)       len += 1;
+    if (fields & TELEMETRY_F_NODE)        len += 8;
+    return len;
+}
+
+size_t telemetry_encode(const telemetry_frame_t *frame, uint8_t *buf, size_t buf_size)
+{
+    uint16_t fields = frame->fields & TELEMETRY_F_ALL;
+    size_t total = TELEMETRY_HEADER_LEN + telemetry_payload_len(fields);
+    if (total > buf_size) {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = FRAME_TYPE_TELEMETRY;
+    *p++ = TELEMETRY_VERSION;
+    *p++ = frame->seq;
+    put_u16(p, fields); p += 2;
+
+    if (fields & TELEMETRY_F_TEMPERATURE) { put_u16(p, (uint16_t)frame->temperature); p += 2; }
+    if (fields & TELEMETRY_F_HUMIDITY)    { put_u16(p, frame->humidity); p += 2; }
+    if (fields & TELEMETRY_F_CO2)         { put_u16(p, frame->co2); p += 2; }
+    if (fields & TELEMETRY_F_TVOC)        { put_u16(p, frame->tvoc); p += 2; }
+    if (fields & TELEMETRY_F_LIGHT)       { put_u16(p, frame->light); p += 2; }
+    if (fields & TELEMETRY_F_FLAGS)       { *p++ = frame->flags; }
+    if (fields & TELEMETRY_F_NODE)        { put_u64(p, frame->node); p += 8; }
+
+    return (size_t)(p - buf);
+}
+
+bool telemetry_decode(const uint8_t *data, size_t length, telemetry_frame_t *frame)
+{
+    if (length < TELEMETRY_HEADER_LEN
+        || data[0] != FRAME_TYPE_TELEMETRY
+        || data[1] != TELEMETRY_VERSION) {
+        return false;
+    }
+
+    uint16_t fields = get_u16(&data[3]);
+    if (fields & ~TELEMETRY_F_ALL) {
+        // Unknown fields cannot be skipped in a fixed layout
+        return false;
+    }
+    if (length != TELEMETRY_HEADER_LEN + telemetry_payload_len(fields)) {
+        return false;
+    }
+
+    *frame = (telemetry_frame_t){ .seq = data[2], .fields = fields };
+    const uint8_t *p = &data[TELEMETRY_HEADER_LEN];
+
+    if (fields & TELEMETRY_F_TEMPERATURE) { frame->temperature = (int16_t)get_u16(p); p += 2; }
+    if (fields & TELEMETRY_F_HUMIDITY)    { frame->humidity = get_u16(p); p += 2; }
+    if (fields & TELEMETRY_F_CO2)         { frame->co2 = get_u16(p); p += 2; }
+    if (fields & TELEMETRY_F_TVOC)        { frame->tvoc = get_u16(p); p += 2; }
+    if (fields & TELEMETRY_F_LIGHT)       { frame->light = get_u16(p); p += 2; }
+    if (fields & TELEMETRY_F_FLAGS)       { frame->flags = *p++; }
+    if (fields & TELEMETRY_F_NODE)        { frame->node = get_u64(p); p += 8; }
+
+    return true;
+}
+
+/*
+ * Small append-only writer over a fixed buffer; sets ok=false on overflow.
+ */
+typedef struct {
+    char  *buf;
+    size_t size;
+    size_t len;
+    bool   ok;
+} json_writer_t;
+
+static void jw_printf(json_writer_t *w, const char *fmt, ...)
+{
+    if (!w->ok) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->size - w->len) {
+        w->ok = false;
+        return;
+    }
+    w->len += (size_t)n;
+}
+
+static void jw_key(json_writer_t *w, const char *key)
+{
+    jw_printf(w, "%s\"%s\":", w->len > 1 ? "," : "", key);
+}
+
+/* Fixed-point hundredths → "12.34" without going through float */
+static void jw_centi(json_writer_t *w, int32_t value)
+{
+    const char *sign = value < 0 ? "-" : "";
+    if (value < 0) value = -value;
+    jw_printf(w, "%s%ld.%02ld", sign, (long)(value / 100), (long)(value % 100));
+}
+
+int telemetry_to_json(const telemetry_frame_t *frame, char *buf, size_t buf_size)
+{
+    if (buf_size == 0) {
+        return -1;
+    }
+    json_writer_t w = { .buf = buf, .size = buf_size, .len = 0, .ok = true };
+    uint16_t fields = frame->fields;
+
+    jw_printf(&w, "{");
+    if (fields & TELEMETRY_F_TEMPERATURE) { jw_key(&w, "temperature"); jw_centi(&w, frame->temperature); }
+    if (fields & TELEMETRY_F_HUMIDITY)    { jw_key(&w, "humidity"); jw_centi(&w, frame->humidity); }
+    if (fields & TELEMETRY_F_CO2)         { jw_key(&w, "co2"); jw_printf(&w, "%u", frame->co2); }
+    if (fields & TELEMETRY_F_TVOC)        { jw_key(&w, "tvoc"); jw_printf(&w, "%u", frame->tvoc); }
+    if (fields & TELEMETRY_F_LIGHT)       { jw_key(&w, "light"); jw_printf(&w, "%u", frame->light); }
+    if (fields & TELEMETRY_F_FLAGS) {
+        jw_key(&w, "motion");
+        jw_printf(&w, (frame->flags & TELEMETRY_FLAG_MOTION) ? "true" : "false");
+        jw_key(&w, "leak");
+        jw_printf(&w, (frame->flags & TELEMETRY_FLAG_LEAK) ? "true" : "false");
+    }
+    jw_printf(&w, "}");
+
+    if (!w.ok) {
+        buf[0] = '\0';
+        return -1;
+    }
+    return (int)w.len;
+}
+
+/**
+ * @brief Number of set bits in @p v.
+ */
+static size_t bit_count(uint8_t v)
+{
+    size_t n = 0;
+    for (; v; v &= (uint8_t)(v - 1)) {
+        n++;
+    }
+    return n;
+}
+
+size_t actuator_cmd_encode(const actuator_cmd_t *cmd, uint8_t *buf, size_t buf_size)
+{
+    size_t total = ACTUATOR_CMD_HEADER_LEN + bit_count(cmd->servo_mask);
+    if (total > buf_size) {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = ACTUATOR_CMD_VERSION;
+    *p++ = cmd->relay_mask;
+    *p++ = cmd->relay_values & cmd->relay_mask;
+    *p++ = cmd->servo_mask;
+    for (int i = 0; i < ACTUATOR_CMD_MAX_SERVOS; i++) {
+        if (cmd->servo_mask & (1u << i)) {
+            *p++ = cmd->servo_angle[i];
+        }
+    }
+    return (size_t)(p - buf);
+}
+
+bool actuator_cmd_decode(const uint8_t *data, size_t length, actuator_cmd_t *cmd)
+{
+    if (length < ACTUATOR_CMD_HEADER_LEN || data[0] != ACTUATOR_CMD_VERSION) {
+        return false;
+    }
+    if (length != ACTUATOR_CMD_HEADER_LEN + bit_count(data[3])) {
+        return false;
+    }
+    *cmd = (actuator_cmd_t){
+        .relay_mask   = data[1],
+        .relay_values = data[2] & data[1],
+        .servo_mask   = data[3],
+    };
+    const uint8_t *p = &data[ACTUATOR_CMD_HEADER_LEN];
+    for (int i = 0; i < ACTUATOR_CMD_MAX_SERVOS; i++) {
+        if (cmd->servo_mask & (1u << i)) {
+            cmd->servo_angle[i] = *p++;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Binary frame format used on the Thread link.
+ *
+ * Every frame starts with a type byte followed by a version byte. JSON
+ * frames from older nodes always start with '{', so the hub can tell the
+ * two apart by looking at the first byte.
+ *
+ * Telemetry frame (little-endian):
+ *   [type][version][seq][fields lo][fields hi] + present fields in bit order
+ *
+ *   TEMPERATURE  int16   0.01 °C
+ *   HUMIDITY     uint16  0.01 %RH
+ *   CO2          uint16  ppm
+ *   TVOC         uint16  ppb
+ *   LIGHT        uint16  lx
+ *   FLAGS        uint8   TELEMETRY_FLAG_*
+ *   NODE         uint64  sender's IEEE 802.15.4 extended address
+ *
+ * NODE gives the hub a stable identity for the sender: the RLOC16 seen as
+ * the UDP source changes whenever a node re-attaches.
+ *
+ * A full report is 24 bytes (+1 CRC byte added by the caller), which fits
+ * into a single 802.15.4 frame without 6LoWPAN fragmentation.
+ */
+
+#define FRAME_TYPE_TELEMETRY      0x81
+#define FRAME_TYPE_CMD            0x82    // [type][epoch lo][epoch hi][seq] + command payload
+#define FRAME_TYPE_ACK            0x83    // [type][epoch lo][epoch hi][seq][status]
+#define FRAME_TYPE_GROUP_CMD      0x84    // [type][epoch lo][epoch hi][seq][group lo][group hi] + payload
+#define FRAME_TYPE_GROUP_ACK      0x85    // [type][epoch lo][epoch hi][seq][group lo][group hi][status]
+#define TELEMETRY_VERSION         1
+
+#define TELEMETRY_HEADER_LEN      5
+#define TELEMETRY_MAX_LEN         24
+
+/* Bits of telemetry_frame_t.fields */
+#define TELEMETRY_F_TEMPERATURE   (1u << 0)
+#define TELEMETRY_F_HUMIDITY      (1u << 1)
+#define TELEMETRY_F_CO2           (1u << 2)
+#define TELEMETRY_F_TVOC          (1u << 3)
+#define TELEMETRY_F_LIGHT         (1u << 4)
+#define TELEMETRY_F_FLAGS         (1u << 5)
+#define TELEMETRY_F_NODE          (1u << 6)
+#define TELEMETRY_F_ALL           0x007F
+
+/* Bits of telemetry_frame_t.flags */
+#define TELEMETRY_FLAG_MOTION     (1u << 0)
+#define TELEMETRY_FLAG_LEAK       (1u << 1)
+
+/**
+ * @brief Decoded sensor report. Only fields whose bit is set in
+ *        @c fields are meaningful.
+ */
+typedef struct {
+    uint8_t  seq;
+    uint16_t fields;
+    int16_t  temperature;   // 0.01 °C
+    uint16_t humidity;      // 0.01 %RH
+    uint16_t co2;           // ppm
+    uint16_t tvoc;          // ppb
+    uint16_t light;         // lx
+    uint8_t  flags;         // TELEMETRY_FLAG_*
+    uint64_t node;          // extended address, first byte most significant
+} telemetry_frame_t;
+
+/**
+ * @brief Check whether a buffer carries a binary telemetry frame.
+ */
+static inline bool frame_is_telemetry(const uint8_t *data, size_t length)
+{
+    return length >= 2 && data[0] == FRAME_TYPE_TELEMETRY;
+}
+
+/**
+ * @brief Serialize a telemetry frame.
+ *
+ * @param frame     Report to encode
+ * @param buf       Output buffer
+ * @param buf_size  Size of the output buffer
+ * @return Number of bytes written, or 0 if the buffer is too small
+ */
+size_t telemetry_encode(const telemetry_frame_t *frame, uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief Parse a telemetry frame.
+ *
+ * @param data    Frame bytes (without CRC)
+ * @param length  Number of bytes in @p data
+ * @param frame   Decoded report
+ * @return true on success, false if the frame is malformed, truncated or of
+ *         an unsupported version
+ */
+bool telemetry_decode(const uint8_t *data, size_t length, telemetry_frame_t *frame);
+
+/**
+ * @brief Render a decoded report as the JSON object published over MQTT.
+ *
+ * Keys match the JSON previously produced by the sensor node
+ * ("temperature", "humidity", "co2", "tvoc", "light", "motion", "leak");
+ * absent fields are omitted. NODE is not rendered; the hub publishes the
+ * node identity in the topic or batch entry instead.
+ *
+ * @return Length of the string (excluding NUL), or -1 if @p buf is too small
+ */
+int telemetry_to_json(const telemetry_frame_t *frame, char *buf, size_t buf_size);
+
+/*
+ * Actuator command, carried as the payload of a FRAME_TYPE_CMD frame:
+ *   [version][relay mask][relay values][servo mask] + one angle byte per
+ *   servo bit set, in bit order
+ *
+ * Relay bit n is relay n+1, servo bit n is servo n. Everything in one
+ * command is applied together and acknowledged once.
+ */
+
+#define ACTUATOR_CMD_VERSION      1
+#define ACTUATOR_CMD_HEADER_LEN   4
+#define ACTUATOR_CMD_MAX_SERVOS   8
+#define ACTUATOR_CMD_MAX_LEN      (ACTUATOR_CMD_HEADER_LEN + ACTUATOR_CMD_MAX_SERVOS)
+
+/**
+ * @brief Decoded actuator command.
+ */
+typedef struct {
+    uint8_t relay_mask;     // relays to switch
+    uint8_t relay_values;   // new state of each relay in relay_mask
+    uint8_t servo_mask;     // servos to move
+    uint8_t servo_angle[ACTUATOR_CMD_MAX_SERVOS];   // degrees, valid where servo_mask is set
+} actuator_cmd_t;
+
+/**
+ * @brief Serialize an actuator command.
+ *
+ * @return Number of bytes written, or 0 if the buffer is too small
+ */
+size_t actuator_cmd_encode(const actuator_cmd_t *cmd, uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief Parse an actuator command.
+ *
+ * @return false if the payload is truncated, has trailing bytes or an
+ *         unsupported version
+ */
+bool actuator_cmd_decode(const uint8_t *data, size_t length, actuator_cmd_t *cmd);
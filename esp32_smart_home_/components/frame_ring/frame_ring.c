@@ -0,0 +1,99 @@
+#include "frame_ring.h"
+
+bool frame_ring_init(frame_ring_t *ring, frame_slot_t *slots, uint32_t capacity,
+                     frame_ring_policy_t policy, frame_ring_release_t release)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    ring->slots   = slots;
+    ring->mask    = capacity - 1;
+    ring->policy  = policy;
+    ring->release = release;
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(&slots[i], NULL);
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped_full, 0);
+    ring->high_water = 0;
+    return true;
+}
+
+bool frame_ring_push(frame_ring_t *ring, void *frame)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    while (head - tail > ring->mask) {
+        if (ring->policy == FRAME_RING_DROP_NEWEST) {
+            // Re-check in case the consumer freed a slot since the first load
+            tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if (head - tail > ring->mask) {
+                atomic_fetch_add_explicit(&ring->dropped_full, 1, memory_order_relaxed);
+                return false;
+            }
+            break;
+        }
+        // Drop the oldest frame by advancing tail ourselves. If the consumer
+        // got there first the CAS fails, reloads tail and we re-check; if we
+        // win, the consumer can no longer commit that slot and its reference
+        // is ours to release.
+        void *oldest = atomic_load_explicit(&ring->slots[tail & ring->mask],
+                                            memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&ring->tail, &tail, tail + 1,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            atomic_fetch_add_explicit(&ring->dropped_full, 1, memory_order_relaxed);
+            if (ring->release) {
+                ring->release(oldest);
+            }
+            tail++;
+        }
+    }
+
+    atomic_store_explicit(&ring->slots[head & ring->mask], frame, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    uint32_t depth = head + 1 - tail;
+    if (depth > ring->high_water) {
+        ring->high_water = depth;
+    }
+    return true;
+}
+
+void *frame_ring_pop(frame_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    for (;;) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == head) {
+            return NULL;
+        }
+        void *frame = atomic_load_explicit(&ring->slots[tail & ring->mask],
+                                           memory_order_relaxed);
+
+        // Commit only if the producer did not drop this slot meanwhile;
+        // otherwise the reference is already released and we retry.
+        if (atomic_compare_exchange_strong_explicit(&ring->tail, &tail, tail + 1,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            return frame;
+        }
+    }
+}
+
+uint32_t frame_ring_depth(frame_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+void frame_ring_get_stats(frame_ring_t *ring, frame_ring_stats_t *stats)
+{
+    stats->capacity     = ring->mask + 1;
+    stats->depth        = frame_ring_depth(ring);
+    stats->high_water   = ring->high_water;
+    stats->dropped_full = atomic_load_explicit(&ring->dropped_full, memory_order_relaxed);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+ * Single-producer / single-consumer lock-free ring of frame references.
+ * Frames themselves are never copied: the ring carries pointers to buffers
+ * owned elsewhere (e.g. refcounted Thread receive buffers). The producer
+ * (the OpenThread receive callback) never blocks: when the ring is full the
+ * overflow policy decides which frame is lost, the loss is counted and the
+ * dropped reference is handed to the release callback.
+ */
+
+/**
+ * @brief What to do when the producer finds the ring full.
+ */
+typedef enum {
+    FRAME_RING_DROP_NEWEST = 0,   ///< Reject the incoming frame
+    FRAME_RING_DROP_OLDEST,       ///< Overwrite the oldest queued frame
+} frame_ring_policy_t;
+
+/**
+ * @brief One queued frame reference.
+ */
+typedef _Atomic(void *) frame_slot_t;
+
+/**
+ * @brief Releases a frame reference the ring dropped on overflow.
+ */
+typedef void (*frame_ring_release_t)(void *frame);
+
+/**
+ * @brief Ring state. Indices are free-running; capacity is a power of two.
+ */
+typedef struct {
+    frame_slot_t        *slots;
+    uint32_t             mask;
+    frame_ring_policy_t  policy;
+    frame_ring_release_t release;       ///< Called for frames lost on overflow
+    _Atomic uint32_t     head;          ///< Next slot to write (producer)
+    _Atomic uint32_t     tail;          ///< Next slot to read (consumer)
+    _Atomic uint32_t     dropped_full;  ///< Frames lost to the overflow policy
+    uint32_t             high_water;    ///< Max depth seen by the producer
+} frame_ring_t;
+
+/**
+ * @brief Snapshot of ring counters.
+ */
+typedef struct {
+    uint32_t capacity;
+    uint32_t depth;
+    uint32_t high_water;
+    uint32_t dropped_full;
+} frame_ring_stats_t;
+
+/**
+ * @brief Initialize a ring over caller-provided slot storage.
+ *
+ * @param ring      Ring to initialize
+ * @param slots     Array of @p capacity slots
+ * @param capacity  Number of slots, must be a power of two
+ * @param policy    Overflow policy
+ * @param release   Called with each frame dropped by FRAME_RING_DROP_OLDEST
+ *                  (may be NULL)
+ * @return false if @p capacity is not a power of two
+ */
+bool frame_ring_init(frame_ring_t *ring, frame_slot_t *slots, uint32_t capacity,
+                     frame_ring_policy_t policy, frame_ring_release_t release);
+
+/**
+ * @brief Queue a frame reference (producer side). The ring takes over the
+ *        caller's reference only if this returns true.
+ *
+ * @return true if the frame was queued. With FRAME_RING_DROP_OLDEST a full
+ *         ring still returns true after releasing the oldest frame.
+ */
+bool frame_ring_push(frame_ring_t *ring, void *frame);
+
+/**
+ * @brief Take the oldest frame out of the ring (consumer side). The caller
+ *        owns the returned reference.
+ *
+ * @return NULL if the ring is empty
+ */
+void *frame_ring_pop(frame_ring_t *ring);
+
+/**
+ * @brief Number of frames currently queued.
+ */
+uint32_t frame_ring_depth(frame_ring_t *ring);
+
+/**
+ * @brief Read the ring counters.
+ */
+void frame_ring_get_stats(frame_ring_t *ring, frame_ring_stats_t *stats);
@@ -0,0 +1,154 @@
+#include "fx_filter.h"
+#include <string.h>
+
+#define FX_ONE_Q16  65536
+#define FX_ONE_Q8   (1 << FX_FRAC_BITS)   // multiply, not <<: samples can be negative
+
+/**
+ * @brief Q8 → integer, rounding half up.
+ */
+static inline int32_t fx_round(int32_t q8)
+{
+    return (q8 + (1 << (FX_FRAC_BITS - 1))) >> FX_FRAC_BITS;
+}
+
+/**
+ * @brief @p a times a Q16 factor, rounded to nearest. Truncating here
+ *        would bias the EMA and Kalman states downward by up to one Q8
+ *        step divided by the gain.
+ */
+static inline int32_t fx_mul_q16(int64_t a, int32_t b_q16)
+{
+    return (int32_t)((a * b_q16 + (1 << 15)) >> 16);
+}
+
+/**
+ * @brief Integer division rounding half away from zero.
+ */
+static inline int32_t fx_div_round(int32_t num, int32_t den)
+{
+    return (num >= 0 ? num + den / 2 : num - den / 2) / den;
+}
+
+void fx_ma_init(fx_ma_t *f, uint8_t window)
+{
+    memset(f, 0, sizeof(*f));
+    if (window < 1) window = 1;
+    if (window > FX_MA_MAX_WINDOW) window = FX_MA_MAX_WINDOW;
+    f->window = window;
+}
+
+int32_t fx_ma_update(fx_ma_t *f, int32_t x)
+{
+    if (f->count < f->window) {
+        f->count++;
+    } else {
+        f->sum -= f->buf[f->index];
+    }
+    f->buf[f->index] = x;
+    f->sum += x;
+    f->index = (uint8_t)((f->index + 1) % f->window);
+    return fx_div_round(f->sum, f->count);
+}
+
+void fx_ema_init(fx_ema_t *f, int32_t alpha_q16)
+{
+    if (alpha_q16 < 1) alpha_q16 = 1;
+    if (alpha_q16 > FX_ONE_Q16) alpha_q16 = FX_ONE_Q16;
+    *f = (fx_ema_t){ .alpha = alpha_q16 };
+}
+
+int32_t fx_ema_update(fx_ema_t *f, int32_t x)
+{
+    int32_t x_q8 = x * FX_ONE_Q8;
+    if (!f->primed) {
+        f->state = x_q8;
+        f->primed = true;
+    } else {
+        f->state += fx_mul_q16(x_q8 - f->state, f->alpha);
+    }
+    return fx_round(f->state);
+}
+
+void fx_median_init(fx_median_t *f, uint8_t size)
+{
+    memset(f, 0, sizeof(*f));
+    if (size < 1) size = 1;
+    if (size > FX_MEDIAN_MAX) size = FX_MEDIAN_MAX;
+    f->size = size | 1;     // odd, so the median is a sample
+}
+
+int32_t fx_median_update(fx_median_t *f, int32_t x)
+{
+    f->buf[f->index] = x;
+    f->index = (uint8_t)((f->index + 1) % f->size);
+    if (f->count < f->size) {
+        f->count++;
+    }
+
+    // Insertion sort of at most FX_MEDIAN_MAX values
+    int32_t sorted[FX_MEDIAN_MAX];
+    for (int i = 0; i < f->count; i++) {
+        int32_t v = f->buf[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    return sorted[f->count / 2];
+}
+
+void fx_kalman_init(fx_kalman_t *f, int32_t q, int32_t r)
+{
+    *f = (fx_kalman_t){
+        .q = (q > 0 ? q : 0) * FX_ONE_Q8,
+        .r = (r > 0 ? r : 1) * FX_ONE_Q8,
+    };
+}
+
+int32_t fx_kalman_update(fx_kalman_t *f, int32_t x)
+{
+    int32_t z_q8 = x * FX_ONE_Q8;
+    if (!f->primed) {
+        f->x = z_q8;
+        f->p = f->r;
+        f->primed = true;
+        return x;
+    }
+
+    // Predict: the value may have drifted by q since the last sample
+    f->p += f->q;
+
+    // Update: gain K = P / (P + R), Q16
+    int32_t k = (int32_t)(((int64_t)f->p << 16) / (f->p + f->r));
+    f->x += fx_mul_q16(z_q8 - f->x, k);
+    f->p = fx_mul_q16(f->p, FX_ONE_Q16 - k);
+    return fx_round(f->x);
+}
+
+void fx_chain_init(fx_chain_t *f, const fx_chain_cfg_t *cfg)
+{
+    memset(f, 0, sizeof(*f));
+    fx_median_init(&f->median, cfg->median);
+    f->smooth = cfg->smooth;
+    switch (cfg->smooth) {
+    case FX_SMOOTH_MA:     fx_ma_init(&f->ma, cfg->ma_window); break;
+    case FX_SMOOTH_EMA:    fx_ema_init(&f->ema, cfg->ema_alpha); break;
+    case FX_SMOOTH_KALMAN: fx_kalman_init(&f->kalman, cfg->kalman_q, cfg->kalman_r); break;
+    default: break;
+    }
+}
+
+int32_t fx_chain_update(fx_chain_t *f, int32_t x)
+{
+    if (f->median.size > 1) {
+        x = fx_median_update(&f->median, x);
+    }
+    switch (f->smooth) {
+    case FX_SMOOTH_MA:     return fx_ma_update(&f->ma, x);
+    case FX_SMOOTH_EMA:    return fx_ema_update(&f->ema, x);
+    case FX_SMOOTH_KALMAN: return fx_kalman_update(&f->kalman, x);
+    default:               return x;
+    }
+}
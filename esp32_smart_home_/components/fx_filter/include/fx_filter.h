@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Integer-only sample filters for targets without an FPU (ESP32-H2).
+ *
+ * Samples are int32 in the channel's own integer unit (e.g. 0.01 °C), the
+ * same unit that goes into the telemetry frame. Filters that need a
+ * fractional state keep it in Q8 (FX_FRAC_BITS), and coefficients are Q16
+ * constants built at compile time with FX_Q16(). Every state struct is
+ * plain data with no pointers, so it can live in RTC memory across deep
+ * sleep.
+ *
+ * A channel runs an optional median-of-N spike rejector followed by one
+ * smoother (moving average, EMA or scalar Kalman), see fx_chain_t.
+ */
+
+#define FX_FRAC_BITS        8
+#define FX_Q16(x)           ((int32_t)((x) * 65536.0 + 0.5))  // constant expressions only
+
+#define FX_MA_MAX_WINDOW    8
+#define FX_MEDIAN_MAX       5   // odd
+
+/**
+ * @brief Moving average over the last @c window samples.
+ */
+typedef struct {
+    int32_t buf[FX_MA_MAX_WINDOW];
+    int32_t sum;
+    uint8_t window;
+    uint8_t index;
+    uint8_t count;
+} fx_ma_t;
+
+/**
+ * @brief Exponential moving average, y += alpha * (x - y).
+ */
+typedef struct {
+    int32_t state;          ///< Q8
+    int32_t alpha;          ///< Q16, 0 < alpha <= 1
+    bool    primed;
+} fx_ema_t;
+
+/**
+ * @brief Median of the last @c size samples; rejects single-sample spikes.
+ */
+typedef struct {
+    int32_t buf[FX_MEDIAN_MAX];
+    uint8_t size;
+    uint8_t index;
+    uint8_t count;
+} fx_median_t;
+
+/**
+ * @brief Scalar Kalman filter for a slowly drifting value.
+ *
+ * @c q is the process noise (how fast the true value may wander per
+ * sample) and @c r the measurement noise, both variances in squared
+ * sample units. Keep @c q above zero: with q = 0 the Q8 variance bottoms
+ * out instead of decaying, so the filter does not become a running mean.
+ */
+typedef struct {
+    int32_t x;              ///< Estimate, Q8
+    int32_t p;              ///< Estimate variance, Q8
+    int32_t q;              ///< Process noise, Q8
+    int32_t r;              ///< Measurement noise, Q8
+    bool    primed;
+} fx_kalman_t;
+
+void    fx_ma_init(fx_ma_t *f, uint8_t window);
+int32_t fx_ma_update(fx_ma_t *f, int32_t x);
+
+void    fx_ema_init(fx_ema_t *f, int32_t alpha_q16);
+int32_t fx_ema_update(fx_ema_t *f, int32_t x);
+
+void    fx_median_init(fx_median_t *f, uint8_t size);
+int32_t fx_median_update(fx_median_t *f, int32_t x);
+
+void    fx_kalman_init(fx_kalman_t *f, int32_t q, int32_t r);
+int32_t fx_kalman_update(fx_kalman_t *f, int32_t x);
+
+/**
+ * @brief Smoother used by a filter chain.
+ */
+typedef enum {
+    FX_SMOOTH_NONE = 0,
+    FX_SMOOTH_MA,
+    FX_SMOOTH_EMA,
+    FX_SMOOTH_KALMAN,
+} fx_smooth_t;
+
+/**
+ * @brief Per-channel filter configuration.
+ */
+typedef struct {
+    uint8_t     median;         ///< Median window (odd), 0 or 1 to skip
+    fx_smooth_t smooth;
+    uint8_t     ma_window;      ///< FX_SMOOTH_MA
+    int32_t     ema_alpha;      ///< FX_SMOOTH_EMA, Q16
+    int32_t     kalman_q;       ///< FX_SMOOTH_KALMAN, squared sample units
+    int32_t     kalman_r;
+} fx_chain_cfg_t;
+
+/**
+ * @brief Median stage followed by a smoother.
+ */
+typedef struct {
+    fx_median_t median;
+    fx_smooth_t smooth;
+    union {
+        fx_ma_t     ma;
+        fx_ema_t    ema;
+        fx_kalman_t kalman;
+    };
+} fx_chain_t;
+
+void    fx_chain_init(fx_chain_t *f, const fx_chain_cfg_t *cfg);
+int32_t fx_chain_update(fx_chain_t *f, int32_t x);
@@ -0,0 +1,95 @@
+#include "hub_pipeline.h"
+#include "frame_codec.h"
+#include "hub_stats.h"
+#include "esp_log.h"
+#include "binlog.h"
+
+static const char *TAG = "hub_pipeline";
+
+hub_frame_result_t hub_pipeline_frame(const hub_pipeline_t *pipeline, uint16_t src_id,
+                                      const uint8_t *data, size_t length, int64_t now_ms,
+                                      void *rule_arg)
+{
+    hub_stamp_t start = HUB_STATS_CYCLES();
+
+    char telemetry_json[128];
+    const char *json_str = (const char *)data;
+    size_t json_len = length;
+    node_entry_t *node;
+    if (frame_is_telemetry(data, length)) {
+        telemetry_frame_t telemetry;
+        if (!telemetry_decode(data, length, &telemetry)) {
+            // No usable identity in the frame: charge whoever sent from
+            // this RLOC16 last, extended-address entries included
+            node = node_registry_find_rloc(pipeline->nodes, src_id);
+            if (node) {
+                node->errors++;
+            }
+            HUB_STATS_COUNT(HUB_CNT_MALFORMED);
+            ESP_LOGW(TAG, "Malformed telemetry frame from node %u", src_id);
+            return HUB_FRAME_MALFORMED;
+        }
+
+        // Nodes that send their extended address keep one entry across
+        // re-attach; the RLOC16 is only a fallback identity
+        uint64_t key = (telemetry.fields & TELEMETRY_F_NODE)
+                       ? telemetry.node : NODE_REGISTRY_RLOC_KEY(src_id);
+        node = node_registry_touch(pipeline->nodes, key, src_id, now_ms);
+        if (node) {
+            if (!node_registry_accept_seq(pipeline->nodes, node, telemetry.seq, now_ms)) {
+                HUB_STATS_COUNT(HUB_CNT_DUPLICATE);
+                ESP_LOGD(TAG, "Duplicate frame #%u from %s", telemetry.seq, node->id);
+                return HUB_FRAME_DUPLICATE;
+            }
+            uint16_t changed = node_registry_merge(node, &telemetry);
+            ESP_LOGD(TAG, "Node %s changed fields 0x%02X", node->id, changed);
+
+            // Local rules act before anything goes to the broker
+            if (pipeline->rules) {
+                xSemaphoreTake(pipeline->rules_lock, portMAX_DELAY);
+                rule_table_eval(pipeline->rules, node->key, &node->last, pipeline->rule_action,
+                                rule_arg);
+                xSemaphoreGive(pipeline->rules_lock);
+            }
+
+            if (pipeline->history) {
+                tsdb_add(pipeline->history, node->key, (uint32_t)(now_ms / 1000), &telemetry);
+            }
+        }
+
+        int n = telemetry_to_json(&telemetry, telemetry_json, sizeof(telemetry_json));
+        if (n < 0) {
+            ESP_LOGW(TAG, "Telemetry JSON does not fit");
+            return HUB_FRAME_TOO_LONG;
+        }
+        json_str = telemetry_json;
+        json_len = (size_t)n;
+    } else {
+        node = node_registry_touch(pipeline->nodes, NODE_REGISTRY_RLOC_KEY(src_id), src_id, now_ms);
+        if (node) {
+            node->packets++;
+        }
+    }
+    if (!node) {
+        ESP_LOGW(TAG, "Node table full, frame from node %u dropped", src_id);
+        return HUB_FRAME_REJECTED;
+    }
+
+    HUB_STATS_SINCE(HUB_STAGE_DECODE, start);
+    BINLOG_I(TAG, "Frame from %s: %u bytes of JSON", node->id, json_len);
+
+    start = HUB_STATS_CYCLES();
+    if (pipeline->publish_mode & HUB_PUBLISH_BATCHED) {
+        // Collect into the current window; flushed by size here or by time
+        // in the publisher task
+        mqtt_batch_add(pipeline->batch, node->id, json_str, json_len);
+    }
+    if (pipeline->publish_mode & HUB_PUBLISH_PER_NODE) {
+        // Publish to MQTT under the node's precomputed "home/sensors/<id>"
+        mqtt_publish_len(node->topic, json_str, json_len);
+        BINLOG_I(TAG, "MQTT PUB → %s", node->topic);
+    }
+    HUB_STATS_SINCE(HUB_STAGE_PUBLISH, start);
+    HUB_STATS_COUNT(HUB_CNT_PUBLISHED);
+    return HUB_FRAME_PUBLISHED;
+}
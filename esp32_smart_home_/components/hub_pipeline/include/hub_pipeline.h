@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "node_registry.h"
+#include "rule_engine.h"
+#include "tsdb.h"
+#include "mqtt_utils.h"
+
+/*
+ * The hub's publisher path for one received Thread frame: decode, node
+ * registry and duplicate check, local rules, reading history, JSON
+ * rendering and the hand-off to MQTT (per-node topic and/or batch), with
+ * the hub_stats counters and stage timings.
+ *
+ * It runs on the hub's publisher task and is also built on the host by
+ * host_test/sim/hub_sim.c and bench_hot_paths, against stand-ins for
+ * mqtt_publish_len() and esp_timer, so both exercise the code the hub runs. The sizes
+ * below are shared with the simulation for the same reason.
+ */
+
+#define HUB_RX_RING_CAPACITY   32      // Thread RX → publisher queue slots, power of two
+
+// Per-node state, keyed by extended address
+#define HUB_NODE_CAPACITY      512     // power of two; up to 3/4 of it in use
+#define HUB_DUP_WINDOW_MS      30000   // repeated seq within this time is a duplicate
+
+// Reading history in PSRAM (tsdb); later nodes are forwarded but not stored
+#define HUB_HISTORY_MAX_NODES  200
+
+// How readings are published: per-node topics, one batched topic, or both
+#define HUB_PUBLISH_PER_NODE   (1 << 0)    // home/sensors/<id>
+#define HUB_PUBLISH_BATCHED    (1 << 1)    // HUB_BATCH_TOPIC
+#define HUB_BATCH_TOPIC        "home/sensors/batch"
+#define HUB_BATCH_WINDOW_MS    250
+#define HUB_BATCH_MAX_MSGS     64
+
+/**
+ * @brief What became of a frame.
+ */
+typedef enum {
+    HUB_FRAME_PUBLISHED = 0,    ///< Handed to MQTT
+    HUB_FRAME_MALFORMED,        ///< Binary telemetry that does not decode
+    HUB_FRAME_DUPLICATE,        ///< Repeated sequence number
+    HUB_FRAME_REJECTED,         ///< New node and the node table is full
+    HUB_FRAME_TOO_LONG,         ///< Telemetry JSON does not fit
+} hub_frame_result_t;
+
+/**
+ * @brief State the path works on; owned by the publisher task except where
+ *        noted.
+ */
+typedef struct {
+    node_registry_t  *nodes;
+    rule_table_t     *rules;            ///< Local rules, or NULL
+    SemaphoreHandle_t rules_lock;       ///< Held while @ref rules is evaluated
+    rule_action_cb_t  rule_action;      ///< Runs for every rule that fires
+    tsdb_t           *history;          ///< Reading history, or NULL
+    mqtt_batch_t     *batch;            ///< Used with HUB_PUBLISH_BATCHED
+    uint8_t           publish_mode;     ///< HUB_PUBLISH_* flags
+} hub_pipeline_t;
+
+/**
+ * @brief Process one frame whose CRC has been checked.
+ *
+ * Binary telemetry is converted to JSON here, at the MQTT edge; anything
+ * else is a legacy JSON payload forwarded as it is.
+ *
+ * @param src_id    RLOC16 of the sender
+ * @param data      Frame without the CRC
+ * @param now_ms    Current time, for the registry and the history
+ * @param rule_arg  Passed to the rule action (the hub passes the receive
+ *                  buffer, for the rule latency)
+ */
+hub_frame_result_t hub_pipeline_frame(const hub_pipeline_t *pipeline, uint16_t src_id,
+                                      const uint8_t *data, size_t length, int64_t now_ms,
+                                      void *rule_arg);
@@ -0,0 +1,190 @@
+#include "hub_stats.h"
+
+#if HUB_STATS_ENABLE
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static hub_hist_t s_hist[HUB_STAGE_COUNT];
+static uint32_t   s_counters[HUB_CNT_COUNT];
+
+/*
+ * Publishes awaiting PUBACK, indexed by msg_id. The publishing task fills
+ * a slot, the MQTT client task claims it with a CAS on msg_id (0 = empty).
+ */
+typedef struct {
+    _Atomic int      msg_id;
+    _Atomic uint32_t sent_us;
+} puback_slot_t;
+
+static puback_slot_t s_pending[HUB_STATS_PUBACK_SLOTS];
+
+static const char *const s_stage_names[HUB_STAGE_COUNT] = {
+    [HUB_STAGE_RX_CRC]  = "rx_crc_cyc",
+    [HUB_STAGE_QUEUE]   = "queue_us",
+    [HUB_STAGE_DECODE]  = "decode_cyc",
+    [HUB_STAGE_PUBLISH] = "publish_cyc",
+    [HUB_STAGE_PUBACK]  = "puback_us",
+    [HUB_STAGE_RULE]    = "rule_us",
+};
+
+static const char *const s_counter_names[HUB_CNT_COUNT] = {
+    [HUB_CNT_RX]          = "rx",
+    [HUB_CNT_TRUNCATED]   = "truncated",
+    [HUB_CNT_CRC_ERROR]   = "crc_errors",
+    [HUB_CNT_DROPPED]     = "dropped",
+    [HUB_CNT_MALFORMED]   = "malformed",
+    [HUB_CNT_DUPLICATE]   = "duplicates",
+    [HUB_CNT_PUBLISHED]   = "published",
+    [HUB_CNT_PUBACK]      = "pubacks",
+    [HUB_CNT_PUBACK_LOST] = "puback_lost",
+    [HUB_CNT_RULE_FIRED]  = "rules_fired",
+    [HUB_CNT_MIGRATED]    = "migrated",
+};
+
+hub_stamp_t hub_stats_stamp(void)
+{
+    // Core and counter from one core: no switch between the two reads
+    portDISABLE_INTERRUPTS();
+    hub_stamp_t stamp = (hub_stamp_t)esp_cpu_get_core_id() << 32
+                        | (uint32_t)esp_cpu_get_cycle_count();
+    portENABLE_INTERRUPTS();
+    return stamp;
+}
+
+void hub_stats_since(hub_stage_t stage, hub_stamp_t start)
+{
+    hub_stamp_t now = hub_stats_stamp();
+    if ((now >> 32) != (start >> 32)) {
+        // The one counter with several writers (any timed task)
+        __atomic_fetch_add(&s_counters[HUB_CNT_MIGRATED], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    hub_stats_record(stage, (uint32_t)now - (uint32_t)start);
+}
+
+void hub_stats_record(hub_stage_t stage, uint32_t value)
+{
+    hub_hist_t *h = &s_hist[stage];
+    int bucket = value < 2 ? 0 : 31 - __builtin_clz(value);
+    if (bucket >= HUB_STATS_BUCKETS) {
+        bucket = HUB_STATS_BUCKETS - 1;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+void hub_stats_count(hub_counter_t counter)
+{
+    s_counters[counter]++;
+}
+
+void hub_stats_publish_sent(int msg_id)
+{
+    if (msg_id <= 0) {
+        return;
+    }
+    // Empty the slot first so a late PUBACK for the previous owner cannot
+    // claim it while the timestamp is being replaced
+    puback_slot_t *slot = &s_pending[msg_id & (HUB_STATS_PUBACK_SLOTS - 1)];
+    if (atomic_exchange_explicit(&slot->msg_id, 0, memory_order_acq_rel) != 0) {
+        s_counters[HUB_CNT_PUBACK_LOST]++;
+    }
+    atomic_store_explicit(&slot->sent_us, (uint32_t)esp_timer_get_time(), memory_order_relaxed);
+    atomic_store_explicit(&slot->msg_id, msg_id, memory_order_release);
+}
+
+void hub_stats_puback(int msg_id)
+{
+    if (msg_id <= 0) {
+        return;
+    }
+    puback_slot_t *slot = &s_pending[msg_id & (HUB_STATS_PUBACK_SLOTS - 1)];
+    int expected = msg_id;
+    if (atomic_load_explicit(&slot->msg_id, memory_order_acquire) != expected) {
+        return;
+    }
+    uint32_t sent_us = atomic_load_explicit(&slot->sent_us, memory_order_relaxed);
+    // The timestamp belongs to msg_id only if the slot still holds it
+    if (!atomic_compare_exchange_strong_explicit(&slot->msg_id, &expected, 0,
+                                                 memory_order_acq_rel, memory_order_relaxed)) {
+        return;
+    }
+    hub_stats_record(HUB_STAGE_PUBACK, (uint32_t)esp_timer_get_time() - sent_us);
+    s_counters[HUB_CNT_PUBACK]++;
+}
+
+/*
+ * Small append-only writer over a fixed buffer; sets ok=false on overflow.
+ */
+typedef struct {
+    char  *buf;
+    size_t size;
+    size_t len;
+    bool   ok;
+} stats_writer_t;
+
+static void sw_printf(stats_writer_t *w, const char *fmt, ...)
+{
+    if (!w->ok) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->size - w->len) {
+        w->ok = false;
+        return;
+    }
+    w->len += (size_t)n;
+}
+
+int hub_stats_to_json(char *buf, size_t buf_size)
+{
+    if (buf_size == 0) {
+        return -1;
+    }
+    stats_writer_t w = { .buf = buf, .size = buf_size, .len = 0, .ok = true };
+
+    sw_printf(&w, "{\"uptime_s\":%lu,\"cpu_mhz\":%lu,\"counters\":{",
+              (unsigned long)(esp_timer_get_time() / 1000000),
+              (unsigned long)esp_rom_get_cpu_ticks_per_us());
+    for (int i = 0; i < HUB_CNT_COUNT; i++) {
+        sw_printf(&w, "%s\"%s\":%lu", i ? "," : "", s_counter_names[i],
+                  (unsigned long)s_counters[i]);
+    }
+    sw_printf(&w, "}");
+
+    // Buckets are emitted up to the last non-empty one
+    for (int i = 0; i < HUB_STAGE_COUNT; i++) {
+        const hub_hist_t *h = &s_hist[i];
+        int last = HUB_STATS_BUCKETS - 1;
+        while (last >= 0 && h->buckets[last] == 0) {
+            last--;
+        }
+        sw_printf(&w, ",\"%s\":{\"n\":%lu,\"avg\":%lu,\"max\":%lu,\"log2\":[",
+                  s_stage_names[i], (unsigned long)h->count,
+                  (unsigned long)(h->count ? h->sum / h->count : 0), (unsigned long)h->max);
+        for (int b = 0; b <= last; b++) {
+            sw_printf(&w, "%s%lu", b ? "," : "", (unsigned long)h->buckets[b]);
+        }
+        sw_printf(&w, "]}");
+    }
+    sw_printf(&w, "}");
+
+    if (!w.ok) {
+        buf[0] = '\0';
+        return -1;
+    }
+    return (int)w.len;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Hub pipeline instrumentation: event counters and one latency histogram
+ * per stage of the Thread RX → MQTT path.
+ *
+ * Stages that start and end on the same task are timed with the CPU cycle
+ * counter (a register read). Spans that cross tasks, and therefore possibly
+ * cores, use esp_timer microseconds, because the two cores' cycle counters
+ * are not synchronized. An unpinned task can still migrate between two
+ * cycle stamps, so a stamp carries its core and a sample whose end was
+ * read on the other core is discarded (counted as HUB_CNT_MIGRATED).
+ *
+ * Histograms have HUB_STATS_BUCKETS log2 buckets: bucket 0 holds 0 and 1,
+ * bucket i holds [2^i, 2^(i+1)), the last bucket everything above. Each
+ * histogram and counter has a single writer task, so recording is a few
+ * plain stores; a snapshot taken meanwhile may miss in-flight samples.
+ *
+ * Build with HUB_STATS_ENABLE=0 to compile every HUB_STATS_* macro out.
+ */
+
+#ifndef HUB_STATS_ENABLE
+#define HUB_STATS_ENABLE   1
+#endif
+
+#define HUB_STATS_BUCKETS  20
+#define HUB_STATS_PUBACK_SLOTS 32   // power of two; QoS 1 publishes awaiting PUBACK
+
+/**
+ * @brief Timed stages.
+ */
+typedef enum {
+    HUB_STAGE_RX_CRC = 0,   ///< CRC check in the Thread receive callback, cycles
+    HUB_STAGE_QUEUE,        ///< Thread RX → publisher dequeue, us
+    HUB_STAGE_DECODE,       ///< Decode, dedup and JSON rendering, cycles
+    HUB_STAGE_PUBLISH,      ///< Hand-off to the MQTT client, cycles
+    HUB_STAGE_PUBACK,       ///< MQTT publish → broker PUBACK, us
+    HUB_STAGE_RULE,         ///< Thread RX → local rule command sent, us
+    HUB_STAGE_COUNT
+} hub_stage_t;
+
+/**
+ * @brief Counted events.
+ */
+typedef enum {
+    HUB_CNT_RX = 0,         ///< Frames delivered by Thread
+    HUB_CNT_TRUNCATED,      ///< Too short to carry a CRC
+    HUB_CNT_CRC_ERROR,      ///< CRC mismatch
+    HUB_CNT_DROPPED,        ///< Lost to RX ring overflow
+    HUB_CNT_MALFORMED,      ///< Failed to decode
+    HUB_CNT_DUPLICATE,      ///< Repeated sequence number
+    HUB_CNT_PUBLISHED,      ///< Frames handed to MQTT
+    HUB_CNT_PUBACK,         ///< PUBACKs matched to a tracked publish
+    HUB_CNT_PUBACK_LOST,    ///< Tracked publishes evicted before their PUBACK
+    HUB_CNT_RULE_FIRED,     ///< Commands sent by local rules
+    HUB_CNT_MIGRATED,       ///< Cycle samples discarded after a core switch
+    HUB_CNT_COUNT
+} hub_counter_t;
+
+/**
+ * @brief Cycle counter reading tagged with its core: core << 32 | cycles.
+ */
+typedef uint64_t hub_stamp_t;
+
+/**
+ * @brief Log2 histogram.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[HUB_STATS_BUCKETS];
+} hub_hist_t;
+
+#if HUB_STATS_ENABLE
+
+/**
+ * @brief Current CPU cycle counter and core, for same-task stage timing.
+ */
+hub_stamp_t hub_stats_stamp(void);
+
+/**
+ * @brief Record the cycles since @p start, unless the task has moved to
+ *        the other core since; the counters of the two cores differ.
+ */
+void hub_stats_since(hub_stage_t stage, hub_stamp_t start);
+
+/**
+ * @brief Add one sample to a stage histogram.
+ */
+void hub_stats_record(hub_stage_t stage, uint32_t value);
+
+/**
+ * @brief Increment a counter.
+ */
+void hub_stats_count(hub_counter_t counter);
+
+/**
+ * @brief Note a QoS 1 publish; its PUBACK latency is recorded when
+ *        hub_stats_puback() sees the same @p msg_id. Call from one task.
+ */
+void hub_stats_publish_sent(int msg_id);
+
+/**
+ * @brief Note a PUBACK (MQTT_EVENT_PUBLISHED). Call from one task.
+ */
+void hub_stats_puback(int msg_id);
+
+/**
+ * @brief Render all counters and histograms as a JSON object.
+ *
+ * @return Length of the string (excluding NUL), or -1 if @p buf is too small
+ */
+int hub_stats_to_json(char *buf, size_t buf_size);
+
+#define HUB_STATS_CYCLES()               hub_stats_stamp()
+#define HUB_STATS_RECORD(stage, value)   hub_stats_record((stage), (value))
+#define HUB_STATS_SINCE(stage, start)    hub_stats_since((stage), (start))
+#define HUB_STATS_COUNT(counter)         hub_stats_count(counter)
+#define HUB_STATS_PUBACK(msg_id)         hub_stats_puback(msg_id)
+
+#else
+
+#define HUB_STATS_CYCLES()               0u
+#define HUB_STATS_RECORD(stage, value)   ((void)0)
+#define HUB_STATS_SINCE(stage, start)    ((void)(start))
+#define HUB_STATS_COUNT(counter)         ((void)0)
+#define HUB_STATS_PUBACK(msg_id)         ((void)0)
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Bump allocator for cJSON. Installed once through cJSON_InitHooks; a task
+ * binds its own arena around each message (json_arena_begin/end) and every
+ * cJSON allocation inside that scope comes from the arena. Frees are no-ops,
+ * the whole arena is reset at the next json_arena_begin(). Outside a scope,
+ * or when an arena runs out, allocations fall back to the heap and are
+ * counted, so a non-zero fallback count means the arena is too small.
+ *
+ * Trees built inside a scope must not be used after json_arena_end();
+ * serialize with cJSON_PrintPreallocated() into a caller-owned buffer.
+ */
+
+/**
+ * @brief Arena over caller-provided storage.
+ */
+typedef struct json_arena {
+    uint8_t           *buf;
+    size_t             size;
+    size_t             used;        ///< Bytes handed out in the current scope
+    size_t             high_water;  ///< Largest @ref used seen at json_arena_end()
+    uint32_t           fallbacks;   ///< Allocations that went to the heap
+    struct json_arena *next;        ///< Registry link, managed by json_arena
+} json_arena_t;
+
+/**
+ * @brief Install the cJSON allocation hooks. Call once at startup, before
+ *        any cJSON use; safe to call again.
+ */
+void json_arena_install(void);
+
+/**
+ * @brief Initialize an arena over @p buf.
+ */
+void json_arena_init(json_arena_t *arena, void *buf, size_t size);
+
+/**
+ * @brief Reset @p arena and bind it to the calling task.
+ */
+void json_arena_begin(json_arena_t *arena);
+
+/**
+ * @brief Unbind the calling task's arena and update its high-water mark.
+ */
+void json_arena_end(json_arena_t *arena);
+
+/**
+ * @brief Largest number of bytes a single scope has used.
+ */
+static inline size_t json_arena_high_water(const json_arena_t *arena)
+{
+    return arena->high_water;
+}
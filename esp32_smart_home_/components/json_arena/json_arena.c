@@ -0,0 +1,83 @@
+#include "json_arena.h"
+#include <stdlib.h>
+#include "cJSON.h"
+
+// cJSON items hold doubles; keep every block aligned for them
+#define JSON_ARENA_ALIGN  8
+
+static __thread json_arena_t *s_current;   // arena bound to this task
+static json_arena_t          *s_arenas;    // every initialized arena
+
+static bool json_arena_owns(const json_arena_t *arena, const void *ptr)
+{
+    const uint8_t *p = ptr;
+    return p >= arena->buf && p < arena->buf + arena->size;
+}
+
+static void *json_arena_malloc(size_t size)
+{
+    json_arena_t *arena = s_current;
+    if (arena) {
+        size_t offset = (arena->used + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+        if (offset <= arena->size && size <= arena->size - offset) {
+            arena->used = offset + size;
+            return arena->buf + offset;
+        }
+        arena->fallbacks++;
+    }
+    return malloc(size);
+}
+
+static void json_arena_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    if (s_current && json_arena_owns(s_current, ptr)) {
+        return;
+    }
+    // A tree may be freed from outside its scope; arena memory is still
+    // never passed to free()
+    for (const json_arena_t *arena = s_arenas; arena; arena = arena->next) {
+        if (json_arena_owns(arena, ptr)) {
+            return;
+        }
+    }
+    free(ptr);
+}
+
+void json_arena_install(void)
+{
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_arena_malloc,
+        .free_fn   = json_arena_free,
+    };
+    cJSON_InitHooks(&hooks);
+}
+
+void json_arena_init(json_arena_t *arena, void *buf, size_t size)
+{
+    arena->buf        = buf;
+    arena->size       = size;
+    arena->used       = 0;
+    arena->high_water = 0;
+    arena->fallbacks  = 0;
+
+    // Arenas are created at startup, before any task allocates from them
+    arena->next = s_arenas;
+    s_arenas    = arena;
+}
+
+void json_arena_begin(json_arena_t *arena)
+{
+    arena->used = 0;
+    s_current   = arena;
+}
+
+void json_arena_end(json_arena_t *arena)
+{
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    s_current = NULL;
+}
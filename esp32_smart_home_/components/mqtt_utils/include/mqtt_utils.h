@@ -1,6 +1,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
 
 /* Зовнішні змінні, що містять PEM-сертифікати */
 extern const uint8_t broker_ca_pem_start[] asm("_binary_ca_cert_pem_start");
@@ -13,9 +17,82 @@ extern const uint8_t client_key_pem_end[]   asm("_binary_client_key_pem_end");
 /*
  * mqtt_init: ініціалізує MQTT-клієнт із TLS
  */
-void mqtt_init(const char *broker_uri, const char *client_id);
+esp_err_t mqtt_init(const char *broker_uri, const char *client_id);
 
 /*
- * mqtt_publish: публікує payload у топік topic
+ * mqtt_register_event_handler: додатковий обробник подій MQTT-клієнта
+ * (MQTT_EVENT_DATA, MQTT_EVENT_PUBLISHED, ...); викликати після mqtt_init
  */
-void mqtt_publish(const char *topic, const char *payload);
+void mqtt_register_event_handler(esp_event_handler_t handler);
+
+/*
+ * mqtt_subscribe: підписка на topic, що відновлюється після кожного
+ * (пере)підключення; можна викликати ще до підключення до брокера
+ */
+#define MQTT_MAX_SUBSCRIPTIONS 8
+
+esp_err_t mqtt_subscribe(const char *topic, int qos);
+
+/*
+ * Хук, який викликається після кожної публікації з її msg_id (для QoS 1
+ * брокер підтверджує його подією MQTT_EVENT_PUBLISHED)
+ */
+typedef void (*mqtt_publish_hook_t)(int msg_id);
+
+void mqtt_set_publish_hook(mqtt_publish_hook_t hook);
+
+/*
+ * mqtt_publish: публікує payload у топік topic; повертає msg_id або -1
+ */
+int mqtt_publish(const char *topic, const char *payload);
+
+/*
+ * mqtt_publish_len: те саме для payload довжиною len без завершального '\0'
+ */
+int mqtt_publish_len(const char *topic, const char *payload, size_t len);
+
+/*
+ * Агрегація публікацій: показання від різних вузлів збираються протягом
+ * вікна window_ms (або до max_msgs записів) і надсилаються одним QoS 1
+ * повідомленням у топік topic у вигляді масиву:
+ *   [{"node":"<id>",...поля вузла...},{"node":"<id>",...}]
+ */
+#define MQTT_BATCH_BUF_SIZE 4096
+
+typedef struct {
+    const char *topic;
+    uint32_t    window_ms;
+    uint16_t    max_msgs;
+    uint16_t    count;
+    int64_t     opened_us;      // час додавання першого запису у вікно
+    size_t      len;
+    char        buf[MQTT_BATCH_BUF_SIZE];
+} mqtt_batch_t;
+
+/*
+ * mqtt_batch_init: налаштовує пакет для топіка topic
+ */
+void mqtt_batch_init(mqtt_batch_t *batch, const char *topic, uint32_t window_ms, uint16_t max_msgs);
+
+/*
+ * mqtt_batch_add: додає JSON-об'єкт json (len байтів) вузла node_id; якщо пакет
+ * заповнено, він публікується негайно. Повертає false, якщо json не є
+ * об'єктом або не вміщується навіть у порожній пакет
+ */
+bool mqtt_batch_add(mqtt_batch_t *batch, const char *node_id, const char *json, size_t len);
+
+/*
+ * mqtt_batch_poll: публікує пакет, якщо його вікно вичерпано
+ */
+void mqtt_batch_poll(mqtt_batch_t *batch);
+
+/*
+ * mqtt_batch_flush: негайно публікує накопичені записи
+ */
+void mqtt_batch_flush(mqtt_batch_t *batch);
+
+/*
+ * mqtt_batch_time_left_ms: скільки мс лишилося до закриття вікна
+ * (UINT32_MAX, якщо пакет порожній)
+ */
+uint32_t mqtt_batch_time_left_ms(const mqtt_batch_t *batch);
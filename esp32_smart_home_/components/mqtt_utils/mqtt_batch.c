@@ -0,0 +1,96 @@
+#include "mqtt_utils.h"
+#include "esp_log.h"
+#include "binlog.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Агрегація публікацій (mqtt_batch_*). Не залежить від MQTT-клієнта, окрім
+ * mqtt_publish(), тож збирається і на хості (host_test/sim)
+ */
+
+static const char *TAG = "mqtt_batch";
+
+/*
+ * mqtt_batch_init: порожній пакет без відкритого вікна
+ */
+void mqtt_batch_init(mqtt_batch_t *batch, const char *topic, uint32_t window_ms, uint16_t max_msgs) {
+    batch->topic = topic;
+    batch->window_ms = window_ms;
+    batch->max_msgs = max_msgs;
+    batch->count = 0;
+    batch->opened_us = 0;
+    batch->len = 0;
+    batch->buf[0] = '\0';
+}
+
+void mqtt_batch_flush(mqtt_batch_t *batch) {
+    if (batch->count == 0) {
+        return;
+    }
+    // Закриваємо масив: буфер завжди має місце під ']' і '\0'
+    batch->buf[batch->len++] = ']';
+    batch->buf[batch->len] = '\0';
+    mqtt_publish(batch->topic, batch->buf);
+    BINLOG_I(TAG, "MQTT пакет: %u записів, %u байт", batch->count, batch->len);
+    batch->count = 0;
+    batch->len = 0;
+}
+
+/*
+ * Дописує {"node":"<id>",...} до масиву; поля вузла беруться з json без '{'
+ */
+static bool mqtt_batch_append(mqtt_batch_t *batch, const char *node_id, const char *json, size_t len) {
+    const char *body = json + 1;
+    int body_len = (int)len - 1;
+    bool empty = (body_len == 1 && body[0] == '}');
+    // Резерв 2 байти під завершальні ']' і '\0'
+    size_t room = sizeof(batch->buf) - batch->len - 2;
+    int n = snprintf(batch->buf + batch->len, room + 1, "%c{\"node\":\"%s\"%s%.*s",
+                     batch->count ? ',' : '[', node_id, empty ? "" : ",", body_len, body);
+    if (n < 0 || (size_t)n > room) {
+        return false;
+    }
+    batch->len += (size_t)n;
+    if (batch->count++ == 0) {
+        batch->opened_us = esp_timer_get_time();
+    }
+    return true;
+}
+
+bool mqtt_batch_add(mqtt_batch_t *batch, const char *node_id, const char *json, size_t len) {
+    if (len < 2 || json[0] != '{') {
+        return false;
+    }
+    if (!mqtt_batch_append(batch, node_id, json, len)) {
+        // Не вмістилось - публікуємо накопичене і пробуємо в порожній пакет
+        mqtt_batch_flush(batch);
+        if (!mqtt_batch_append(batch, node_id, json, len)) {
+            batch->buf[batch->len] = '\0';
+            ESP_LOGW(TAG, "Запис вузла %s завеликий для пакета", node_id);
+            return false;
+        }
+    }
+    if (batch->count >= batch->max_msgs) {
+        mqtt_batch_flush(batch);
+    }
+    return true;
+}
+
+uint32_t mqtt_batch_time_left_ms(const mqtt_batch_t *batch) {
+    if (batch->count == 0) {
+        return UINT32_MAX;
+    }
+    int64_t elapsed_ms = (esp_timer_get_time() - batch->opened_us) / 1000;
+    if (elapsed_ms >= batch->window_ms) {
+        return 0;
+    }
+    return batch->window_ms - (uint32_t)elapsed_ms;
+}
+
+void mqtt_batch_poll(mqtt_batch_t *batch) {
+    if (mqtt_batch_time_left_ms(batch) == 0) {
+        mqtt_batch_flush(batch);
+    }
+}
@@ -1,17 +1,30 @@
 #include "mqtt_utils.h"
 #include "esp_log.h"
+#include "binlog.h"
 #include "esp_event.h"
 #include "mqtt_client.h"
+#include <stdio.h>
+#include <string.h>
 
 static const char *TAG = "mqtt_utils";
 static esp_mqtt_client_handle_t client;
+static mqtt_publish_hook_t publish_hook;
+
+/* Підписки, які поновлюються при кожному MQTT_EVENT_CONNECTED */
+static struct {
+    const char *topic;
+    int qos;
+} subscriptions[MQTT_MAX_SUBSCRIPTIONS];
+static int subscription_count;
+
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 
 /*
  * Ініціалізуємо MQTT-клієнт із TLS-з'єднанням
  * broker_uri: URI брокера (наприклад, "mqtts://broker.local:8883")
  * client_id: унікальний ідентифікатор клієнта
  */
-void mqtt_init(const char *broker_uri, const char *client_id) {
+esp_err_t mqtt_init(const char *broker_uri, const char *client_id) {
     esp_mqtt_client_config_t mqtt_cfg = {
         .uri = broker_uri,
         .client_id = client_id,
@@ -23,21 +36,61 @@ void mqtt_init(const char *broker_uri, const char *client_id) {
     client = esp_mqtt_client_init(&mqtt_cfg);
     if (client == NULL) {
         ESP_LOGE(TAG, "Помилка ініціалізації MQTT-клієнта");
-        return;
+        return ESP_FAIL;
     }
 
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
-    esp_mqtt_client_start(client);
+    return esp_mqtt_client_start(client);
+}
+
+void mqtt_register_event_handler(esp_event_handler_t handler) {
+    if (client) {
+        esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, handler, NULL);
+    }
 }
 
 /*
- * mqtt_publish: публікує payload у топік topic з QoS 1
+ * Топік зберігається за вказівником, тому має жити весь час роботи
+ * (рядковий літерал або статичний буфер)
  */
-void mqtt_publish(const char *topic, const char *payload) {
+esp_err_t mqtt_subscribe(const char *topic, int qos) {
+    if (subscription_count >= MQTT_MAX_SUBSCRIPTIONS) {
+        ESP_LOGE(TAG, "Забагато підписок, %s пропущено", topic);
+        return ESP_ERR_NO_MEM;
+    }
+    subscriptions[subscription_count].topic = topic;
+    subscriptions[subscription_count].qos = qos;
+    subscription_count++;
+    // Якщо вже підключені - підписуємось одразу, інакше це зробить
+    // обробник MQTT_EVENT_CONNECTED
     if (client) {
-        int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
-        ESP_LOGI(TAG, "MQTT публікація ID: %d, топік: %s, payload: %s", msg_id, topic, payload);
+        esp_mqtt_client_subscribe(client, topic, qos);
+    }
+    return ESP_OK;
+}
+
+void mqtt_set_publish_hook(mqtt_publish_hook_t hook) {
+    publish_hook = hook;
+}
+
+/*
+ * mqtt_publish: публікує payload у топік topic з QoS 1
+ */
+int mqtt_publish(const char *topic, const char *payload) {
+    return mqtt_publish_len(topic, payload, strlen(payload));
+}
+
+int mqtt_publish_len(const char *topic, const char *payload, size_t len) {
+    if (!client) {
+        return -1;
+    }
+    int msg_id = esp_mqtt_client_publish(client, topic, payload, (int)len, 1, 0);
+    // Без payload: відкладений лог зберігає лише числа і сталі рядки
+    BINLOG_I(TAG, "MQTT публікація ID: %d, %u байт", msg_id, len);
+    if (msg_id >= 0 && publish_hook) {
+        publish_hook(msg_id);
     }
+    return msg_id;
 }
 
 /*
@@ -48,8 +101,10 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch (event_id) {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT підключено");
-            // Можна підписатися на топіки:
-            // esp_mqtt_client_subscribe(client, "home/control/#", 1);
+            // Брокер не зберігає підписки між сесіями - поновлюємо всі
+            for (int i = 0; i < subscription_count; i++) {
+                esp_mqtt_client_subscribe(client, subscriptions[i].topic, subscriptions[i].qos);
+            }
             break;
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "MQTT дані отримано: топік: %.*s, payload: %.*s",
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_codec.h"
+
+/*
+ * Fixed-capacity table of per-node state on the hub, keyed by the node's
+ * extended address (stable across re-attach, unlike the RLOC16).
+ *
+ * Open addressing with linear probing over a power-of-two array; entries
+ * are never removed, so lookups stop at the first empty slot. Inserts are
+ * refused beyond 3/4 load to keep probe sequences short. The table does no
+ * locking: it is owned by the hub's publisher task.
+ *
+ * Nodes that do not send their extended address (legacy JSON frames) are
+ * keyed by NODE_REGISTRY_RLOC_KEY(rloc16) instead.
+ */
+
+#define NODE_REGISTRY_TOPIC_PREFIX   "home/sensors/"
+#define NODE_REGISTRY_ID_LEN         16    // hex digits of a 64-bit key
+
+/**
+ * @brief Pseudo key for nodes known only by RLOC16. Real extended addresses
+ *        never look like this (the all-ones OUI is not assigned).
+ */
+#define NODE_REGISTRY_RLOC_KEY(rloc16)  (0xFFFFFFFFFFFF0000ull | (uint16_t)(rloc16))
+
+/**
+ * @brief State kept for one node.
+ */
+typedef struct {
+    uint64_t          key;            ///< Extended address, 0 = empty slot
+    uint16_t          rloc16;         ///< Last RLOC16 the node sent from
+    bool              seq_valid;
+    uint8_t           last_seq;
+    int64_t           last_seq_ms;    ///< When last_seq was accepted
+    int64_t           last_seen_ms;
+    uint32_t          packets;        ///< Frames accepted
+    uint32_t          duplicates;     ///< Frames suppressed as duplicates
+    uint32_t          errors;         ///< Malformed frames
+    telemetry_frame_t last;           ///< Latest value of every field seen
+    char              id[NODE_REGISTRY_ID_LEN + 1];
+    char              topic[sizeof(NODE_REGISTRY_TOPIC_PREFIX) + NODE_REGISTRY_ID_LEN];
+} node_entry_t;
+
+/**
+ * @brief Registry over caller-provided entry storage.
+ */
+typedef struct {
+    node_entry_t *entries;
+    uint32_t      mask;
+    uint32_t      count;
+    uint32_t      rejected;       ///< Inserts refused because the table is full
+    uint32_t      dup_window_ms;  ///< Repeated seq within this window = duplicate
+} node_registry_t;
+
+/**
+ * @brief Initialize a registry.
+ *
+ * @param capacity       Number of entries, must be a power of two
+ * @param dup_window_ms  A frame repeating the previous sequence number within
+ *                       this time is treated as a duplicate
+ * @return false if @p capacity is not a power of two
+ */
+bool node_registry_init(node_registry_t *reg, node_entry_t *entries, uint32_t capacity,
+                        uint32_t dup_window_ms);
+
+/**
+ * @brief Find the entry for @p key, or NULL if the node is unknown.
+ */
+node_entry_t *node_registry_find(node_registry_t *reg, uint64_t key);
+
+/**
+ * @brief Find the node that last sent from @p rloc16, whatever its key.
+ *
+ * For frames too damaged to carry an identity. A linear scan of the whole
+ * table, so not for the per-frame path. If a re-attach left several entries
+ * with this RLOC16, the one seen most recently wins.
+ *
+ * @return The entry, or NULL if no known node uses @p rloc16
+ */
+node_entry_t *node_registry_find_rloc(node_registry_t *reg, uint16_t rloc16);
+
+/**
+ * @brief Find or create the entry for @p key and record that the node was
+ *        seen from @p rloc16 at @p now_ms.
+ *
+ * @return The entry, or NULL if the node is new and the table is full
+ */
+node_entry_t *node_registry_touch(node_registry_t *reg, uint64_t key, uint16_t rloc16,
+                                  int64_t now_ms);
+
+/**
+ * @brief Account a sequence number; false means the frame is a duplicate
+ *        and should be dropped.
+ */
+bool node_registry_accept_seq(const node_registry_t *reg, node_entry_t *entry,
+                              uint8_t seq, int64_t now_ms);
+
+/**
+ * @brief Merge the fields of @p frame into the node's last values.
+ *
+ * @return Mask of TELEMETRY_F_* fields whose value changed (a field seen
+ *         for the first time counts as changed)
+ */
+uint16_t node_registry_merge(node_entry_t *entry, const telemetry_frame_t *frame);
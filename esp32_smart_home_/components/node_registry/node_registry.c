@@ -0,0 +1,137 @@
+#include "node_registry.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Spread the key over the table; extended addresses of one vendor
+ *        share their upper bytes, so fold in all 64 bits.
+ */
+static uint32_t node_registry_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+bool node_registry_init(node_registry_t *reg, node_entry_t *entries, uint32_t capacity,
+                        uint32_t dup_window_ms)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    memset(entries, 0, capacity * sizeof(*entries));
+    reg->entries       = entries;
+    reg->mask          = capacity - 1;
+    reg->count         = 0;
+    reg->rejected      = 0;
+    reg->dup_window_ms = dup_window_ms;
+    return true;
+}
+
+/**
+ * @brief Slot holding @p key, or the empty slot where it would be inserted.
+ */
+static node_entry_t *node_registry_probe(node_registry_t *reg, uint64_t key)
+{
+    uint32_t i = node_registry_hash(key) & reg->mask;
+    for (;;) {
+        node_entry_t *entry = &reg->entries[i];
+        if (entry->key == key || entry->key == 0) {
+            return entry;
+        }
+        i = (i + 1) & reg->mask;
+    }
+}
+
+node_entry_t *node_registry_find(node_registry_t *reg, uint64_t key)
+{
+    if (key == 0) {
+        return NULL;
+    }
+    node_entry_t *entry = node_registry_probe(reg, key);
+    return entry->key == key ? entry : NULL;
+}
+
+node_entry_t *node_registry_find_rloc(node_registry_t *reg, uint16_t rloc16)
+{
+    node_entry_t *found = NULL;
+    for (uint32_t i = 0; i <= reg->mask; i++) {
+        node_entry_t *entry = &reg->entries[i];
+        if (entry->key != 0 && entry->rloc16 == rloc16
+            && (!found || entry->last_seen_ms > found->last_seen_ms)) {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+node_entry_t *node_registry_touch(node_registry_t *reg, uint64_t key, uint16_t rloc16,
+                                  int64_t now_ms)
+{
+    if (key == 0) {
+        return NULL;
+    }
+    node_entry_t *entry = node_registry_probe(reg, key);
+    if (entry->key == 0) {
+        // Keep at least a quarter of the slots empty so probes terminate fast
+        uint32_t capacity = reg->mask + 1;
+        if (reg->count + 1 > capacity - capacity / 4) {
+            reg->rejected++;
+            return NULL;
+        }
+        entry->key = key;
+        reg->count++;
+
+        // Topic and id are built once here instead of per packet
+        if ((key & 0xFFFFFFFFFFFF0000ull) == NODE_REGISTRY_RLOC_KEY(0)) {
+            snprintf(entry->id, sizeof(entry->id), "%u", (unsigned)(key & 0xFFFF));
+        } else {
+            snprintf(entry->id, sizeof(entry->id), "%016llx", (unsigned long long)key);
+        }
+        snprintf(entry->topic, sizeof(entry->topic), NODE_REGISTRY_TOPIC_PREFIX "%s", entry->id);
+    }
+    entry->rloc16 = rloc16;
+    entry->last_seen_ms = now_ms;
+    return entry;
+}
+
+bool node_registry_accept_seq(const node_registry_t *reg, node_entry_t *entry,
+                              uint8_t seq, int64_t now_ms)
+{
+    if (entry->seq_valid && seq == entry->last_seq
+        && now_ms - entry->last_seq_ms < (int64_t)reg->dup_window_ms) {
+        entry->duplicates++;
+        return false;
+    }
+    entry->seq_valid = true;
+    entry->last_seq = seq;
+    entry->last_seq_ms = now_ms;
+    entry->packets++;
+    return true;
+}
+
+uint16_t node_registry_merge(node_entry_t *entry, const telemetry_frame_t *frame)
+{
+    telemetry_frame_t *last = &entry->last;
+    uint16_t fields = frame->fields;
+    uint16_t changed = fields & ~last->fields;
+
+    if ((fields & TELEMETRY_F_TEMPERATURE) && frame->temperature != last->temperature) changed |= TELEMETRY_F_TEMPERATURE;
+    if ((fields & TELEMETRY_F_HUMIDITY)    && frame->humidity != last->humidity)       changed |= TELEMETRY_F_HUMIDITY;
+    if ((fields & TELEMETRY_F_CO2)         && frame->co2 != last->co2)                 changed |= TELEMETRY_F_CO2;
+    if ((fields & TELEMETRY_F_TVOC)        && frame->tvoc != last->tvoc)               changed |= TELEMETRY_F_TVOC;
+    if ((fields & TELEMETRY_F_LIGHT)       && frame->light != last->light)             changed |= TELEMETRY_F_LIGHT;
+    if ((fields & TELEMETRY_F_FLAGS)       && frame->flags != last->flags)             changed |= TELEMETRY_F_FLAGS;
+    changed &= ~TELEMETRY_F_NODE;
+
+    if (fields & TELEMETRY_F_TEMPERATURE) last->temperature = frame->temperature;
+    if (fields & TELEMETRY_F_HUMIDITY)    last->humidity = frame->humidity;
+    if (fields & TELEMETRY_F_CO2)         last->co2 = frame->co2;
+    if (fields & TELEMETRY_F_TVOC)        last->tvoc = frame->tvoc;
+    if (fields & TELEMETRY_F_LIGHT)       last->light = frame->light;
+    if (fields & TELEMETRY_F_FLAGS)       last->flags = frame->flags;
+    last->fields |= fields & ~TELEMETRY_F_NODE;
+    last->seq = frame->seq;
+    return changed;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_codec.h"
+
+/*
+ * Local automation on the hub: rules that map sensor state to actuator
+ * commands without a round trip through the MQTT broker.
+ *
+ * A rule is a conjunction of up to RULE_ENGINE_MAX_CONDS comparisons of
+ * telemetry fields against constants, plus a pre-encoded actuator_cmd_t
+ * payload and the RLOC16 to send it to. Rules are evaluated against the
+ * node's merged state (node_entry_t.last), so a condition on a field the
+ * current frame does not carry uses the last reported value; a field the
+ * node never reported makes its condition false.
+ *
+ * Rules are edge-triggered: a rule fires when its conditions become true
+ * for a node and is latched to that node until a frame from the same node
+ * makes them false again. A rule with node 0 matches any node.
+ *
+ * Rule tables arrive in binary form (all integers little-endian):
+ *
+ *   [version][rule count]
+ *   per rule:
+ *     [node u64][dest u16][cond count][cmd length]
+ *     cond count × [field][op][value i32]
+ *     cmd length bytes of actuator_cmd_encode() output
+ *
+ * field is the bit index of the TELEMETRY_F_* flag (0 = temperature in
+ * 0.01 °C ... 5 = flags); values use the units of telemetry_frame_t.
+ *
+ * This module only depends on frame_codec and builds on a host.
+ */
+
+#define RULE_ENGINE_VERSION      1
+#define RULE_ENGINE_MAX_RULES    32
+#define RULE_ENGINE_MAX_CONDS    4
+
+/**
+ * @brief Comparison operators. BITS_* test a mask, for the flags field.
+ */
+typedef enum {
+    RULE_OP_LT = 0,         ///< field <  value
+    RULE_OP_GT,             ///< field >  value
+    RULE_OP_EQ,             ///< field == value
+    RULE_OP_NE,             ///< field != value
+    RULE_OP_BITS_SET,       ///< all bits of value set in field
+    RULE_OP_BITS_CLEAR,     ///< no bit of value set in field
+    RULE_OP_COUNT
+} rule_op_t;
+
+/**
+ * @brief One comparison.
+ */
+typedef struct {
+    uint8_t field;          ///< Bit index of a TELEMETRY_F_* flag
+    uint8_t op;             ///< rule_op_t
+    int32_t value;
+} rule_cond_t;
+
+/**
+ * @brief Compiled rule and its trigger state.
+ */
+typedef struct {
+    uint64_t    node;                   ///< Source extended address, 0 = any node
+    uint64_t    latched;                ///< Node that fired the rule, 0 = armed
+    uint16_t    dest;                   ///< RLOC16 of the actuator node
+    uint8_t     cond_count;
+    uint8_t     cmd_len;
+    uint32_t    fired;                  ///< Times the rule fired
+    rule_cond_t conds[RULE_ENGINE_MAX_CONDS];
+    uint8_t     cmd[ACTUATOR_CMD_MAX_LEN];  ///< Encoded actuator command
+} rule_t;
+
+/**
+ * @brief Rule table.
+ */
+typedef struct {
+    uint8_t count;
+    rule_t  rules[RULE_ENGINE_MAX_RULES];
+} rule_table_t;
+
+/**
+ * @brief Action for a rule that fired.
+ *
+ * @param index  Rule index in the table
+ * @param rule   The rule; its dest and cmd/cmd_len are what to send
+ * @param arg    Caller context given to rule_table_eval()
+ */
+typedef void (*rule_action_cb_t)(uint8_t index, const rule_t *rule, void *arg);
+
+/**
+ * @brief Compile a binary rule table into @p table.
+ *
+ * Every rule is validated, including its actuator command; a table with
+ * any invalid rule is rejected as a whole.
+ *
+ * @return false if the table is malformed; @p table is then empty
+ */
+bool rule_table_load(rule_table_t *table, const uint8_t *data, size_t length);
+
+/**
+ * @brief Evaluate the rules that apply to @p node against its state and
+ *        call @p action for each one that fires.
+ *
+ * @param node   Extended address (or registry key) of the reporting node
+ * @param state  Merged telemetry of the node; @c fields tells which
+ *               values are known
+ * @return Number of rules that fired
+ */
+size_t rule_table_eval(rule_table_t *table, uint64_t node, const telemetry_frame_t *state,
+                       rule_action_cb_t action, void *arg);
@@ -0,0 +1,135 @@
+#include "rule_engine.h"
+#include <string.h>
+
+#define RULE_HEADER_LEN   2
+#define RULE_FIXED_LEN    12      // node, dest, cond count, cmd length
+#define RULE_COND_LEN     6
+#define RULE_FIELD_COUNT  6       // TELEMETRY_F_TEMPERATURE .. TELEMETRY_F_FLAGS
+
+static uint32_t get_le(const uint8_t *p, int bytes)
+{
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+bool rule_table_load(rule_table_t *table, const uint8_t *data, size_t length)
+{
+    table->count = 0;
+    if (length < RULE_HEADER_LEN || data[0] != RULE_ENGINE_VERSION
+        || data[1] > RULE_ENGINE_MAX_RULES) {
+        return false;
+    }
+
+    const uint8_t *p = data + RULE_HEADER_LEN;
+    const uint8_t *end = data + length;
+    for (uint8_t i = 0; i < data[1]; i++) {
+        if (end - p < RULE_FIXED_LEN) {
+            return false;
+        }
+        rule_t *rule = &table->rules[i];
+        memset(rule, 0, sizeof(*rule));
+        rule->node       = (uint64_t)get_le(p + 4, 4) << 32 | get_le(p, 4);
+        rule->dest       = (uint16_t)get_le(p + 8, 2);
+        rule->cond_count = p[10];
+        rule->cmd_len    = p[11];
+        p += RULE_FIXED_LEN;
+
+        if (rule->cond_count == 0 || rule->cond_count > RULE_ENGINE_MAX_CONDS
+            || rule->cmd_len > ACTUATOR_CMD_MAX_LEN
+            || (size_t)(end - p) < (size_t)rule->cond_count * RULE_COND_LEN + rule->cmd_len) {
+            return false;
+        }
+        for (uint8_t c = 0; c < rule->cond_count; c++) {
+            rule_cond_t *cond = &rule->conds[c];
+            cond->field = p[0];
+            cond->op    = p[1];
+            cond->value = (int32_t)get_le(p + 2, 4);
+            if (cond->field >= RULE_FIELD_COUNT || cond->op >= RULE_OP_COUNT) {
+                return false;
+            }
+            p += RULE_COND_LEN;
+        }
+
+        // The command is sent as is, so it has to be valid now
+        actuator_cmd_t cmd;
+        if (!actuator_cmd_decode(p, rule->cmd_len, &cmd)) {
+            return false;
+        }
+        memcpy(rule->cmd, p, rule->cmd_len);
+        p += rule->cmd_len;
+    }
+    if (p != end) {
+        return false;
+    }
+    table->count = data[1];
+    return true;
+}
+
+/**
+ * @brief Value of telemetry field @p field (bit index).
+ */
+static int32_t rule_field_value(const telemetry_frame_t *state, uint8_t field)
+{
+    switch (1u << field) {
+    case TELEMETRY_F_TEMPERATURE: return state->temperature;
+    case TELEMETRY_F_HUMIDITY:    return state->humidity;
+    case TELEMETRY_F_CO2:         return state->co2;
+    case TELEMETRY_F_TVOC:        return state->tvoc;
+    case TELEMETRY_F_LIGHT:       return state->light;
+    default:                      return state->flags;
+    }
+}
+
+static bool rule_matches(const rule_t *rule, const telemetry_frame_t *state)
+{
+    for (uint8_t c = 0; c < rule->cond_count; c++) {
+        const rule_cond_t *cond = &rule->conds[c];
+        if (!(state->fields & (1u << cond->field))) {
+            return false;
+        }
+        int32_t v = rule_field_value(state, cond->field);
+        bool ok;
+        switch (cond->op) {
+        case RULE_OP_LT:         ok = v < cond->value; break;
+        case RULE_OP_GT:         ok = v > cond->value; break;
+        case RULE_OP_EQ:         ok = v == cond->value; break;
+        case RULE_OP_NE:         ok = v != cond->value; break;
+        case RULE_OP_BITS_SET:   ok = (v & cond->value) == cond->value; break;
+        default:                 ok = (v & cond->value) == 0; break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t rule_table_eval(rule_table_t *table, uint64_t node, const telemetry_frame_t *state,
+                       rule_action_cb_t action, void *arg)
+{
+    size_t fired = 0;
+    for (uint8_t i = 0; i < table->count; i++) {
+        rule_t *rule = &table->rules[i];
+        if (rule->node != 0 && rule->node != node) {
+            continue;
+        }
+        if (!rule_matches(rule, state)) {
+            // Re-arm once the node that fired the rule is back to normal
+            if (rule->latched == node) {
+                rule->latched = 0;
+            }
+            continue;
+        }
+        if (rule->latched != 0) {
+            continue;
+        }
+        rule->latched = node;
+        rule->fired++;
+        fired++;
+        action(i, rule, arg);
+    }
+    return fired;
+}
@@ -0,0 +1,117 @@
+#include "ccs811.h"
+#include "esp_log.h"
+
+static const char *TAG = "ccs811";
+
+/*
+ * Читає STATUS; при встановленому ERROR запам'ятовує ERROR_ID
+ */
+static esp_err_t ccs811_read_status(ccs811_t *dev, uint8_t *status) {
+    esp_err_t err = dev->bus.read_reg(dev->bus.ctx, CCS811_REG_STATUS, status, 1);
+    if (err != ESP_OK) return err;
+    if (*status & CCS811_STATUS_ERROR) {
+        dev->bus.read_reg(dev->bus.ctx, CCS811_REG_ERROR_ID, &dev->last_error, 1);
+        ESP_LOGW(TAG, "Помилка датчика, ERROR_ID=0x%02X", dev->last_error);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ccs811_init(ccs811_t *dev, const ccs811_bus_t *bus, ccs811_mode_t mode, bool use_int) {
+    dev->bus = *bus;
+    dev->mode = mode;
+    dev->running = false;
+    dev->last_error = 0;
+
+    uint8_t hw_id = 0;
+    esp_err_t err = dev->bus.read_reg(dev->bus.ctx, CCS811_REG_HW_ID, &hw_id, 1);
+    if (err != ESP_OK) return err;
+    if (hw_id != CCS811_HW_ID) {
+        ESP_LOGE(TAG, "Невідомий HW_ID 0x%02X", hw_id);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t status = 0;
+    err = ccs811_read_status(dev, &status);
+    if (err != ESP_OK) return err;
+    if (!(status & CCS811_STATUS_APP_VALID)) {
+        ESP_LOGE(TAG, "Прошивка застосунку відсутня");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Перехід із boot у режим застосунку (запис без даних)
+    if (!(status & CCS811_STATUS_FW_MODE)) {
+        err = dev->bus.write_reg(dev->bus.ctx, CCS811_REG_APP_START, NULL, 0);
+        if (err != ESP_OK) return err;
+        if (dev->bus.delay_us) {
+            dev->bus.delay_us(1000);    // tSTART за специфікацією - до 1 мс
+        }
+        err = ccs811_read_status(dev, &status);
+        if (err != ESP_OK) return err;
+        if (!(status & CCS811_STATUS_FW_MODE)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    uint8_t meas_mode = (uint8_t)((mode & 0x07) << 4) | (use_int ? 0x08 : 0x00);
+    err = dev->bus.write_reg(dev->bus.ctx, CCS811_REG_MEAS_MODE, &meas_mode, 1);
+    if (err != ESP_OK) return err;
+
+    dev->running = true;
+    ESP_LOGI(TAG, "CCS811 запущено, MEAS_MODE=0x%02X", meas_mode);
+    return ESP_OK;
+}
+
+esp_err_t ccs811_data_ready(ccs811_t *dev, bool *ready) {
+    uint8_t status = 0;
+    esp_err_t err = ccs811_read_status(dev, &status);
+    *ready = (err == ESP_OK) && (status & CCS811_STATUS_DATA_READY);
+    return err;
+}
+
+esp_err_t ccs811_read(ccs811_t *dev, uint16_t *co2, uint16_t *tvoc) {
+    if (!dev->running) return ESP_ERR_INVALID_STATE;
+
+    // ALG_RESULT_DATA: [eCO2 hi][eCO2 lo][TVOC hi][TVOC lo][STATUS][ERROR_ID]
+    uint8_t buf[6];
+    esp_err_t err = dev->bus.read_reg(dev->bus.ctx, CCS811_REG_ALG_RESULT_DATA, buf, sizeof(buf));
+    if (err != ESP_OK) return err;
+    if (buf[4] & CCS811_STATUS_ERROR) {
+        dev->last_error = buf[5];
+        ESP_LOGW(TAG, "Помилка датчика, ERROR_ID=0x%02X", dev->last_error);
+        return ESP_FAIL;
+    }
+    if (!(buf[4] & CCS811_STATUS_DATA_READY)) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    *co2 = (buf[0] << 8) | buf[1];
+    *tvoc = (buf[2] << 8) | buf[3];
+    ESP_LOGI(TAG, "CCS811: CO2=%d ppm, TVOC=%d ppb", *co2, *tvoc);
+    return ESP_OK;
+}
+
+esp_err_t ccs811_set_env(ccs811_t *dev, int16_t temperature, uint16_t humidity) {
+    if (!dev->running) return ESP_ERR_INVALID_STATE;
+    if (humidity > 10000) humidity = 10000;
+    if (temperature < -2500) temperature = -2500;
+
+    // ENV_DATA: вологість і (температура + 25 °C) у одиницях 1/512,
+    // перераховані з сотих часток із округленням
+    uint16_t hum = (uint16_t)(((uint32_t)humidity * 512 + 50) / 100);
+    uint16_t temp = (uint16_t)(((uint32_t)(temperature + 2500) * 512 + 50) / 100);
+    uint8_t env[4] = { hum >> 8, hum & 0xFF, temp >> 8, temp & 0xFF };
+    return dev->bus.write_reg(dev->bus.ctx, CCS811_REG_ENV_DATA, env, sizeof(env));
+}
+
+esp_err_t ccs811_get_baseline(ccs811_t *dev, uint16_t *baseline) {
+    uint8_t buf[2];
+    esp_err_t err = dev->bus.read_reg(dev->bus.ctx, CCS811_REG_BASELINE, buf, sizeof(buf));
+    if (err != ESP_OK) return err;
+    *baseline = (buf[0] << 8) | buf[1];
+    return ESP_OK;
+}
+
+esp_err_t ccs811_set_baseline(ccs811_t *dev, uint16_t baseline) {
+    uint8_t buf[2] = { baseline >> 8, baseline & 0xFF };
+    return dev->bus.write_reg(dev->bus.ctx, CCS811_REG_BASELINE, buf, sizeof(buf));
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/*
+ * Драйвер CCS811 зі станом: датчик запускається (APP_START) і
+ * конфігурується один раз, далі працює безперервно, а драйвер лише
+ * перевіряє DATA_READY і читає ALG_RESULT_DATA. Алгоритм датчика не
+ * перезапускається, тож baseline залишається коректним.
+ *
+ * Доступ до шини абстраговано через ccs811_bus_t (запис/читання
+ * регістрів), тому драйвер можна підключити до фейкової моделі
+ * регістрів на хості.
+ */
+
+/* Регістри CCS811 */
+#define CCS811_REG_STATUS           0x00
+#define CCS811_REG_MEAS_MODE        0x01
+#define CCS811_REG_ALG_RESULT_DATA  0x02
+#define CCS811_REG_ENV_DATA         0x05
+#define CCS811_REG_BASELINE         0x11
+#define CCS811_REG_HW_ID            0x20
+#define CCS811_REG_ERROR_ID         0xE0
+#define CCS811_REG_APP_START        0xF4
+#define CCS811_REG_SW_RESET         0xFF
+
+#define CCS811_HW_ID                0x81
+
+/* Біти регістру STATUS */
+#define CCS811_STATUS_ERROR         (1u << 0)
+#define CCS811_STATUS_DATA_READY    (1u << 3)
+#define CCS811_STATUS_APP_VALID     (1u << 4)
+#define CCS811_STATUS_FW_MODE       (1u << 7)
+
+/* Режими вимірювання (DRIVE_MODE у MEAS_MODE[6:4]) */
+typedef enum {
+    CCS811_MODE_IDLE  = 0,
+    CCS811_MODE_1S    = 1,
+    CCS811_MODE_10S   = 2,
+    CCS811_MODE_60S   = 3,
+    CCS811_MODE_250MS = 4,
+} ccs811_mode_t;
+
+/*
+ * Операції шини: запис/читання length байтів починаючи з регістру reg;
+ * delay_us - затримка після APP_START (може бути NULL)
+ */
+typedef struct {
+    esp_err_t (*write_reg)(void *ctx, uint8_t reg, const uint8_t *data, size_t length);
+    esp_err_t (*read_reg)(void *ctx, uint8_t reg, uint8_t *data, size_t length);
+    void      (*delay_us)(uint32_t us);
+    void *ctx;
+} ccs811_bus_t;
+
+typedef struct {
+    ccs811_bus_t  bus;
+    ccs811_mode_t mode;
+    bool          running;      // APP_START і MEAS_MODE вже виконано
+    uint8_t       last_error;   // вміст ERROR_ID при останній помилці
+} ccs811_t;
+
+/*
+ * ccs811_init: перевіряє HW_ID, запускає застосунок датчика і задає режим.
+ * Викликається один раз після старту; use_int вмикає nINT на DATA_READY
+ */
+esp_err_t ccs811_init(ccs811_t *dev, const ccs811_bus_t *bus, ccs811_mode_t mode, bool use_int);
+
+/*
+ * ccs811_data_ready: true, якщо є нове вимірювання
+ */
+esp_err_t ccs811_data_ready(ccs811_t *dev, bool *ready);
+
+/*
+ * ccs811_read: читає eCO2 (ppm) і TVOC (ppb). Повертає
+ * ESP_ERR_NOT_FINISHED, якщо нових даних ще немає
+ */
+esp_err_t ccs811_read(ccs811_t *dev, uint16_t *co2, uint16_t *tvoc);
+
+/*
+ * ccs811_set_env: компенсація за температурою (0.01 °C) і вологістю (0.01 %RH)
+ */
+esp_err_t ccs811_set_env(ccs811_t *dev, int16_t temperature, uint16_t humidity);
+
+/*
+ * ccs811_get_baseline / ccs811_set_baseline: збереження та відновлення
+ * baseline алгоритму (наприклад, через NVS між перезавантаженнями)
+ */
+esp_err_t ccs811_get_baseline(ccs811_t *dev, uint16_t *baseline);
+esp_err_t ccs811_set_baseline(ccs811_t *dev, uint16_t baseline);
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_utils.h"
+
+/*
+ * Планувальник звітів «за зміною» для вузла-датчика.
+ *
+ * Кожен канал має власний період опитування, зону нечутливості
+ * (deadband) і максимальний інтервал heartbeat. Значення надсилається,
+ * лише якщо воно змінилося більше ніж на deadband від останнього
+ * надісланого або якщо минув heartbeat. Значення каналів - цілі у
+ * одиницях кадру телеметрії (соті частки для T/H, 0/1 для подій).
+ *
+ * Логіка не звертається до апаратури: час передається явно у мс.
+ */
+
+typedef struct {
+    uint32_t sample_period_ms;  // як часто опитувати канал
+    int32_t  deadband;          // зміна > deadband => звіт (0 - будь-яка зміна)
+    uint32_t heartbeat_ms;      // максимальний інтервал між звітами каналу
+} report_channel_cfg_t;
+
+typedef struct {
+    report_channel_cfg_t cfg[SENSOR_CH_COUNT];
+    int32_t  last_sent[SENSOR_CH_COUNT];
+    int64_t  last_sent_ms[SENSOR_CH_COUNT];
+    int64_t  next_sample_ms[SENSOR_CH_COUNT];
+    uint32_t sent_mask;         // канали, що вже надсилалися хоча б раз
+} report_sched_t;
+
+/*
+ * report_sched_init: копіює конфігурацію; усі канали опитуються одразу
+ */
+void report_sched_init(report_sched_t *sched, const report_channel_cfg_t cfg[SENSOR_CH_COUNT], int64_t now_ms);
+
+/*
+ * report_sched_due: маска каналів (SENSOR_VALID_*), які час опитати
+ */
+uint32_t report_sched_due(const report_sched_t *sched, int64_t now_ms);
+
+/*
+ * report_sched_evaluate: обробляє нові значення каналів із маски sampled
+ * (values індексується sensor_channel_t), планує наступне опитування і
+ * повертає маску каналів, які слід надіслати
+ */
+uint32_t report_sched_evaluate(report_sched_t *sched, int64_t now_ms,
+                               const int32_t values[SENSOR_CH_COUNT], uint32_t sampled);
+
+/*
+ * report_sched_mark_sent: фіксує надіслані значення каналів із маски sent
+ */
+void report_sched_mark_sent(report_sched_t *sched, int64_t now_ms,
+                            const int32_t values[SENSOR_CH_COUNT], uint32_t sent);
+
+/*
+ * report_sched_next_ms: через скільки мс настане наступне опитування
+ */
+uint32_t report_sched_next_ms(const report_sched_t *sched, int64_t now_ms);
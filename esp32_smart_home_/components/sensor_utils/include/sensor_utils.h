@@ -3,11 +3,90 @@
 #include <stdbool.h>
 #include <esp_err.h>
 
+/*
+ * Канали вимірювань вузла-датчика
+ */
+typedef enum {
+    SENSOR_CH_TEMPERATURE = 0,
+    SENSOR_CH_HUMIDITY,
+    SENSOR_CH_CO2,
+    SENSOR_CH_TVOC,
+    SENSOR_CH_LIGHT,
+    SENSOR_CH_MOTION,
+    SENSOR_CH_LEAK,
+    SENSOR_CH_COUNT
+} sensor_channel_t;
+
+/*
+ * Прапорці валідності полів sensor_snapshot_t (біт = номер каналу);
+ * ті самі маски використовуються для вибору каналів для опитування
+ */
+#define SENSOR_VALID_TEMPERATURE    (1u << SENSOR_CH_TEMPERATURE)
+#define SENSOR_VALID_HUMIDITY       (1u << SENSOR_CH_HUMIDITY)
+#define SENSOR_VALID_CO2            (1u << SENSOR_CH_CO2)
+#define SENSOR_VALID_TVOC           (1u << SENSOR_CH_TVOC)
+#define SENSOR_VALID_LIGHT          (1u << SENSOR_CH_LIGHT)
+#define SENSOR_VALID_MOTION         (1u << SENSOR_CH_MOTION)
+#define SENSOR_VALID_LEAK           (1u << SENSOR_CH_LEAK)
+#define SENSOR_VALID_ALL            ((1u << SENSOR_CH_COUNT) - 1)
+
+/* Входи подій; LP GPIO, тож придатні і для пробудження з deep sleep */
+#define SENSOR_PIR_GPIO             10 /*!< Вхід PIR-датчика руху (активний 1) */
+#define SENSOR_LEAK_GPIO            11 /*!< Вхід датчика витоку (активний 1) */
+
+/*
+ * Колбек подій PIR/витоку; викликається з контексту переривання,
+ * channels - маска SENSOR_VALID_MOTION / SENSOR_VALID_LEAK
+ */
+typedef void (*sensor_event_isr_t)(uint32_t channels, void *arg);
+
+/*
+ * Узгоджений знімок усіх датчиків за один цикл опитування;
+ * поле має зміст лише якщо встановлено відповідний біт у valid
+ */
+typedef struct {
+    uint32_t valid;
+    int16_t  temperature;   // 0.01 °C
+    uint16_t humidity;      // 0.01 %RH
+    uint16_t co2;           // ppm
+    uint16_t tvoc;          // ppb
+    uint16_t light;         // lx
+    bool     motion;
+    bool     leak;
+} sensor_snapshot_t;
+
 /*
  * Ініціалізує I2C для сенсорів, повертає ESP_OK/ESP_ERR
  */
 esp_err_t sensor_i2c_init(void);
 
+/*
+ * Ініціалізує I2C із частотою clk_hz (100000 або 400000 - Fast Mode).
+ * AM2320 за специфікацією підтримує лише 100 кГц
+ */
+esp_err_t sensor_i2c_init_freq(uint32_t clk_hz);
+
+/*
+ * sensor_read_all: зчитує кожен датчик рівно один раз (AM2320 - однією
+ * I2C-транзакцією для температури і вологості). Перетворення всіх
+ * датчиків запускаються одночасно, тож цикл триває стільки, скільки
+ * найповільніший датчик. Повертає ESP_OK, якщо
+ * всі поля валідні, інакше ESP_FAIL (валідні поля все одно заповнені)
+ */
+esp_err_t sensor_read_all(sensor_snapshot_t *snapshot);
+
+/*
+ * sensor_read_channels: як sensor_read_all, але опитує лише датчики,
+ * що покривають канали з маски channels (SENSOR_VALID_*)
+ */
+esp_err_t sensor_read_channels(sensor_snapshot_t *snapshot, uint32_t channels);
+
+/*
+ * sensor_gpio_init: налаштовує входи PIR і датчика витоку з перериванням
+ * на будь-який фронт; isr_cb (може бути NULL) отримує маску каналів
+ */
+esp_err_t sensor_gpio_init(sensor_event_isr_t isr_cb, void *arg);
+
 /*
  * read_light: зчитує освітленість у люксах (BH1750)
  */
@@ -29,11 +108,11 @@ float read_humidity(void);
 uint16_t read_co2(void);
 
 /*
- * read_motion: повертає true, якщо виявлено рух (PIR, реалізація залежить від GPIO)
+ * read_motion: повертає true, якщо виявлено рух (PIR)
  */
 bool read_motion(void);
 
 /*
- * read_leak: повертає true, якщо виявлено витік води (реалізація GPIO)
+ * read_leak: повертає true, якщо виявлено витік води
  */
 bool read_leak(void);
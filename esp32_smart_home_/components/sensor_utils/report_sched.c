@@ -0,0 +1,65 @@
+#include "report_sched.h"
+
+void report_sched_init(report_sched_t *sched, const report_channel_cfg_t cfg[SENSOR_CH_COUNT], int64_t now_ms) {
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        sched->cfg[ch] = cfg[ch];
+        sched->last_sent[ch] = 0;
+        sched->last_sent_ms[ch] = now_ms;
+        sched->next_sample_ms[ch] = now_ms;
+    }
+    sched->sent_mask = 0;
+}
+
+uint32_t report_sched_due(const report_sched_t *sched, int64_t now_ms) {
+    uint32_t due = 0;
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        if (now_ms >= sched->next_sample_ms[ch]) {
+            due |= 1u << ch;
+        }
+    }
+    return due;
+}
+
+uint32_t report_sched_evaluate(report_sched_t *sched, int64_t now_ms,
+                               const int32_t values[SENSOR_CH_COUNT], uint32_t sampled) {
+    uint32_t report = 0;
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        uint32_t bit = 1u << ch;
+        if (!(sampled & bit)) {
+            continue;
+        }
+        const report_channel_cfg_t *cfg = &sched->cfg[ch];
+        sched->next_sample_ms[ch] = now_ms + cfg->sample_period_ms;
+
+        int32_t delta = values[ch] - sched->last_sent[ch];
+        if (delta < 0) delta = -delta;
+        bool first = !(sched->sent_mask & bit);
+        bool changed = delta > cfg->deadband;
+        bool heartbeat = now_ms - sched->last_sent_ms[ch] >= cfg->heartbeat_ms;
+        if (first || changed || heartbeat) {
+            report |= bit;
+        }
+    }
+    return report;
+}
+
+void report_sched_mark_sent(report_sched_t *sched, int64_t now_ms,
+                            const int32_t values[SENSOR_CH_COUNT], uint32_t sent) {
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        if (sent & (1u << ch)) {
+            sched->last_sent[ch] = values[ch];
+            sched->last_sent_ms[ch] = now_ms;
+        }
+    }
+    sched->sent_mask |= sent;
+}
+
+uint32_t report_sched_next_ms(const report_sched_t *sched, int64_t now_ms) {
+    int64_t next = sched->next_sample_ms[0];
+    for (int ch = 1; ch < SENSOR_CH_COUNT; ch++) {
+        if (sched->next_sample_ms[ch] < next) {
+            next = sched->next_sample_ms[ch];
+        }
+    }
+    return next > now_ms ? (uint32_t)(next - now_ms) : 0;
+}
@@ -1,22 +1,39 @@
 #include "sensor_utils.h"
+#include "ccs811.h"
+#include "crc_utils.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
 #include <math.h>
 
 static const char *TAG = "sensor_utils";
 
 #define I2C_MASTER_SCL_IO           22 /*!< GPIO номер SCL порту */
 #define I2C_MASTER_SDA_IO           21 /*!< GPIO номер SDA порту */
-#define I2C_MASTER_FREQ_HZ          100000 /*!< Частота I2C */
+#define I2C_MASTER_FREQ_HZ          100000 /*!< Частота I2C за замовчуванням */
 #define I2C_MASTER_NUM              I2C_NUM_0 /*!< I2C порт */
 
 #define BH1750_SENSOR_ADDR          0x23 /*!< Адреса BH1750 */
 #define AM2320_SENSOR_ADDR          0x5C /*!< Адреса AM2320 */
 #define CCS811_SENSOR_ADDR          0x5A /*!< Адреса CCS811 */
 
-#define BH1750_CMD_START            0x10 /*!< Команда старту вимірювання (H-Resolution Mode) */
+#define BH1750_CMD_START            0x20 /*!< Одноразове вимірювання (One-Time H-Resolution Mode) */
 
-static esp_err_t i2c_master_init(void) {
+/* Час перетворення після старту, мс */
+#define AM2320_CONVERSION_MS        2
+#define BH1750_CONVERSION_MS        180
+#define CCS811_CONVERSION_MS        0   /* безперервний режим, лише перевірка DATA_READY */
+#define AM2320_WAKE_US              800 /* пауза між пробудженням AM2320 і командою */
+
+static ccs811_t s_ccs811;
+static sensor_event_isr_t s_event_cb;
+static void *s_event_arg;
+
+static esp_err_t i2c_master_init(uint32_t clk_hz) {
     int i2c_master_port = I2C_MASTER_NUM;
     i2c_config_t conf = {
         .mode = I2C_MODE_MASTER,
@@ -24,88 +41,329 @@ static esp_err_t i2c_master_init(void) {
         .scl_io_num = I2C_MASTER_SCL_IO,
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        .master.clk_speed = clk_hz,
     };
     esp_err_t err = i2c_param_config(i2c_master_port, &conf);
     if (err != ESP_OK) return err;
-    return i2c_driver_install(i2C_MASTER_NUM, I2C_MODE_MASTER, 0, 0, 0);
+    return i2c_driver_install(I2C_MASTER_NUM, I2C_MODE_MASTER, 0, 0, 0);
 }
 
 /*
- * read_bh1750: зчитує освітленість у люксах
+ * Очікування до моменту deadline_us (esp_timer): довгі інтервали - сном
+ * задачі, залишок менше одного тіку - активним очікуванням
  */
-uint16_t read_light(void) {
+static void wait_until(int64_t deadline_us) {
+    const int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    int64_t remaining;
+    while ((remaining = deadline_us - esp_timer_get_time()) > 0) {
+        if (remaining > tick_us) {
+            vTaskDelay((TickType_t)(remaining / tick_us));
+        } else {
+            esp_rom_delay_us((uint32_t)remaining);
+        }
+    }
+}
+
+/*
+ * Сон задачі щонайменше us мікросекунд без активного очікування:
+ * vTaskDelay(n) може повернутися одразу на початку першого тіку,
+ * тому береться на один тік більше
+ */
+static void sleep_at_least_us(uint32_t us) {
+    const uint32_t tick_us = (uint32_t)portTICK_PERIOD_MS * 1000;
+    vTaskDelay((TickType_t)((us + tick_us - 1) / tick_us + 1));
+}
+
+/*
+ * bh1750_start / bh1750_collect: одноразове вимірювання освітленості
+ */
+static esp_err_t bh1750_start(void) {
+    uint8_t cmd = BH1750_CMD_START;
+    return i2c_master_write_to_device(I2C_MASTER_NUM, BH1750_SENSOR_ADDR, &cmd, 1, 1000 / portTICK_RATE_MS);
+}
+
+static esp_err_t bh1750_collect(uint16_t *lux) {
     uint8_t data[2] = {0};
-    // Ініціюємо зчитування
-    i2c_master_write_to_device(I2C_MASTER_NUM, BH1750_SENSOR_ADDR, (uint8_t*)&BH1750_CMD_START, 1, 1000 / portTICK_RATE_MS);
-    vTaskDelay(pdMS_TO_TICKS(180)); // Час вимірювання ~180ms
-    // Читаємо два байти даних
-    i2c_master_read_from_device(I2C_MASTER_NUM, BH1750_SENSOR_ADDR, data, 2, 1000 / portTICK_RATE_MS);
+    esp_err_t err = i2c_master_read_from_device(I2C_MASTER_NUM, BH1750_SENSOR_ADDR, data, 2, 1000 / portTICK_RATE_MS);
+    if (err != ESP_OK) return err;
     uint16_t raw = (data[0] << 8) | data[1];
-    uint16_t lux = raw / 1.2; // Переведення у люкси
-    ESP_LOGI(TAG, "BH1750: освітленість: %d lx", lux);
+    *lux = (uint16_t)(((uint32_t)raw * 10 + 6) / 12); // raw / 1.2 з округленням, без float
+    ESP_LOGI(TAG, "BH1750: освітленість: %d lx", *lux);
+    return ESP_OK;
+}
+
+/*
+ * read_light: зчитує освітленість у люксах (0 при помилці)
+ */
+uint16_t read_light(void) {
+    uint16_t lux = 0;
+    if (bh1750_start() == ESP_OK) {
+        wait_until(esp_timer_get_time() + BH1750_CONVERSION_MS * 1000);
+        bh1750_collect(&lux);
+    }
     return lux;
 }
 
 /*
- * read_am2320: зчитує температуру та вологість
- * повертає температуру через вказівник temp,
+ * am2320_start / am2320_collect: температура та вологість однією
+ * транзакцією; повертає температуру через вказівник temp,
  * та вологість через вказівник hum
  */
-static esp_err_t read_am2320(float *temp, float *hum) {
-    uint8_t cmd[2] = {0x03, 0x00}; // Команда читання даних
-    // Запит 4 байти від регістру 0
-    cmd[1] = 0x04;
-    // Затримка перед роботою датчика
-    vTaskDelay(pdMS_TO_TICKS(2));
-    i2c_master_write_to_device(I2C_MASTER_NUM, AM2320_SENSOR_ADDR, cmd, 2, 1000 / portTICK_RATE_MS);
-    vTaskDelay(pdMS_TO_TICKS(2));
+static esp_err_t am2320_start(void) {
+    // Датчик спить між вимірюваннями і не підтверджує (NACK) першу
+    // транзакцію: запис-пробудження лише будить його, помилку ігноруємо
+    uint8_t wake = 0x00;
+    i2c_master_write_to_device(I2C_MASTER_NUM, AM2320_SENSOR_ADDR, &wake, 1, 1000 / portTICK_RATE_MS);
+    sleep_at_least_us(AM2320_WAKE_US);
+
+    uint8_t cmd[3] = {0x03, 0x00, 0x04}; // Читання 4 байтів від регістру 0
+    return i2c_master_write_to_device(I2C_MASTER_NUM, AM2320_SENSOR_ADDR, cmd, 3, 1000 / portTICK_RATE_MS);
+}
+
+static esp_err_t am2320_collect(int16_t *temp, uint16_t *hum) {
     uint8_t data[8];
-    i2c_master_read_from_device(I2C_MASTER_NUM, AM2320_SENSOR_ADDR, data, 8, 1000 / portTICK_RATE_MS);
-    // Перевірка CRC пропущено
-    *hum = ((data[2] << 8) | data[3]) / 10.0f;
-    *temp = (((data[4] & 0x7F) << 8) | data[5]) / 10.0f;
+    esp_err_t err = i2c_master_read_from_device(I2C_MASTER_NUM, AM2320_SENSOR_ADDR, data, 8, 1000 / portTICK_RATE_MS);
+    if (err != ESP_OK) return err;
+    // Відповідь: [0x03][0x04][H hi][H lo][T hi][T lo][CRC lo][CRC hi]
+    uint16_t crc = data[6] | (data[7] << 8);
+    if (data[0] != 0x03 || data[1] != 0x04 || crc != compute_crc16_modbus(data, 6)) {
+        ESP_LOGW(TAG, "AM2320: некоректна відповідь або CRC");
+        return ESP_ERR_INVALID_CRC;
+    }
+    // Датчик віддає десяті частки; у знімку - соті, як у кадрі телеметрії
+    *hum = (uint16_t)(((data[2] << 8) | data[3]) * 10);
+    *temp = (int16_t)((((data[4] & 0x7F) << 8) | data[5]) * 10);
     if (data[4] & 0x80) *temp = -*temp;
-    ESP_LOGI(TAG, "AM2320: T=%.2f °C, H=%.2f %%", *temp, *hum);
+    ESP_LOGI(TAG, "AM2320: T=%d (0.01 °C), H=%u (0.01 %%)", *temp, *hum);
     return ESP_OK;
 }
 
+static esp_err_t read_am2320(int16_t *temp, uint16_t *hum) {
+    esp_err_t err = am2320_start();
+    if (err != ESP_OK) return err;
+    wait_until(esp_timer_get_time() + AM2320_CONVERSION_MS * 1000);
+    return am2320_collect(temp, hum);
+}
+
 /*
- * Ініціалізація CCS811 - зчитує дані IAQ
- * (реалізовано базове - початкове налаштування)
- */
-static esp_err_t read_ccs811(uint16_t *co2, uint16_t *tvoc) {
-    // Ініціалізація сенсора CCS811
-    uint8_t init_cmd[2] = {0xF4, 0x00}; // Режим Idle
-    i2c_master_write_to_device(I2C_MASTER_NUM, CCS811_SENSOR_ADDR, init_cmd, 2, 1000 / portTICK_RATE_MS);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    // Встановлюємо режим вимірювання 1х/сек
-    uint8_t meas_mode = 0x10; // DriveMode=1
-    i2c_master_write_to_device(I2C_MASTER_NUM, CCS811_SENSOR_ADDR, &meas_mode, 1, 1000 / portTICK_RATE_MS);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    // Зчитуємо дані
-    uint8_t buf[8];
-    i2c_master_read_from_device(I2C_MASTER_NUM, CCS811_SENSOR_ADDR, buf, 8, 1000 / portTICK_RATE_MS);
-    *co2 = (buf[0] << 8) | buf[1];
-    *tvoc = (buf[2] << 8) | buf[3];
-    ESP_LOGI(TAG, "CCS811: CO2=%d ppm, TVOC=%d ppb", *co2, *tvoc);
-    return ESP_OK;
+ * Операції шини I2C для драйвера CCS811
+ */
+static esp_err_t ccs811_i2c_write(void *ctx, uint8_t reg, const uint8_t *data, size_t length) {
+    uint8_t buf[1 + 8];
+    if (length > sizeof(buf) - 1) return ESP_ERR_INVALID_SIZE;
+    buf[0] = reg;
+    for (size_t i = 0; i < length; i++) {
+        buf[1 + i] = data[i];
+    }
+    return i2c_master_write_to_device(I2C_MASTER_NUM, CCS811_SENSOR_ADDR, buf, 1 + length, 1000 / portTICK_RATE_MS);
+}
+
+static esp_err_t ccs811_i2c_read(void *ctx, uint8_t reg, uint8_t *data, size_t length) {
+    return i2c_master_write_read_device(I2C_MASTER_NUM, CCS811_SENSOR_ADDR, &reg, 1, data, length, 1000 / portTICK_RATE_MS);
+}
+
+static const ccs811_bus_t s_ccs811_bus = {
+    .write_reg = ccs811_i2c_write,
+    .read_reg  = ccs811_i2c_read,
+    .delay_us  = esp_rom_delay_us,
+    .ctx       = NULL,
+};
+
+/*
+ * Одноразовий запуск CCS811: режим 1 вимірювання/сек, далі датчик
+ * працює безперервно між циклами опитування
+ */
+static esp_err_t sensor_ccs811_init(void) {
+    esp_err_t err = ccs811_init(&s_ccs811, &s_ccs811_bus, CCS811_MODE_1S, false);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CCS811 недоступний (%s)", esp_err_to_name(err));
+    }
+    return err;
+}
+
+/*
+ * Планувальник I2C-транзакцій: кожен датчик описано стартом перетворення,
+ * часом перетворення та збором результату у знімок
+ */
+typedef struct {
+    const char *name;
+    uint32_t    conversion_ms;
+    uint32_t    valid_bits;
+    esp_err_t (*start)(void);       // NULL - датчик вимірює безперервно
+    esp_err_t (*collect)(sensor_snapshot_t *snapshot);
+} i2c_job_t;
+
+static esp_err_t job_am2320_collect(sensor_snapshot_t *snapshot) {
+    esp_err_t err = am2320_collect(&snapshot->temperature, &snapshot->humidity);
+    if (err == ESP_OK && s_ccs811.running) {
+        // Компенсація CCS811 за свіжими температурою та вологістю
+        ccs811_set_env(&s_ccs811, snapshot->temperature, snapshot->humidity);
+    }
+    return err;
+}
+
+static esp_err_t job_bh1750_collect(sensor_snapshot_t *snapshot) {
+    return bh1750_collect(&snapshot->light);
+}
+
+static esp_err_t job_ccs811_collect(sensor_snapshot_t *snapshot) {
+    return ccs811_read(&s_ccs811, &snapshot->co2, &snapshot->tvoc);
+}
+
+// Старти йдуть у порядку таблиці: BH1750 першим, щоб його довге
+// перетворення перекрило паузу пробудження AM2320
+static const i2c_job_t s_i2c_jobs[] = {
+    { "BH1750", BH1750_CONVERSION_MS, SENSOR_VALID_LIGHT,
+      bh1750_start, job_bh1750_collect },
+    { "AM2320", AM2320_CONVERSION_MS, SENSOR_VALID_TEMPERATURE | SENSOR_VALID_HUMIDITY,
+      am2320_start, job_am2320_collect },
+    { "CCS811", CCS811_CONVERSION_MS, SENSOR_VALID_CO2 | SENSOR_VALID_TVOC,
+      NULL, job_ccs811_collect },
+};
+
+#define I2C_JOB_COUNT (sizeof(s_i2c_jobs) / sizeof(s_i2c_jobs[0]))
+
+/*
+ * Запускає всі перетворення одразу і збирає результати у порядку
+ * дедлайнів: цикл триває max(час перетворення), а не їх суму
+ */
+static void i2c_run_jobs(sensor_snapshot_t *snapshot, uint32_t channels) {
+    int64_t deadline_us[I2C_JOB_COUNT];
+    bool pending[I2C_JOB_COUNT];
+    int64_t cycle_start = esp_timer_get_time();
+
+    // 1. Старт усіх перетворень
+    for (size_t i = 0; i < I2C_JOB_COUNT; i++) {
+        if (!(s_i2c_jobs[i].valid_bits & channels)) {
+            pending[i] = false;     // канал зараз не опитується
+            continue;
+        }
+        pending[i] = !s_i2c_jobs[i].start || s_i2c_jobs[i].start() == ESP_OK;
+        deadline_us[i] = esp_timer_get_time() + (int64_t)s_i2c_jobs[i].conversion_ms * 1000;
+        if (!pending[i]) {
+            ESP_LOGW(TAG, "%s: помилка старту вимірювання", s_i2c_jobs[i].name);
+        }
+    }
+
+    // 2. Збір результатів, найближчий дедлайн першим
+    while (true) {
+        int next = -1;
+        for (size_t i = 0; i < I2C_JOB_COUNT; i++) {
+            if (pending[i] && (next < 0 || deadline_us[i] < deadline_us[next])) {
+                next = (int)i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        wait_until(deadline_us[next]);
+        if (s_i2c_jobs[next].collect(snapshot) == ESP_OK) {
+            snapshot->valid |= s_i2c_jobs[next].valid_bits;
+        }
+        pending[next] = false;
+    }
+
+    ESP_LOGI(TAG, "Цикл I2C: %lld мкс", (long long)(esp_timer_get_time() - cycle_start));
 }
 
 /*
  * Ініціалізація I2C і повернення ESP_OK/ESP_ERR
  */
 esp_err_t sensor_i2c_init(void) {
-    return i2c_master_init();
+    return sensor_i2c_init_freq(I2C_MASTER_FREQ_HZ);
+}
+
+/*
+ * Ініціалізація I2C із заданою частотою (наприклад, 400 кГц)
+ */
+esp_err_t sensor_i2c_init_freq(uint32_t clk_hz) {
+    esp_err_t err = i2c_master_init(clk_hz);
+    if (err != ESP_OK) return err;
+    // Відсутній CCS811 не є фатальним: його поля просто будуть невалідні
+    sensor_ccs811_init();
+    return ESP_OK;
+}
+
+/*
+ * sensor_read_channels: один прохід по вибраних датчиках у спільний знімок
+ */
+esp_err_t sensor_read_channels(sensor_snapshot_t *snapshot, uint32_t channels) {
+    *snapshot = (sensor_snapshot_t){0};
+
+    i2c_run_jobs(snapshot, channels);
+    // GPIO-входи дешеві - читаємо обидва, якщо запитано хоча б один
+    if (channels & (SENSOR_VALID_MOTION | SENSOR_VALID_LEAK)) {
+        snapshot->motion = read_motion();
+        snapshot->leak = read_leak();
+        snapshot->valid |= SENSOR_VALID_MOTION | SENSOR_VALID_LEAK;
+    }
+
+    return (snapshot->valid & channels) == (channels & SENSOR_VALID_ALL) ? ESP_OK : ESP_FAIL;
+}
+
+/*
+ * sensor_read_all: один прохід по всіх датчиках
+ */
+esp_err_t sensor_read_all(sensor_snapshot_t *snapshot) {
+    return sensor_read_channels(snapshot, SENSOR_VALID_ALL);
+}
+
+/*
+ * Переривання від PIR / датчика витоку: лише передає маску каналу
+ */
+static void IRAM_ATTR sensor_gpio_isr(void *arg) {
+    uint32_t channel = (uint32_t)(uintptr_t)arg;
+    if (s_event_cb) {
+        s_event_cb(channel, s_event_arg);
+    }
+}
+
+/*
+ * sensor_gpio_init: входи PIR і витоку з перериванням на будь-який фронт
+ */
+esp_err_t sensor_gpio_init(sensor_event_isr_t isr_cb, void *arg) {
+    s_event_cb = isr_cb;
+    s_event_arg = arg;
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << SENSOR_PIR_GPIO) | (1ULL << SENSOR_LEAK_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) return err;
+
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return err;  // вже встановлено
+    gpio_isr_handler_add(SENSOR_PIR_GPIO, sensor_gpio_isr, (void *)(uintptr_t)SENSOR_VALID_MOTION);
+    gpio_isr_handler_add(SENSOR_LEAK_GPIO, sensor_gpio_isr, (void *)(uintptr_t)SENSOR_VALID_LEAK);
+    return ESP_OK;
+}
+
+/*
+ * read_motion: рівень входу PIR
+ */
+bool read_motion(void) {
+    return gpio_get_level(SENSOR_PIR_GPIO) != 0;
+}
+
+/*
+ * read_leak: рівень входу датчика витоку
+ */
+bool read_leak(void) {
+    return gpio_get_level(SENSOR_LEAK_GPIO) != 0;
 }
 
 /*
  * read_temperature: викликає read_am2320, повертає температуру
  */
 float read_temperature(void) {
-    float temp = 0.0f, hum = 0.0f;
+    int16_t temp = 0;
+    uint16_t hum = 0;
     if (read_am2320(&temp, &hum) == ESP_OK) {
-        return temp;
+        return temp / 100.0f;
     }
     return NAN;
 }
@@ -114,9 +372,10 @@ float read_temperature(void) {
  * read_humidity: повертає вологість
  */
 float read_humidity(void) {
-    float temp = 0.0f, hum = 0.0f;
+    int16_t temp = 0;
+    uint16_t hum = 0;
     if (read_am2320(&temp, &hum) == ESP_OK) {
-        return hum;
+        return hum / 100.0f;
     }
     return NAN;
 }
@@ -126,6 +385,6 @@ float read_humidity(void) {
  */
 uint16_t read_co2(void) {
     uint16_t co2 = 0, tvoc = 0;
-    read_ccs811(&co2, &tvoc);
+    ccs811_read(&s_ccs811, &co2, &tvoc);
     return co2;
 }
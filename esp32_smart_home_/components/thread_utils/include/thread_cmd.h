@@ -0,0 +1,159 @@
+#ifndef THREAD_CMD_H
+#define THREAD_CMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * Reliable command transport over thread_send().
+ *
+ * A command frame is [FRAME_TYPE_CMD][epoch][seq][payload][crc8] and is
+ * answered by [FRAME_TYPE_ACK][epoch][seq][status][crc8], with a 16-bit
+ * little-endian epoch. The sender numbers commands per
+ * destination, keeps them in an in-flight table and retransmits with
+ * exponential backoff until the ACK arrives or the attempts run out, so
+ * every command ends in exactly one completion event within
+ * THREAD_CMD_RTO_MS * (2^THREAD_CMD_MAX_ATTEMPTS - 1) of its first
+ * transmission: with the defaults it is resent 200, 400, 800 and 1600 ms
+ * after the previous try and times out 3200 ms after the last one.
+ *
+ * Only one command per destination is on the air at a time; further ones
+ * wait in the in-flight table and go out, in order, when it completes.
+ * The receiver runs each command once: a retransmission of the last
+ * epoch and sequence number is answered with the cached status without
+ * executing the command again.
+ *
+ * The sender keeps the numbering of each destination in a table of
+ * THREAD_CMD_MAX_PEERS entries and gives every new entry a new epoch, so
+ * a sequence restarted by a reboot or by evicting the entry does not
+ * match the last command the receiver remembers. Epochs come from a
+ * counter seeded at random at boot. Received commands are tracked in a
+ * separate table, so incoming traffic never evicts sender state.
+ *
+ * A command that takes time to carry out (e.g. a servo move) can defer its
+ * ACK: the handler returns THREAD_CMD_STATUS_PENDING and calls
+ * thread_cmd_complete() when done. Retransmissions that arrive meanwhile
+ * are not answered, so the work must finish within the sender's
+ * retransmission budget.
+ *
+ * Group commands ([FRAME_TYPE_GROUP_CMD][epoch][seq][group] + payload) go out as
+ * one multicast to thread_send_group(), so every member acts on the same
+ * transmission. Each group has its own sequence space, and receivers keep
+ * duplicate state per (sender, group). The sender is given the members it
+ * expects and tracks them individually:
+ *   - members answer with a unicast [FRAME_TYPE_GROUP_ACK], delayed by a
+ *     random 0..THREAD_CMD_GROUP_ACK_SPREAD_MS so the ACKs of a large
+ *     group do not collide;
+ *   - once the first RTO (plus the spread) expires, the frame is resent
+ *     by unicast only to members that have not answered, with the usual
+ *     backoff;
+ *   - every member produces its own completion event (ACKED or TIMEOUT),
+ *     with @c group set.
+ */
+
+#define THREAD_CMD_MAX_PAYLOAD   96      ///< Command payload bytes
+#define THREAD_CMD_MAX_INFLIGHT  8       ///< Unacknowledged and queued commands
+#define THREAD_CMD_MAX_PEERS     16      ///< Destinations, and senders, with sequence state
+#define THREAD_CMD_RTO_MS        200     ///< First retransmit timeout
+#define THREAD_CMD_MAX_ATTEMPTS  5       ///< Transmissions before giving up
+#define THREAD_CMD_GROUP_MAX_MEMBERS  16   ///< Members tracked per group command
+#define THREAD_CMD_GROUP_ACK_SPREAD_MS 100 ///< Random delay of immediate group ACKs
+
+#define THREAD_CMD_STATUS_PENDING 0xFE   ///< Handler result: ACK comes from thread_cmd_complete()
+
+/**
+ * @brief How a command ended.
+ */
+typedef enum {
+    THREAD_CMD_ACKED = 0,   ///< ACK received; see @ref thread_cmd_event_t.status
+    THREAD_CMD_TIMEOUT,     ///< No ACK after THREAD_CMD_MAX_ATTEMPTS transmissions
+} thread_cmd_result_t;
+
+/**
+ * @brief Command completion event.
+ */
+typedef struct {
+    uint16_t            dest_id;    ///< RLOC16 the command was sent to (group member)
+    uint16_t            group;      ///< Group of a group command, 0 for unicast
+    uint8_t             seq;
+    thread_cmd_result_t result;
+    uint8_t             status;     ///< Receiver's status code (ACKED only)
+    uint8_t             attempts;   ///< Transmissions made
+    uint32_t            rtt_us;     ///< First transmission to ACK (ACKED only)
+} thread_cmd_event_t;
+
+/**
+ * @brief Completion callback (sender side). Called from the OpenThread task
+ *        for ACKs and from the esp_timer task for timeouts; must not block.
+ */
+typedef void (*thread_cmd_done_cb_t)(const thread_cmd_event_t *event);
+
+/**
+ * @brief Command handler (receiver side). Runs on the OpenThread task.
+ *
+ * @param group  Group the command was sent to, 0 for unicast
+ * @param seq    Sequence number; with @p src_id and @p group it names the
+ *               command for a later thread_cmd_complete()
+ * @return Status code sent back in the ACK, or THREAD_CMD_STATUS_PENDING
+ */
+typedef uint8_t (*thread_cmd_handler_t)(uint16_t src_id, uint16_t group, uint8_t seq,
+                                        const uint8_t *payload, size_t length);
+
+/**
+ * @brief Initialize the transport. Either callback may be NULL on a node
+ *        that only sends or only receives commands.
+ */
+esp_err_t thread_cmd_init(thread_cmd_done_cb_t done_cb, thread_cmd_handler_t handler);
+
+/**
+ * @brief Send a command and track it until it is acknowledged or times out.
+ *
+ * @param dest_id  RLOC16 of the destination
+ * @param payload  Command payload
+ * @param length   Payload bytes, at most THREAD_CMD_MAX_PAYLOAD
+ * @param seq      Receives the assigned sequence number (may be NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE or ESP_ERR_NO_MEM if the in-flight
+ *         table is full
+ */
+esp_err_t thread_cmd_send(uint16_t dest_id, const uint8_t *payload, size_t length, uint8_t *seq);
+
+/**
+ * @brief Multicast a command to a group and track the ACK of each member.
+ *
+ * @param group         Group number, 1..0xFFFF
+ * @param members       RLOC16 of every node expected to answer
+ * @param member_count  1..THREAD_CMD_GROUP_MAX_MEMBERS
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_SIZE or
+ *         ESP_ERR_NO_MEM if the in-flight table is full
+ */
+esp_err_t thread_cmd_send_group(uint16_t group, const uint16_t *members, size_t member_count,
+                                const uint8_t *payload, size_t length, uint8_t *seq);
+
+/**
+ * @brief Send the deferred ACK of a command whose handler returned
+ *        THREAD_CMD_STATUS_PENDING. Safe to call from any task.
+ *
+ * Nothing is sent once a newer command from the same sender and group has
+ * arrived: the ACK needs the epoch kept with the receive state, and the
+ * sender has given up on this command by then.
+ *
+ * @param src_id  RLOC16 the command came from
+ * @param group   Group passed to the handler, 0 for unicast
+ * @param seq     Sequence number passed to the handler
+ * @param status  Final status code
+ */
+void thread_cmd_complete(uint16_t src_id, uint16_t group, uint8_t seq, uint8_t status);
+
+/**
+ * @brief Feed a received frame to the transport.
+ *
+ * @param src_id  RLOC16 of the sender
+ * @param data    Frame bytes without the CRC, which the caller has checked
+ * @param length  Number of bytes in @p data
+ * @return true if the frame was a command or ACK and has been consumed
+ */
+bool thread_cmd_handle_rx(uint16_t src_id, const uint8_t *data, size_t length);
+
+#endif // THREAD_CMD_H
@@ -3,22 +3,79 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+/**
+ * @brief Receive buffer size. The IPv6 MTU bounds any UDP payload that
+ *        OpenThread can deliver, so frames are never truncated.
+ */
+#define THREAD_BUF_SIZE   1280
+
+/**
+ * @brief Number of receive buffers in the pool.
+ */
+#ifndef THREAD_BUF_COUNT
+#define THREAD_BUF_COUNT  8
+#endif
+
+/**
+ * @brief Refcounted receive buffer, filled once from the otMessage.
+ *
+ * The receive callback borrows the buffer for the duration of the call.
+ * A consumer that keeps it longer (e.g. queues it for another task) takes
+ * its own reference with thread_buf_retain() and drops it with
+ * thread_buf_release(); the buffer returns to the pool with the last one.
+ */
+typedef struct thread_buf {
+    uint16_t           src_id;   ///< RLOC16 of the sender
+    uint16_t           length;   ///< Payload bytes in @ref data
+    uint32_t           rx_us;    ///< Arrival time, low 32 bits of esp_timer_get_time()
+    _Atomic uint32_t   refs;     ///< Reference count, managed by thread_utils
+    struct thread_buf *next;     ///< Free-list link, managed by thread_utils
+    uint8_t            data[THREAD_BUF_SIZE];
+} thread_buf_t;
+
+/**
+ * @brief Take an additional reference to a receive buffer.
+ */
+void thread_buf_retain(thread_buf_t *buf);
+
+/**
+ * @brief Drop a reference; the last one returns the buffer to the pool.
+ *        Safe to call from any task.
+ */
+void thread_buf_release(thread_buf_t *buf);
 
 /**
  * @brief Initialize the OpenThread stack and UDP socket.
+ *
+ * @return ESP_OK on success
  */
-void thread_init(void);
+esp_err_t thread_init(void);
+
+/**
+ * @brief Start the OpenThread mainloop task.
+ *
+ * The task sleeps until radio or tasklet work is pending, so there is no
+ * need to poll thread_process(). Receive callbacks run on this task.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t thread_start_mainloop(void);
 
 /**
  * @brief Register a callback for incoming Thread messages.
  *
- * @param cb  Function to be called on receive: (data, length, src_rloc16)
+ * @param cb  Function to be called on receive with a borrowed buffer;
+ *            runs on the OpenThread task
  */
-typedef void (*thread_rx_cb_t)(const uint8_t *data, size_t length, uint16_t src_id);
+typedef void (*thread_rx_cb_t)(thread_buf_t *buf);
 void thread_register_receive_cb(thread_rx_cb_t cb);
 
 /**
- * @brief Send a raw buffer over Thread.
+ * @brief Send a raw buffer over Thread. Safe to call from any task.
  *
  * @param data     Pointer to the payload bytes
  * @param length   Number of bytes to send
@@ -26,10 +83,63 @@ void thread_register_receive_cb(thread_rx_cb_t cb);
  */
 void thread_send(const uint8_t *data, size_t length, uint16_t dest_id);
 
+/**
+ * @brief Subscribe to a multicast group.
+ *
+ * Groups are realm-local multicast addresses ff03::5348:<group>, so a
+ * single transmission reaches every subscribed rx-on node in the mesh.
+ * OpenThread bounds the number of subscriptions
+ * (OPENTHREAD_CONFIG_IP6_MAX_EXT_MCAST_ADDRS).
+ *
+ * @param group  Group number, 1..0xFFFF
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for group 0, ESP_ERR_NO_MEM if the
+ *         subscription table is full
+ */
+esp_err_t thread_group_join(uint16_t group);
+
+/**
+ * @brief Unsubscribe from a multicast group.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for group 0, ESP_ERR_NOT_FOUND if
+ *         not subscribed
+ */
+esp_err_t thread_group_leave(uint16_t group);
+
+/**
+ * @brief Send a raw buffer to every member of a multicast group. Safe to
+ *        call from any task. Delivery is unacknowledged; see thread_cmd
+ *        for the reliable variant.
+ *
+ * @param group  Group number, 1..0xFFFF
+ */
+void thread_send_group(const uint8_t *data, size_t length, uint16_t group);
+
 /**
  * @brief Process any pending Thread tasklets and radio events.
- *        Must be called periodically from main loop.
+ *        Polling alternative to thread_start_mainloop(); do not mix both.
  */
 void thread_process(void);
 
+/**
+ * @brief Check whether the node is attached to a Thread partition
+ *        (child, router or leader).
+ */
+bool thread_is_attached(void);
+
+/**
+ * @brief IEEE 802.15.4 extended address of this node, first byte most
+ *        significant. Unlike the RLOC16 it does not change on re-attach.
+ *
+ * @return The address, or 0 if Thread is not initialized
+ */
+uint64_t thread_get_ext_addr(void);
+
+/**
+ * @brief Run as a sleepy end device: the radio is off between data polls
+ *        to the parent instead of listening continuously.
+ *
+ * @param poll_period_ms  Parent data-poll period, 0 keeps the stack default
+ */
+void thread_set_sleepy(uint32_t poll_period_ms);
+
 #endif // THREAD_UTILS_H
\ No newline at end of file
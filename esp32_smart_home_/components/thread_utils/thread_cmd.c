@@ -0,0 +1,752 @@
+#include "thread_cmd.h"
+#include "thread_utils.h"
+#include "frame_codec.h"
+#include "crc_utils.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "thread_cmd";
+
+#define THREAD_CMD_HEADER_LEN        4   ///< [type][epoch lo][epoch hi][seq]
+#define THREAD_CMD_GROUP_HEADER_LEN  6   ///< ... + [group lo][group hi]
+#define THREAD_CMD_FRAME_MAX         (THREAD_CMD_GROUP_HEADER_LEN + THREAD_CMD_MAX_PAYLOAD + 1)
+#define THREAD_CMD_GROUP_TX_ID       0xFFFE  ///< Peer ID of our own group sequence numbers
+#define THREAD_CMD_MAX_DELAYED_ACKS  4
+
+/**
+ * @brief Sequence space of one destination: a node, or a group under
+ *        THREAD_CMD_GROUP_TX_ID. Each new entry gets a new epoch.
+ */
+typedef struct {
+    bool     used;
+    uint16_t id;
+    uint16_t group;
+    uint16_t epoch;
+    uint8_t  seq;           ///< Next sequence number to send
+} cmd_tx_peer_t;
+
+/**
+ * @brief Last command executed from one sender, or one group of a sender.
+ */
+typedef struct {
+    bool     used;
+    uint16_t id;
+    uint16_t group;
+    uint16_t epoch;
+    uint8_t  seq;
+    uint8_t  status;        ///< THREAD_CMD_STATUS_PENDING until it is known
+} cmd_rx_peer_t;
+
+/**
+ * @brief Command waiting for its ACK, or queued behind an earlier command
+ *        to the same destination; the frame is kept ready to (re)send.
+ */
+typedef struct {
+    bool     used;
+    bool     queued;        ///< Not sent yet, see cmd_submit()
+    uint16_t dest_id;
+    uint16_t group;         ///< 0 for unicast
+    uint16_t epoch;
+    uint8_t  seq;
+    uint8_t  attempts;
+    uint8_t  member_count;
+    uint16_t acked;         ///< Bit i: members[i] has answered
+    uint16_t members[THREAD_CMD_GROUP_MAX_MEMBERS];
+    int64_t  first_tx_us;
+    int64_t  deadline_us;
+    size_t   length;
+    uint8_t  frame[THREAD_CMD_FRAME_MAX];
+} cmd_inflight_t;
+
+_Static_assert(THREAD_CMD_GROUP_MAX_MEMBERS <= 16, "acked is a 16-bit mask");
+_Static_assert(THREAD_CMD_MAX_PEERS > THREAD_CMD_MAX_INFLIGHT,
+               "some sender entry must be idle when one is evicted");
+
+/**
+ * @brief Group ACK held back by a random delay.
+ */
+typedef struct {
+    bool     used;
+    uint16_t dest_id;
+    uint16_t group;
+    uint16_t epoch;
+    uint8_t  seq;
+    uint8_t  status;
+    int64_t  due_us;
+} cmd_ack_t;
+
+static cmd_tx_peer_t        s_tx_peers[THREAD_CMD_MAX_PEERS];
+static uint32_t             s_tx_victim;
+static uint16_t             s_next_epoch;
+static cmd_rx_peer_t        s_rx_peers[THREAD_CMD_MAX_PEERS];
+static uint32_t             s_rx_victim;
+static cmd_inflight_t       s_inflight[THREAD_CMD_MAX_INFLIGHT];
+static cmd_ack_t            s_acks[THREAD_CMD_MAX_DELAYED_ACKS];
+static SemaphoreHandle_t    s_lock;
+static esp_timer_handle_t   s_retx_timer;
+static thread_cmd_done_cb_t s_done_cb;
+static thread_cmd_handler_t s_handler;
+
+/**
+ * @brief Whether a command to the destination of @p peer is in flight or
+ *        queued. Called with s_lock held.
+ */
+static bool cmd_tx_peer_busy(const cmd_tx_peer_t *peer)
+{
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT; i++) {
+        const cmd_inflight_t *cmd = &s_inflight[i];
+        if (cmd->used && cmd->group == peer->group
+            && (peer->group || cmd->dest_id == peer->id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Find or create the sequence space for destination @p id and
+ *        @p group (0 for unicast). Called with s_lock held.
+ *
+ * When the table is full an idle entry is evicted round-robin; one with
+ * commands in flight keeps its numbering until they complete.
+ */
+static cmd_tx_peer_t *cmd_tx_peer_get(uint16_t id, uint16_t group)
+{
+    for (int i = 0; i < THREAD_CMD_MAX_PEERS; i++) {
+        if (s_tx_peers[i].used && s_tx_peers[i].id == id && s_tx_peers[i].group == group) {
+            return &s_tx_peers[i];
+        }
+    }
+    cmd_tx_peer_t *peer = NULL;
+    for (int i = 0; i < THREAD_CMD_MAX_PEERS && !peer; i++) {
+        if (!s_tx_peers[i].used) {
+            peer = &s_tx_peers[i];
+        }
+    }
+    while (!peer) {
+        cmd_tx_peer_t *victim = &s_tx_peers[s_tx_victim++ % THREAD_CMD_MAX_PEERS];
+        if (!cmd_tx_peer_busy(victim)) {
+            peer = victim;
+        }
+    }
+    // The receiver may still hold the last (epoch, seq) of an evicted entry
+    // or of our previous boot; a new epoch keeps the restarted numbering
+    // out of its duplicate filter
+    *peer = (cmd_tx_peer_t){
+        .used  = true,
+        .id    = id,
+        .group = group,
+        .epoch = s_next_epoch++,
+        .seq   = (uint8_t)esp_random(),
+    };
+    return peer;
+}
+
+/**
+ * @brief Entry of sender @p id and @p group, or NULL. Called with s_lock
+ *        held.
+ */
+static cmd_rx_peer_t *cmd_rx_peer_find(uint16_t id, uint16_t group)
+{
+    for (int i = 0; i < THREAD_CMD_MAX_PEERS; i++) {
+        if (s_rx_peers[i].used && s_rx_peers[i].id == id && s_rx_peers[i].group == group) {
+            return &s_rx_peers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief New entry for sender @p id and @p group, evicting round-robin when
+ *        the table is full. Commands still waiting for thread_cmd_complete()
+ *        are passed over while any other entry can go. Called with s_lock
+ *        held.
+ */
+static cmd_rx_peer_t *cmd_rx_peer_new(uint16_t id, uint16_t group)
+{
+    cmd_rx_peer_t *peer = NULL;
+    for (int i = 0; i < THREAD_CMD_MAX_PEERS && !peer; i++) {
+        if (!s_rx_peers[i].used) {
+            peer = &s_rx_peers[i];
+        }
+    }
+    for (int i = 0; i < THREAD_CMD_MAX_PEERS && !peer; i++) {
+        cmd_rx_peer_t *victim = &s_rx_peers[s_rx_victim++ % THREAD_CMD_MAX_PEERS];
+        if (victim->status != THREAD_CMD_STATUS_PENDING) {
+            peer = victim;
+        }
+    }
+    if (!peer) {
+        peer = &s_rx_peers[s_rx_victim++ % THREAD_CMD_MAX_PEERS];
+    }
+    *peer = (cmd_rx_peer_t){ .used = true, .id = id, .group = group };
+    return peer;
+}
+
+/**
+ * @brief Re-arm the timer for the earliest retransmit or delayed ACK.
+ *        Called with s_lock held.
+ */
+static void cmd_arm_timer(void)
+{
+    int64_t earliest = INT64_MAX;
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT; i++) {
+        if (s_inflight[i].used && s_inflight[i].deadline_us < earliest) {
+            earliest = s_inflight[i].deadline_us;
+        }
+    }
+    for (int i = 0; i < THREAD_CMD_MAX_DELAYED_ACKS; i++) {
+        if (s_acks[i].used && s_acks[i].due_us < earliest) {
+            earliest = s_acks[i].due_us;
+        }
+    }
+    esp_timer_stop(s_retx_timer);
+    if (earliest != INT64_MAX) {
+        int64_t delay = earliest - esp_timer_get_time();
+        esp_timer_start_once(s_retx_timer, delay > 0 ? (uint64_t)delay : 1);
+    }
+}
+
+/**
+ * @brief Send [ACK][epoch][seq][status][crc] to @p dest_id, or the group
+ *        form [GROUP_ACK][epoch][seq][group][status][crc] if @p group is set.
+ */
+static void cmd_send_ack(uint16_t dest_id, uint16_t group, uint16_t epoch, uint8_t seq,
+                         uint8_t status)
+{
+    uint8_t ack[THREAD_CMD_GROUP_HEADER_LEN + 2];
+    size_t len = 0;
+    ack[len++] = group ? FRAME_TYPE_GROUP_ACK : FRAME_TYPE_ACK;
+    ack[len++] = (uint8_t)(epoch & 0xFF);
+    ack[len++] = (uint8_t)(epoch >> 8);
+    ack[len++] = seq;
+    if (group) {
+        ack[len++] = (uint8_t)(group & 0xFF);
+        ack[len++] = (uint8_t)(group >> 8);
+    }
+    ack[len++] = status;
+    ack[len] = compute_crc8(ack, len);
+    thread_send(ack, len + 1, dest_id);
+}
+
+/**
+ * @brief Completion event for one destination of an in-flight command.
+ */
+static thread_cmd_event_t cmd_event(const cmd_inflight_t *cmd, uint16_t dest_id,
+                                    thread_cmd_result_t result, uint8_t status)
+{
+    return (thread_cmd_event_t){
+        .dest_id  = dest_id,
+        .group    = cmd->group,
+        .seq      = cmd->seq,
+        .result   = result,
+        .status   = status,
+        .attempts = cmd->attempts,
+        .rtt_us   = result == THREAD_CMD_ACKED
+                    ? (uint32_t)(esp_timer_get_time() - cmd->first_tx_us) : 0,
+    };
+}
+
+/**
+ * @brief Whether @p a and @p b go to the same unicast destination or group.
+ */
+static bool cmd_same_dest(const cmd_inflight_t *a, const cmd_inflight_t *b)
+{
+    return a->group == b->group && (a->group || a->dest_id == b->dest_id);
+}
+
+/**
+ * @brief Start the first transmission of @p cmd. Called with s_lock held;
+ *        the caller sends the frame after releasing it.
+ */
+static void cmd_start(cmd_inflight_t *cmd)
+{
+    // Group members hold their ACKs back by up to the spread
+    int64_t rto_us = (int64_t)THREAD_CMD_RTO_MS * 1000;
+    if (cmd->group) {
+        rto_us += (int64_t)THREAD_CMD_GROUP_ACK_SPREAD_MS * 1000;
+    }
+    cmd->queued      = false;
+    cmd->first_tx_us = esp_timer_get_time();
+    cmd->deadline_us = cmd->first_tx_us + rto_us;
+    cmd->attempts    = 1;
+}
+
+/**
+ * @brief After @p done has completed, start the oldest command queued for
+ *        the same destination and copy it to @p out. Called with s_lock
+ *        held.
+ *
+ * @return true if a command was started
+ */
+static bool cmd_start_next(const cmd_inflight_t *done, cmd_inflight_t *out)
+{
+    cmd_inflight_t *next = NULL;
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT; i++) {
+        cmd_inflight_t *cmd = &s_inflight[i];
+        if (!cmd->used || !cmd->queued || !cmd_same_dest(cmd, done)) {
+            continue;
+        }
+        // Sequence numbers of one destination are handed out in order
+        if (!next || (uint8_t)(cmd->seq - done->seq) < (uint8_t)(next->seq - done->seq)) {
+            next = cmd;
+        }
+    }
+    if (!next) {
+        return false;
+    }
+    cmd_start(next);
+    *out = *next;
+    return true;
+}
+
+/**
+ * @brief First transmission of a command: one multicast for a group, so
+ *        every member acts on the same frame. Call without s_lock.
+ */
+static void cmd_transmit(const cmd_inflight_t *cmd)
+{
+    if (cmd->group) {
+        thread_send_group(cmd->frame, cmd->length, cmd->group);
+    } else {
+        thread_send(cmd->frame, cmd->length, cmd->dest_id);
+    }
+}
+
+/**
+ * @brief Send due delayed ACKs, retransmit expired commands and fail those
+ *        out of attempts.
+ *
+ * Frames are sent after s_lock is released: thread_send() takes the
+ * OpenThread lock, and the ACK path takes s_lock while holding it.
+ */
+static void cmd_retx_timer_cb(void *arg)
+{
+    (void)arg;
+
+    // esp_timer task only; a group command can expire for all its members
+    static thread_cmd_event_t expired[THREAD_CMD_MAX_INFLIGHT * THREAD_CMD_GROUP_MAX_MEMBERS];
+    int n_expired = 0;
+    static cmd_inflight_t resend[THREAD_CMD_MAX_INFLIGHT];
+    int n_resend = 0;
+    static cmd_inflight_t started[THREAD_CMD_MAX_INFLIGHT];
+    int n_started = 0;
+    cmd_ack_t acks[THREAD_CMD_MAX_DELAYED_ACKS];
+    int n_acks = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < THREAD_CMD_MAX_DELAYED_ACKS; i++) {
+        if (s_acks[i].used && s_acks[i].due_us <= now) {
+            acks[n_acks++] = s_acks[i];
+            s_acks[i].used = false;
+        }
+    }
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT; i++) {
+        cmd_inflight_t *cmd = &s_inflight[i];
+        if (!cmd->used || cmd->deadline_us > now) {
+            continue;
+        }
+        if (cmd->attempts >= THREAD_CMD_MAX_ATTEMPTS) {
+            if (!cmd->group) {
+                expired[n_expired++] = cmd_event(cmd, cmd->dest_id, THREAD_CMD_TIMEOUT, 0);
+            }
+            for (int m = 0; m < cmd->member_count; m++) {
+                if (!(cmd->acked & (1u << m))) {
+                    expired[n_expired++] = cmd_event(cmd, cmd->members[m], THREAD_CMD_TIMEOUT, 0);
+                }
+            }
+            cmd->used = false;
+            if (cmd_start_next(cmd, &started[n_started])) {
+                n_started++;
+            }
+            continue;
+        }
+        // Exponential backoff: RTO, 2*RTO, 4*RTO, ...
+        cmd->deadline_us = now + ((int64_t)THREAD_CMD_RTO_MS * 1000 << cmd->attempts);
+        cmd->attempts++;
+        resend[n_resend++] = *cmd;
+    }
+    cmd_arm_timer();
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; i < n_acks; i++) {
+        cmd_send_ack(acks[i].dest_id, acks[i].group, acks[i].epoch, acks[i].seq,
+                     acks[i].status);
+    }
+
+    for (int i = 0; i < n_resend; i++) {
+        const cmd_inflight_t *cmd = &resend[i];
+        if (!cmd->group) {
+            ESP_LOGW(TAG, "Retransmit #%u of cmd %u to 0x%04x",
+                     cmd->attempts, cmd->seq, cmd->dest_id);
+            thread_send(cmd->frame, cmd->length, cmd->dest_id);
+            continue;
+        }
+        // Only the members that have not answered get the repeat, by unicast
+        for (int m = 0; m < cmd->member_count; m++) {
+            if (!(cmd->acked & (1u << m))) {
+                ESP_LOGW(TAG, "Retransmit #%u of group %u cmd %u to 0x%04x",
+                         cmd->attempts, cmd->group, cmd->seq, cmd->members[m]);
+                thread_send(cmd->frame, cmd->length, cmd->members[m]);
+            }
+        }
+    }
+
+    for (int i = 0; i < n_started; i++) {
+        cmd_transmit(&started[i]);
+    }
+
+    for (int i = 0; i < n_expired; i++) {
+        ESP_LOGW(TAG, "Cmd %u to 0x%04x timed out", expired[i].seq, expired[i].dest_id);
+        if (s_done_cb) {
+            s_done_cb(&expired[i]);
+        }
+    }
+}
+
+esp_err_t thread_cmd_init(thread_cmd_done_cb_t done_cb, thread_cmd_handler_t handler)
+{
+    s_done_cb = done_cb;
+    s_handler = handler;
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+        s_next_epoch = (uint16_t)esp_random();
+    }
+    if (!s_retx_timer) {
+        esp_timer_create_args_t args = {
+            .callback = cmd_retx_timer_cb,
+            .name     = "cmd_retx",
+        };
+        esp_err_t err = esp_timer_create(&args, &s_retx_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Build the frame of a unicast (@p group 0) or group command, enter
+ *        it in the in-flight table and send it.
+ *
+ * Only one command per destination (node or group) is on the air at a
+ * time; later ones wait in the table until it is acknowledged or times
+ * out. The receiver only remembers the last sequence number it executed,
+ * so a retransmission of an older command arriving after a newer one
+ * would otherwise run again and undo it.
+ */
+static esp_err_t cmd_submit(uint16_t dest_id, uint16_t group, const uint16_t *members,
+                            size_t member_count, const uint8_t *payload, size_t length,
+                            uint8_t *seq)
+{
+    if (length > THREAD_CMD_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    cmd_inflight_t first;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cmd_inflight_t *cmd = NULL;
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT && !cmd; i++) {
+        if (!s_inflight[i].used) {
+            cmd = &s_inflight[i];
+        }
+    }
+    if (!cmd) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "In-flight table full, cmd to 0x%04x/group %u rejected", dest_id, group);
+        return ESP_ERR_NO_MEM;
+    }
+
+    cmd_tx_peer_t *peer = group ? cmd_tx_peer_get(THREAD_CMD_GROUP_TX_ID, group)
+                                : cmd_tx_peer_get(dest_id, 0);
+    *cmd = (cmd_inflight_t){
+        .used         = true,
+        .dest_id      = dest_id,
+        .group        = group,
+        .epoch        = peer->epoch,
+        .seq          = peer->seq++,
+        .member_count = (uint8_t)member_count,
+    };
+    if (member_count) {
+        memcpy(cmd->members, members, member_count * sizeof(members[0]));
+    }
+
+    size_t header = THREAD_CMD_HEADER_LEN;
+    cmd->frame[0] = group ? FRAME_TYPE_GROUP_CMD : FRAME_TYPE_CMD;
+    cmd->frame[1] = (uint8_t)(cmd->epoch & 0xFF);
+    cmd->frame[2] = (uint8_t)(cmd->epoch >> 8);
+    cmd->frame[3] = cmd->seq;
+    if (group) {
+        cmd->frame[4] = (uint8_t)(group & 0xFF);
+        cmd->frame[5] = (uint8_t)(group >> 8);
+        header = THREAD_CMD_GROUP_HEADER_LEN;
+    }
+    memcpy(&cmd->frame[header], payload, length);
+    cmd->length = header + length;
+    cmd->frame[cmd->length] = compute_crc8(cmd->frame, cmd->length);
+    cmd->length++;
+    if (seq) {
+        *seq = cmd->seq;
+    }
+
+    bool busy = false;
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT && !busy; i++) {
+        const cmd_inflight_t *other = &s_inflight[i];
+        busy = other != cmd && other->used && cmd_same_dest(other, cmd);
+    }
+    if (busy) {
+        // Started by cmd_start_next() when the one ahead of it completes
+        cmd->queued      = true;
+        cmd->deadline_us = INT64_MAX;
+        xSemaphoreGive(s_lock);
+        ESP_LOGD(TAG, "Cmd %u to 0x%04x/group %u queued", cmd->seq, dest_id, group);
+        return ESP_OK;
+    }
+    cmd_start(cmd);
+    first = *cmd;
+    cmd_arm_timer();
+    xSemaphoreGive(s_lock);
+
+    // Outside s_lock, see cmd_retx_timer_cb()
+    cmd_transmit(&first);
+    return ESP_OK;
+}
+
+esp_err_t thread_cmd_send(uint16_t dest_id, const uint8_t *payload, size_t length, uint8_t *seq)
+{
+    return cmd_submit(dest_id, 0, NULL, 0, payload, length, seq);
+}
+
+esp_err_t thread_cmd_send_group(uint16_t group, const uint16_t *members, size_t member_count,
+                                const uint8_t *payload, size_t length, uint8_t *seq)
+{
+    if (group == 0 || member_count == 0 || member_count > THREAD_CMD_GROUP_MAX_MEMBERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return cmd_submit(0, group, members, member_count, payload, length, seq);
+}
+
+/**
+ * @brief Complete the in-flight command (or group member) matching an ACK.
+ */
+static void cmd_handle_ack(uint16_t src_id, uint16_t group, uint16_t epoch, uint8_t seq,
+                           uint8_t status)
+{
+    thread_cmd_event_t event;
+    bool found = false;
+    cmd_inflight_t next;
+    bool started = false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < THREAD_CMD_MAX_INFLIGHT && !found; i++) {
+        cmd_inflight_t *cmd = &s_inflight[i];
+        if (!cmd->used || cmd->queued || cmd->group != group
+            || cmd->epoch != epoch || cmd->seq != seq) {
+            continue;
+        }
+        if (!group) {
+            if (cmd->dest_id != src_id) {
+                continue;
+            }
+            event = cmd_event(cmd, src_id, THREAD_CMD_ACKED, status);
+            cmd->used = false;
+            found = true;
+        }
+        for (int m = 0; m < cmd->member_count && !found; m++) {
+            if (cmd->members[m] == src_id && !(cmd->acked & (1u << m))) {
+                event = cmd_event(cmd, src_id, THREAD_CMD_ACKED, status);
+                cmd->acked |= 1u << m;
+                cmd->used = cmd->acked != (1u << cmd->member_count) - 1;
+                found = true;
+            }
+        }
+        if (found && !cmd->used) {
+            started = cmd_start_next(cmd, &next);
+        }
+    }
+    if (found) {
+        cmd_arm_timer();
+    }
+    xSemaphoreGive(s_lock);
+
+    if (started) {
+        cmd_transmit(&next);
+    }
+
+    if (!found) {
+        // Late ACK for a retransmitted or timed-out command, or from a
+        // node that was not listed as a group member
+        ESP_LOGD(TAG, "Unmatched ACK %u from 0x%04x", seq, src_id);
+        return;
+    }
+    if (s_done_cb) {
+        s_done_cb(&event);
+    }
+}
+
+/**
+ * @brief ACK a group command after a random delay, so members do not all
+ *        answer at once. Falls back to sending now when no slot is free.
+ */
+static void cmd_queue_group_ack(uint16_t dest_id, uint16_t group, uint16_t epoch, uint8_t seq,
+                                uint8_t status)
+{
+    bool queued = false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < THREAD_CMD_MAX_DELAYED_ACKS && !queued; i++) {
+        if (!s_acks[i].used) {
+            s_acks[i] = (cmd_ack_t){
+                .used    = true,
+                .dest_id = dest_id,
+                .group   = group,
+                .epoch   = epoch,
+                .seq     = seq,
+                .status  = status,
+                .due_us  = esp_timer_get_time()
+                           + esp_random() % (THREAD_CMD_GROUP_ACK_SPREAD_MS * 1000),
+            };
+            queued = true;
+            cmd_arm_timer();
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (!queued) {
+        cmd_send_ack(dest_id, group, epoch, seq, status);
+    }
+}
+
+/**
+ * @brief Run a command once and ACK it; repeats of the last epoch and
+ *        sequence number only get the cached status.
+ */
+static void cmd_handle_cmd(uint16_t src_id, uint16_t group, uint16_t epoch, uint8_t seq,
+                           const uint8_t *payload, size_t length)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cmd_rx_peer_t *peer = cmd_rx_peer_find(src_id, group);
+    bool duplicate = peer && peer->epoch == epoch && peer->seq == seq;
+    uint8_t status = duplicate ? peer->status : 0;
+    if (!duplicate) {
+        // Marked pending before the handler runs, so a thread_cmd_complete()
+        // from another task can never arrive before the entry exists
+        if (!peer) {
+            peer = cmd_rx_peer_new(src_id, group);
+        }
+        peer->epoch  = epoch;
+        peer->seq    = seq;
+        peer->status = THREAD_CMD_STATUS_PENDING;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (duplicate) {
+        if (status == THREAD_CMD_STATUS_PENDING) {
+            ESP_LOGD(TAG, "Cmd %u from 0x%04x still in progress", seq, src_id);
+            return;
+        }
+        ESP_LOGI(TAG, "Duplicate cmd %u from 0x%04x, re-sending ACK", seq, src_id);
+    } else {
+        status = s_handler ? s_handler(src_id, group, seq, payload, length) : 0xFF;
+        if (status == THREAD_CMD_STATUS_PENDING) {
+            return;
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        peer = cmd_rx_peer_find(src_id, group);
+        if (peer && peer->epoch == epoch && peer->seq == seq) {
+            peer->status = status;
+        }
+        xSemaphoreGive(s_lock);
+
+        if (group) {
+            // Every member got the same multicast at the same moment
+            cmd_queue_group_ack(src_id, group, epoch, seq, status);
+            return;
+        }
+    }
+    cmd_send_ack(src_id, group, epoch, seq, status);
+}
+
+void thread_cmd_complete(uint16_t src_id, uint16_t group, uint8_t seq, uint8_t status)
+{
+    bool found = false;
+    uint16_t epoch = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cmd_rx_peer_t *peer = cmd_rx_peer_find(src_id, group);
+    if (peer && peer->seq == seq) {
+        if (peer->status == THREAD_CMD_STATUS_PENDING) {
+            peer->status = status;
+        }
+        epoch = peer->epoch;
+        found = true;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (!found) {
+        // A newer command from the sender replaced it; the sender has
+        // moved on, since it only has one command per destination on the air
+        ESP_LOGD(TAG, "Cmd %u from 0x%04x completed after a newer one", seq, src_id);
+        return;
+    }
+    cmd_send_ack(src_id, group, epoch, seq, status);
+}
+
+/**
+ * @brief Epoch of a command or ACK frame.
+ */
+static uint16_t cmd_frame_epoch(const uint8_t *data)
+{
+    return (uint16_t)(data[1] | (data[2] << 8));
+}
+
+/**
+ * @brief Group number of a GROUP_CMD/GROUP_ACK frame.
+ */
+static uint16_t cmd_frame_group(const uint8_t *data)
+{
+    return (uint16_t)(data[4] | (data[5] << 8));
+}
+
+bool thread_cmd_handle_rx(uint16_t src_id, const uint8_t *data, size_t length)
+{
+    if (length < THREAD_CMD_HEADER_LEN) {
+        return false;
+    }
+    switch (data[0]) {
+    case FRAME_TYPE_CMD:
+        cmd_handle_cmd(src_id, 0, cmd_frame_epoch(data), data[3],
+                       &data[THREAD_CMD_HEADER_LEN], length - THREAD_CMD_HEADER_LEN);
+        return true;
+    case FRAME_TYPE_ACK:
+        if (length == THREAD_CMD_HEADER_LEN + 1) {
+            cmd_handle_ack(src_id, 0, cmd_frame_epoch(data), data[3], data[4]);
+        }
+        return true;
+    case FRAME_TYPE_GROUP_CMD:
+        if (length >= THREAD_CMD_GROUP_HEADER_LEN && cmd_frame_group(data) != 0) {
+            cmd_handle_cmd(src_id, cmd_frame_group(data), cmd_frame_epoch(data), data[3],
+                           &data[THREAD_CMD_GROUP_HEADER_LEN],
+                           length - THREAD_CMD_GROUP_HEADER_LEN);
+        }
+        return true;
+    case FRAME_TYPE_GROUP_ACK:
+        if (length == THREAD_CMD_GROUP_HEADER_LEN + 1 && cmd_frame_group(data) != 0) {
+            cmd_handle_ack(src_id, cmd_frame_group(data), cmd_frame_epoch(data), data[3],
+                           data[6]);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
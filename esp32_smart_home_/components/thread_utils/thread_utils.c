@@ -1,8 +1,18 @@
 #include "thread_utils.h"
 #include "esp_log.h"
+#include "binlog.h"
 #include "esp_openthread.h"
+#include "esp_openthread_lock.h"
+#include "esp_vfs_eventfd.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
 #include <openthread/instance.h>
 #include <openthread/udp.h>
+#include <openthread/ip6.h>
+#include <openthread/thread.h>
+#include <openthread/link.h>
 #include <openthread/tasklet.h>
 #include <openthread/platform/platform.h>
 
@@ -11,9 +21,68 @@ static otInstance    *s_ot_instance;
 static otUdpSocket    s_udp_socket;
 static thread_rx_cb_t s_rx_cb = NULL;
 
+// Receive buffer pool; the free list is shared with consumer tasks
+static thread_buf_t  s_buf_pool[THREAD_BUF_COUNT];
+static thread_buf_t *s_buf_free;
+static portMUX_TYPE  s_buf_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Thread port for control/sensor messages
 #define THREAD_UDP_PORT 9000
 
+// Group addresses are ff03::5348:<group> ("SH", smart home)
+#define THREAD_GROUP_ADDR_TAG   0x5348
+
+// OpenThread mainloop task
+#define THREAD_MAINLOOP_STACK    6144
+#define THREAD_MAINLOOP_PRIORITY 5
+
+/**
+ * @brief Build the free list of receive buffers.
+ */
+static void thread_buf_pool_init(void)
+{
+    s_buf_free = NULL;
+    for (int i = THREAD_BUF_COUNT - 1; i >= 0; i--) {
+        atomic_init(&s_buf_pool[i].refs, 0);
+        s_buf_pool[i].next = s_buf_free;
+        s_buf_free = &s_buf_pool[i];
+    }
+}
+
+/**
+ * @brief Take a buffer from the pool with one reference, or NULL if empty.
+ */
+static thread_buf_t *thread_buf_alloc(void)
+{
+    taskENTER_CRITICAL(&s_buf_lock);
+    thread_buf_t *buf = s_buf_free;
+    if (buf) {
+        s_buf_free = buf->next;
+    }
+    taskEXIT_CRITICAL(&s_buf_lock);
+
+    if (buf) {
+        atomic_store_explicit(&buf->refs, 1, memory_order_relaxed);
+    }
+    return buf;
+}
+
+void thread_buf_retain(thread_buf_t *buf)
+{
+    atomic_fetch_add_explicit(&buf->refs, 1, memory_order_relaxed);
+}
+
+void thread_buf_release(thread_buf_t *buf)
+{
+    if (atomic_fetch_sub_explicit(&buf->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    taskENTER_CRITICAL(&s_buf_lock);
+    buf->next = s_buf_free;
+    s_buf_free = buf;
+    taskEXIT_CRITICAL(&s_buf_lock);
+}
+
 /**
  * @brief Internal UDP receive callback.
  */
@@ -29,75 +98,144 @@ static void udp_receive_cb(void *          aContext,
         otMessageFree(aMessage);
         return;
     }
+    if (length > THREAD_BUF_SIZE) {
+        ESP_LOGW(TAG, "Thread packet too long (%u bytes)", length);
+        otMessageFree(aMessage);
+        return;
+    }
 
-    // Read payload into buffer (CRC + JSON)
-    uint8_t buf[256];
-    if (length > sizeof(buf)) length = sizeof(buf);
-    otMessageRead(aMessage, offset, buf, length);
+    // The payload is copied exactly once, into a pool buffer that
+    // consumers then work on in place
+    thread_buf_t *buf = thread_buf_alloc();
+    if (!buf) {
+        ESP_LOGW(TAG, "RX buffer pool exhausted, packet dropped");
+        otMessageFree(aMessage);
+        return;
+    }
+    buf->length = otMessageRead(aMessage, offset, buf->data, length);
+    buf->src_id = aInfo->mPeerAddr.mFields.m16[7] & OT_RLOC16_MASK;
+    buf->rx_us  = (uint32_t)esp_timer_get_time();
+    otMessageFree(aMessage);
 
-    uint16_t src_rloc = aInfo->mPeerAddr.mFields.m16[7] & OT_RLOC16_MASK;
-    ESP_LOGI(TAG, "Thread RX %u bytes from RLOC0x%04x", length, src_rloc);
+    BINLOG_I(TAG, "Thread RX %u bytes from RLOC0x%04x", buf->length, buf->src_id);
 
-    // Invoke user callback
+    // Invoke user callback; it retains the buffer if it needs it later
     if (s_rx_cb) {
-        s_rx_cb(buf, length, src_rloc);
+        s_rx_cb(buf);
     }
-
-    otMessageFree(aMessage);
+    thread_buf_release(buf);
 }
 
-void thread_init(void)
+esp_err_t thread_init(void)
 {
     ESP_LOGI(TAG, "Initializing OpenThread stack and UDP socket");
 
+    thread_buf_pool_init();
+
+    // The mainloop sleeps in select() on eventfds for tasklets and the radio
+    esp_vfs_eventfd_config_t eventfd_config = { .max_fds = 3 };
+    esp_err_t ret = esp_vfs_eventfd_register(&eventfd_config);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to register eventfd (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
     // Initialize OpenThread platform
     esp_openthread_platform_init_conf_t conf = ESP_OPENTHREAD_INIT_CONFIG_DEFAULT();
-    esp_openthread_init(&conf);
+    ret = esp_openthread_init(&conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize OpenThread (%s)", esp_err_to_name(ret));
+        return ret;
+    }
 
     // Get otInstance handle
     s_ot_instance = esp_openthread_get_instance();
     if (!s_ot_instance) {
         ESP_LOGE(TAG, "Failed to get otInstance");
-        return;
+        return ESP_FAIL;
     }
 
     // Open and bind a UDP socket on THREAD_UDP_PORT
     otError err;
     otSockAddr addr = { .mPort = THREAD_UDP_PORT };
 
+    esp_openthread_lock_acquire(portMAX_DELAY);
     otUdpOpen(s_ot_instance, &s_udp_socket, udp_receive_cb, NULL);
     err = otUdpBind(s_ot_instance, &s_udp_socket, &addr);
+    esp_openthread_lock_release();
     if (err != OT_ERROR_NONE) {
         ESP_LOGE(TAG, "Failed to bind UDP socket (%d)", err);
-    } else {
-        ESP_LOGI(TAG, "UDP socket bound to port %u", THREAD_UDP_PORT);
+        return ESP_FAIL;
     }
+    ESP_LOGI(TAG, "UDP socket bound to port %u", THREAD_UDP_PORT);
 
     ESP_LOGI(TAG, "Thread stack initialized");
+    return ESP_OK;
 }
 
-void thread_register_receive_cb(thread_rx_cb_t cb)
+/**
+ * @brief OpenThread mainloop task; blocks in select() until radio or
+ *        tasklet work is pending.
+ */
+static void thread_mainloop_task(void *arg)
 {
-    s_rx_cb = cb;
-    ESP_LOGI(TAG, "Registered Thread receive callback");
+    esp_err_t err = esp_openthread_launch_mainloop();
+    ESP_LOGE(TAG, "OpenThread mainloop exited (%s)", esp_err_to_name(err));
+    vTaskDelete(NULL);
 }
 
-void thread_send(const uint8_t *data, size_t length, uint16_t dest_id)
+esp_err_t thread_start_mainloop(void)
 {
     if (!s_ot_instance) {
         ESP_LOGW(TAG, "Thread not initialized");
-        return;
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTaskCreate(thread_mainloop_task, "ot_main", THREAD_MAINLOOP_STACK, NULL,
+                    THREAD_MAINLOOP_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create OpenThread mainloop task");
+        return ESP_ERR_NO_MEM;
     }
+    return ESP_OK;
+}
+
+void thread_register_receive_cb(thread_rx_cb_t cb)
+{
+    s_rx_cb = cb;
+    ESP_LOGI(TAG, "Registered Thread receive callback");
+}
 
+/**
+ * @brief Send one UDP datagram; called with the OpenThread lock held.
+ */
+static otError thread_udp_send(const uint8_t *data, size_t length, const otMessageInfo *info)
+{
     // Create IPv6 UDP message
     otMessage *msg = otUdpNewMessage(s_ot_instance, NULL);
     if (!msg) {
-        ESP_LOGW(TAG, "Failed to allocate message");
+        return OT_ERROR_NO_BUFS;
+    }
+
+    // Append payload and send
+    otError err = otMessageAppend(msg, data, length);
+    if (err == OT_ERROR_NONE) {
+        err = otUdpSend(s_ot_instance, &s_udp_socket, msg, info);
+    }
+    if (err != OT_ERROR_NONE) {
+        otMessageFree(msg);
+    }
+    return err;
+}
+
+void thread_send(const uint8_t *data, size_t length, uint16_t dest_id)
+{
+    if (!s_ot_instance) {
+        ESP_LOGW(TAG, "Thread not initialized");
         return;
     }
 
-    // Append payload
-    otMessageAppend(msg, data, length);
+    // Callers run on their own tasks; the lock is recursive, so sending
+    // from the receive callback (mainloop task) is fine as well
+    esp_openthread_lock_acquire(portMAX_DELAY);
 
     // Set destination address (RLOC16 -> IPv6 address)
     otMessageInfo info = {};
@@ -108,19 +246,151 @@ void thread_send(const uint8_t *data, size_t length, uint16_t dest_id)
     info.mSocketAddress = info.mPeerAddr;
     info.mSocketPort    = THREAD_UDP_PORT;
 
-    // Send
-    otError err = otUdpSend(s_ot_instance, &s_udp_socket, msg, &info);
+    otError err = thread_udp_send(data, length, &info);
+    esp_openthread_lock_release();
+
     if (err != OT_ERROR_NONE) {
         ESP_LOGW(TAG, "Thread send error: %d", err);
-        otMessageFree(msg);
     } else {
-        ESP_LOGI(TAG, "Thread TX %u bytes to RLOC0x%04x", length, dest_id);
+        BINLOG_I(TAG, "Thread TX %u bytes to RLOC0x%04x", length, dest_id);
+    }
+}
+
+/**
+ * @brief Realm-local multicast address of @p group.
+ */
+static void thread_group_addr(uint16_t group, otIp6Address *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->mFields.m8[0]  = 0xff;
+    addr->mFields.m8[1]  = 0x03;
+    addr->mFields.m8[12] = THREAD_GROUP_ADDR_TAG >> 8;
+    addr->mFields.m8[13] = THREAD_GROUP_ADDR_TAG & 0xff;
+    addr->mFields.m8[14] = group >> 8;
+    addr->mFields.m8[15] = group & 0xff;
+}
+
+esp_err_t thread_group_join(uint16_t group)
+{
+    if (!s_ot_instance) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (group == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    otIp6Address addr;
+    thread_group_addr(group, &addr);
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otError err = otIp6SubscribeMulticastAddress(s_ot_instance, &addr);
+    esp_openthread_lock_release();
+    if (err != OT_ERROR_NONE && err != OT_ERROR_ALREADY) {
+        ESP_LOGW(TAG, "Failed to join group %u (%d)", group, err);
+        return err == OT_ERROR_NO_BUFS ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Joined group %u", group);
+    return ESP_OK;
+}
+
+esp_err_t thread_group_leave(uint16_t group)
+{
+    if (!s_ot_instance) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (group == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    otIp6Address addr;
+    thread_group_addr(group, &addr);
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otError err = otIp6UnsubscribeMulticastAddress(s_ot_instance, &addr);
+    esp_openthread_lock_release();
+    return err == OT_ERROR_NONE ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void thread_send_group(const uint8_t *data, size_t length, uint16_t group)
+{
+    if (!s_ot_instance) {
+        ESP_LOGW(TAG, "Thread not initialized");
+        return;
+    }
+
+    // The source address is left unspecified for OpenThread to pick;
+    // MPL forwards the datagram across the mesh
+    otMessageInfo info = {};
+    thread_group_addr(group, &info.mPeerAddr);
+    info.mPeerPort   = THREAD_UDP_PORT;
+    info.mSocketPort = THREAD_UDP_PORT;
+
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otError err = thread_udp_send(data, length, &info);
+    esp_openthread_lock_release();
+
+    if (err != OT_ERROR_NONE) {
+        ESP_LOGW(TAG, "Thread group send error: %d", err);
+    } else {
+        BINLOG_I(TAG, "Thread TX %u bytes to group %u", length, group);
     }
 }
 
 void thread_process(void)
 {
     // Process radio events and tasklets
+    esp_openthread_lock_acquire(portMAX_DELAY);
     esp_openthread_radio_process(s_ot_instance);
     esp_openthread_tasklets_process(s_ot_instance);
+    esp_openthread_lock_release();
+}
+
+bool thread_is_attached(void)
+{
+    if (!s_ot_instance) {
+        return false;
+    }
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otDeviceRole role = otThreadGetDeviceRole(s_ot_instance);
+    esp_openthread_lock_release();
+    return role == OT_DEVICE_ROLE_CHILD
+        || role == OT_DEVICE_ROLE_ROUTER
+        || role == OT_DEVICE_ROLE_LEADER;
+}
+
+uint64_t thread_get_ext_addr(void)
+{
+    if (!s_ot_instance) {
+        return 0;
+    }
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    const otExtAddress *ext = otLinkGetExtendedAddress(s_ot_instance);
+    uint64_t addr = 0;
+    for (int i = 0; i < OT_EXT_ADDRESS_SIZE; i++) {
+        addr = (addr << 8) | ext->m8[i];
+    }
+    esp_openthread_lock_release();
+    return addr;
+}
+
+void thread_set_sleepy(uint32_t poll_period_ms)
+{
+    if (!s_ot_instance) {
+        ESP_LOGW(TAG, "Thread not initialized");
+        return;
+    }
+
+    // Minimal end device with the receiver off when idle
+    otLinkModeConfig mode = {
+        .mRxOnWhenIdle = false,
+        .mDeviceType   = false,
+        .mNetworkData  = false,
+    };
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otError err = otThreadSetLinkMode(s_ot_instance, mode);
+    if (err == OT_ERROR_NONE && poll_period_ms) {
+        otLinkSetPollPeriod(s_ot_instance, poll_period_ms);
+    }
+    esp_openthread_lock_release();
+    if (err != OT_ERROR_NONE) {
+        ESP_LOGW(TAG, "Failed to set SED link mode (%d)", err);
+        return;
+    }
+    ESP_LOGI(TAG, "Sleepy end device, poll period %lu ms", (unsigned long)poll_period_ms);
 }
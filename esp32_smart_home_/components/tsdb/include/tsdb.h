@@ -0,0 +1,173 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_codec.h"
+
+/*
+ * Per-node, per-metric history of sensor readings, kept as 1-minute and
+ * 1-hour min/avg/max rollups.
+ *
+ * Raw samples only update the open minute; a minute is closed into the
+ * minute tier (and folded into the open hour) by the first sample of a
+ * later minute, and likewise for hours. Periods still open are not
+ * returned by queries. Values keep the fixed-point units of
+ * telemetry_frame_t.
+ *
+ * Each tier is a ring of fixed-size blocks. A block stores its first
+ * period in full (start time, avg, avg-min, max-avg) and each further
+ * period as three varints: the zigzag change of avg (shifted left by one),
+ * avg-min and max-avg. A run of periods without samples is a single
+ * varint (count << 1 | 1). Indoor readings take 3 bytes per minute and
+ * 3-5 bytes per hour. When a block is full the next one is started, and
+ * the ring drops its oldest block. A series keeps about 5 h of minutes and
+ * a week of hours in 2.2 KB, so 200 nodes with five metrics take 2.2 MB.
+ *
+ * Timestamps are seconds on any monotonic clock chosen by the caller. The
+ * store does no locking and no allocation: memory for tsdb_mem_size()
+ * bytes is passed to tsdb_init(). It only depends on frame_codec and
+ * builds on a host.
+ */
+
+#define TSDB_BLOCK_DATA      112     ///< Varint bytes after a block's first period
+#define TSDB_MINUTE_BLOCKS   9
+#define TSDB_HOUR_BLOCKS     8
+
+/**
+ * @brief Stored metrics, in TELEMETRY_F_* bit order.
+ */
+typedef enum {
+    TSDB_METRIC_TEMPERATURE = 0,    ///< 0.01 °C
+    TSDB_METRIC_HUMIDITY,           ///< 0.01 %RH
+    TSDB_METRIC_CO2,                ///< ppm
+    TSDB_METRIC_TVOC,               ///< ppb
+    TSDB_METRIC_LIGHT,              ///< lx
+    TSDB_METRIC_COUNT
+} tsdb_metric_t;
+
+/**
+ * @brief Rollup resolution.
+ */
+typedef enum {
+    TSDB_RES_MINUTE = 0,
+    TSDB_RES_HOUR,
+} tsdb_res_t;
+
+/**
+ * @brief Block of consecutive periods of one tier.
+ */
+typedef struct {
+    uint32_t t;             ///< Start of the first period
+    int32_t  avg;           ///< First period
+    uint16_t lo;            ///< avg - min of the first period
+    uint16_t hi;            ///< max - avg of the first period
+    uint8_t  len;           ///< Bytes used in @ref data
+    uint8_t  reserved[3];
+    uint8_t  data[TSDB_BLOCK_DATA];     ///< Further periods, varint-encoded
+} tsdb_block_t;
+
+/**
+ * @brief Ring state of one tier.
+ */
+typedef struct {
+    uint8_t  head;          ///< Newest block
+    uint8_t  used;          ///< Valid blocks
+    int32_t  last_avg;      ///< Last stored avg of the newest block
+    uint32_t next_t;        ///< Start of the period after the last stored one
+} tsdb_tier_t;
+
+/**
+ * @brief Open (not yet stored) period.
+ */
+typedef struct {
+    uint32_t t;
+    int32_t  min;
+    int32_t  max;
+    int32_t  sum;
+    uint16_t n;             ///< Samples; 0 = nothing open
+} tsdb_acc_t;
+
+/**
+ * @brief History of one metric of one node.
+ */
+typedef struct {
+    tsdb_acc_t   minute_acc;
+    tsdb_acc_t   hour_acc;
+    tsdb_tier_t  minute;
+    tsdb_tier_t  hour;
+    tsdb_block_t minute_blocks[TSDB_MINUTE_BLOCKS];
+    tsdb_block_t hour_blocks[TSDB_HOUR_BLOCKS];
+} tsdb_series_t;
+
+/**
+ * @brief Key table slot.
+ */
+typedef struct {
+    uint64_t key;           ///< Node key, 0 = empty
+    uint32_t index;         ///< Entry in tsdb_t.nodes
+} tsdb_slot_t;
+
+/**
+ * @brief Store over caller-provided memory.
+ */
+typedef struct {
+    tsdb_slot_t   *slots;
+    tsdb_series_t (*nodes)[TSDB_METRIC_COUNT];
+    uint32_t       mask;
+    uint32_t       max_nodes;
+    uint32_t       count;
+    uint32_t       rejected;    ///< Samples of new nodes refused because the store is full
+} tsdb_t;
+
+/**
+ * @brief One rollup period returned by a query.
+ */
+typedef struct {
+    uint32_t t;             ///< Start of the period
+    int32_t  min;
+    int32_t  avg;
+    int32_t  max;
+} tsdb_point_t;
+
+/**
+ * @brief Bytes of memory needed for @p max_nodes nodes.
+ */
+size_t tsdb_mem_size(uint32_t max_nodes);
+
+/**
+ * @brief Initialize a store.
+ *
+ * @param mem   tsdb_mem_size(max_nodes) bytes, 8-byte aligned (e.g. PSRAM)
+ * @return false if @p max_nodes is 0
+ */
+bool tsdb_init(tsdb_t *db, void *mem, uint32_t max_nodes);
+
+/**
+ * @brief Record the metrics present in @p frame.
+ *
+ * @param key    Node key (extended address), never 0
+ * @param now_s  Arrival time in seconds, not decreasing
+ * @return false if the node is new and the store is full
+ */
+bool tsdb_add(tsdb_t *db, uint64_t key, uint32_t now_s, const telemetry_frame_t *frame);
+
+/**
+ * @brief Read the stored periods of a series that start in [@p from, @p to],
+ *        oldest first.
+ *
+ * @param out         Output array
+ * @param max_points  Capacity of @p out
+ * @param more        Set to true if further periods in range did not fit
+ *                    (may be NULL); continue from the last t + 1
+ * @return Number of points written; 0 for an unknown node
+ */
+size_t tsdb_query(const tsdb_t *db, uint64_t key, tsdb_metric_t metric, tsdb_res_t res,
+                  uint32_t from, uint32_t to, tsdb_point_t *out, size_t max_points,
+                  bool *more);
+
+/**
+ * @brief Metric name used on MQTT ("temperature", "humidity", "co2",
+ *        "tvoc", "light"), or NULL.
+ */
+const char *tsdb_metric_name(tsdb_metric_t metric);
@@ -0,0 +1,289 @@
+#include "tsdb.h"
+#include <string.h>
+
+#define TSDB_MINUTE_S   60
+#define TSDB_HOUR_S     3600
+
+static const char *const s_metric_names[TSDB_METRIC_COUNT] = {
+    [TSDB_METRIC_TEMPERATURE] = "temperature",
+    [TSDB_METRIC_HUMIDITY]    = "humidity",
+    [TSDB_METRIC_CO2]         = "co2",
+    [TSDB_METRIC_TVOC]        = "tvoc",
+    [TSDB_METRIC_LIGHT]       = "light",
+};
+
+const char *tsdb_metric_name(tsdb_metric_t metric)
+{
+    return (unsigned)metric < TSDB_METRIC_COUNT ? s_metric_names[metric] : NULL;
+}
+
+/**
+ * @brief Key table size for @p max_nodes: a power of two at least twice
+ *        as large, so probe sequences stay short.
+ */
+static uint32_t tsdb_slot_count(uint32_t max_nodes)
+{
+    uint32_t n = 1;
+    while (n < 2 * max_nodes) {
+        n <<= 1;
+    }
+    return n;
+}
+
+size_t tsdb_mem_size(uint32_t max_nodes)
+{
+    return tsdb_slot_count(max_nodes) * sizeof(tsdb_slot_t)
+           + (size_t)max_nodes * sizeof(tsdb_series_t[TSDB_METRIC_COUNT]);
+}
+
+bool tsdb_init(tsdb_t *db, void *mem, uint32_t max_nodes)
+{
+    if (max_nodes == 0) {
+        return false;
+    }
+    uint32_t slots = tsdb_slot_count(max_nodes);
+    memset(mem, 0, slots * sizeof(tsdb_slot_t));
+    db->slots     = mem;
+    db->nodes     = (void *)(db->slots + slots);
+    db->mask      = slots - 1;
+    db->max_nodes = max_nodes;
+    db->count     = 0;
+    db->rejected  = 0;
+    return true;
+}
+
+/**
+ * @brief Same mixing as node_registry: keys of one vendor share their
+ *        upper bytes.
+ */
+static uint32_t tsdb_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+/**
+ * @brief Slot holding @p key, or the empty slot where it would go.
+ */
+static tsdb_slot_t *tsdb_probe(const tsdb_t *db, uint64_t key)
+{
+    uint32_t i = tsdb_hash(key) & db->mask;
+    while (db->slots[i].key != key && db->slots[i].key != 0) {
+        i = (i + 1) & db->mask;
+    }
+    return &db->slots[i];
+}
+
+/**
+ * @brief Average rounded to nearest, for either sign.
+ */
+static int32_t tsdb_div_round(int32_t sum, uint16_t n)
+{
+    return sum >= 0 ? (sum + n / 2) / n : -((-sum + n / 2) / n);
+}
+
+/**
+ * @brief Append @p v as a little-endian base-128 varint.
+ */
+static size_t tsdb_put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint32_t tsdb_get_varint(const uint8_t *p, size_t *off)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        uint8_t byte = p[(*off)++];
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return v;
+}
+
+/**
+ * @brief Store one closed period of length @p period starting at @p t.
+ */
+static void tsdb_tier_append(tsdb_tier_t *tier, tsdb_block_t *blocks, uint8_t capacity,
+                             uint32_t period, uint32_t t, int32_t min, int32_t avg, int32_t max)
+{
+    if (tier->used > 0 && t >= tier->next_t) {
+        // Worst case: a gap run and three 5-byte varints
+        uint8_t entry[20];
+        size_t len = 0;
+        if (t > tier->next_t) {
+            len += tsdb_put_varint(&entry[len], (t - tier->next_t) / period << 1 | 1);
+        }
+        int32_t delta = avg - tier->last_avg;
+        uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        len += tsdb_put_varint(&entry[len], zigzag << 1);
+        len += tsdb_put_varint(&entry[len], (uint32_t)(avg - min));
+        len += tsdb_put_varint(&entry[len], (uint32_t)(max - avg));
+
+        tsdb_block_t *blk = &blocks[tier->head];
+        if (blk->len + len <= TSDB_BLOCK_DATA) {
+            memcpy(&blk->data[blk->len], entry, len);
+            blk->len += (uint8_t)len;
+            tier->last_avg = avg;
+            tier->next_t = t + period;
+            return;
+        }
+    }
+
+    // New block, overwriting the oldest one when the ring is full
+    if (tier->used > 0) {
+        tier->head = (uint8_t)((tier->head + 1) % capacity);
+    }
+    if (tier->used < capacity) {
+        tier->used++;
+    }
+    blocks[tier->head] = (tsdb_block_t){
+        .t   = t,
+        .avg = avg,
+        .lo  = (uint16_t)(avg - min),
+        .hi  = (uint16_t)(max - avg),
+    };
+    tier->last_avg = avg;
+    tier->next_t = t + period;
+}
+
+/**
+ * @brief Fold a value range into an open period starting at @p t.
+ */
+static void tsdb_acc_add(tsdb_acc_t *acc, uint32_t t, int32_t min, int32_t max,
+                         int32_t sum, uint16_t n)
+{
+    if (acc->n == 0) {
+        *acc = (tsdb_acc_t){ .t = t, .min = min, .max = max, .sum = sum, .n = n };
+        return;
+    }
+    if (min < acc->min) acc->min = min;
+    if (max > acc->max) acc->max = max;
+    acc->sum += sum;
+    acc->n   += n;
+}
+
+/**
+ * @brief Record one sample, first closing the periods it has left behind.
+ */
+static void tsdb_series_add(tsdb_series_t *s, uint32_t now_s, int32_t value)
+{
+    uint32_t minute = now_s - now_s % TSDB_MINUTE_S;
+    uint32_t hour   = now_s - now_s % TSDB_HOUR_S;
+    tsdb_acc_t *m = &s->minute_acc;
+    tsdb_acc_t *h = &s->hour_acc;
+
+    if (m->n && m->t != minute) {
+        tsdb_tier_append(&s->minute, s->minute_blocks, TSDB_MINUTE_BLOCKS, TSDB_MINUTE_S,
+                         m->t, m->min, tsdb_div_round(m->sum, m->n), m->max);
+        tsdb_acc_add(h, m->t - m->t % TSDB_HOUR_S, m->min, m->max, m->sum, m->n);
+        m->n = 0;
+    }
+    if (h->n && h->t != hour) {
+        tsdb_tier_append(&s->hour, s->hour_blocks, TSDB_HOUR_BLOCKS, TSDB_HOUR_S,
+                         h->t, h->min, tsdb_div_round(h->sum, h->n), h->max);
+        h->n = 0;
+    }
+    tsdb_acc_add(m, minute, value, value, value, 1);
+}
+
+bool tsdb_add(tsdb_t *db, uint64_t key, uint32_t now_s, const telemetry_frame_t *frame)
+{
+    if (key == 0) {
+        return false;
+    }
+    tsdb_slot_t *slot = tsdb_probe(db, key);
+    if (slot->key == 0) {
+        if (db->count == db->max_nodes) {
+            db->rejected++;
+            return false;
+        }
+        slot->key   = key;
+        slot->index = db->count++;
+        memset(db->nodes[slot->index], 0, sizeof(db->nodes[0]));
+    }
+    tsdb_series_t *series = db->nodes[slot->index];
+
+    const int32_t values[TSDB_METRIC_COUNT] = {
+        [TSDB_METRIC_TEMPERATURE] = frame->temperature,
+        [TSDB_METRIC_HUMIDITY]    = frame->humidity,
+        [TSDB_METRIC_CO2]         = frame->co2,
+        [TSDB_METRIC_TVOC]        = frame->tvoc,
+        [TSDB_METRIC_LIGHT]       = frame->light,
+    };
+    for (int i = 0; i < TSDB_METRIC_COUNT; i++) {
+        if (frame->fields & (1u << i)) {
+            tsdb_series_add(&series[i], now_s, values[i]);
+        }
+    }
+    return true;
+}
+
+size_t tsdb_query(const tsdb_t *db, uint64_t key, tsdb_metric_t metric, tsdb_res_t res,
+                  uint32_t from, uint32_t to, tsdb_point_t *out, size_t max_points,
+                  bool *more)
+{
+    if (more) {
+        *more = false;
+    }
+    if (key == 0 || (unsigned)metric >= TSDB_METRIC_COUNT) {
+        return 0;
+    }
+    const tsdb_slot_t *slot = tsdb_probe(db, key);
+    if (slot->key == 0) {
+        return 0;
+    }
+    const tsdb_series_t *s = &db->nodes[slot->index][metric];
+    const tsdb_tier_t *tier    = res == TSDB_RES_HOUR ? &s->hour : &s->minute;
+    const tsdb_block_t *blocks = res == TSDB_RES_HOUR ? s->hour_blocks : s->minute_blocks;
+    uint8_t capacity           = res == TSDB_RES_HOUR ? TSDB_HOUR_BLOCKS : TSDB_MINUTE_BLOCKS;
+    uint32_t period            = res == TSDB_RES_HOUR ? TSDB_HOUR_S : TSDB_MINUTE_S;
+
+    size_t n = 0;
+    for (uint8_t b = 0; b < tier->used; b++) {
+        const tsdb_block_t *blk = &blocks[(tier->head + capacity - tier->used + 1 + b) % capacity];
+        if (blk->t > to) {
+            break;
+        }
+        uint32_t t = blk->t;
+        int32_t avg = blk->avg;
+        int32_t min = avg - blk->lo;
+        int32_t max = avg + blk->hi;
+        size_t off = 0;
+        for (bool first = true; first || off < blk->len; first = false, t += period) {
+            if (!first) {
+                uint32_t v = tsdb_get_varint(blk->data, &off);
+                if (v & 1) {
+                    // Run of periods without samples
+                    t += (v >> 1) * period;
+                    v = tsdb_get_varint(blk->data, &off);
+                }
+                uint32_t zigzag = v >> 1;
+                avg += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+                min = avg - (int32_t)tsdb_get_varint(blk->data, &off);
+                max = avg + (int32_t)tsdb_get_varint(blk->data, &off);
+            }
+            if (t < from || t > to) {
+                continue;
+            }
+            if (n == max_points) {
+                if (more) {
+                    *more = true;
+                }
+                return n;
+            }
+            out[n++] = (tsdb_point_t){ .t = t, .min = min, .avg = avg, .max = max };
+        }
+    }
+    return n;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Host micro-benchmark helpers. Every bench binary prints one JSON document
+ * laid out like Google Benchmark's --benchmark_format=json:
+ *
+ *   {"context":{"suite":"crc"},"benchmarks":[
+ *     {"name":"crc8_table/25","iterations":..,"real_time":..,
+ *      "time_unit":"ns","cycles":..,"bytes_per_second":..,
+ *      "bytes_per_cycle":..}, ...]}
+ *
+ * so runs can be stored and compared across commits. "cycles" is per
+ * operation from the x86 TSC and is left out elsewhere. bench_value()
+ * adds non-timing results such as encoded sizes.
+ */
+
+#define BENCH_MIN_NS  50000000ull   ///< Each case runs at least this long
+
+typedef void (*bench_fn_t)(void *ctx, size_t iterations);
+
+static bool bench_first_entry = true;
+
+/** Keeps results alive so the compiler cannot drop the measured work */
+static volatile uint32_t bench_sink;
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static inline void bench_begin(const char *suite)
+{
+    printf("{\n  \"context\": {\"suite\": \"%s\"},\n  \"benchmarks\": [", suite);
+    bench_first_entry = true;
+}
+
+static inline void bench_end(void)
+{
+    printf("\n  ]\n}\n");
+}
+
+static inline void bench_entry_start(const char *name)
+{
+    printf("%s\n    {\"name\": \"%s\"", bench_first_entry ? "" : ",", name);
+    bench_first_entry = false;
+}
+
+/**
+ * @brief Time @p fn, doubling the iteration count until one run takes at
+ *        least BENCH_MIN_NS, and print the per-operation result.
+ *
+ * @param bytes_per_op  Bytes processed per iteration for a throughput
+ *                      figure, 0 to leave it out
+ */
+static inline void bench_run(const char *name, bench_fn_t fn, void *ctx, size_t bytes_per_op)
+{
+    size_t iterations = 1;
+    uint64_t ns, cycles;
+    fn(ctx, 16);    // warm caches and branch predictors
+    for (;;) {
+        uint64_t c0 = bench_cycles();
+        uint64_t t0 = bench_now_ns();
+        fn(ctx, iterations);
+        ns = bench_now_ns() - t0;
+        cycles = bench_cycles() - c0;
+        if (ns >= BENCH_MIN_NS || iterations >= ((size_t)1 << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double ns_per_op = (double)ns / (double)iterations;
+    bench_entry_start(name);
+    printf(", \"iterations\": %zu, \"real_time\": %.3f, \"time_unit\": \"ns\"",
+           iterations, ns_per_op);
+    if (cycles) {
+        printf(", \"cycles\": %.2f", (double)cycles / (double)iterations);
+    }
+    if (bytes_per_op) {
+        printf(", \"bytes_per_second\": %.0f", (double)bytes_per_op * 1e9 / ns_per_op);
+        if (cycles) {
+            printf(", \"bytes_per_cycle\": %.4f",
+                   (double)bytes_per_op * (double)iterations / (double)cycles);
+        }
+    }
+    printf("}");
+}
+
+/**
+ * @brief Print a non-timing result, e.g. an encoded size.
+ */
+static inline void bench_value(const char *name, double value, const char *unit)
+{
+    bench_entry_start(name);
+    printf(", \"value\": %.6g, \"unit\": \"%s\"}", value, unit);
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include "crc_utils.h"
+#include "bench.h"
+
+/*
+ * CRC engines over typical Thread frame sizes, against the bit-by-bit
+ * compute_crc8 that actuator_utils used before crc_utils.
+ */
+
+/* The original implementation, kept as the "before" reference */
+static uint8_t crc8_bitwise(const uint8_t *data, size_t length)
+{
+    uint8_t crc = 0x00;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t extract = data[i];
+        for (uint8_t bit = 8; bit; bit--) {
+            uint8_t sum = (crc ^ extract) & 0x01;
+            crc >>= 1;
+            if (sum) {
+                crc ^= 0x8C;
+            }
+            extract >>= 1;
+        }
+    }
+    return crc;
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+} crc_case_t;
+
+static void run_bitwise(void *ctx, size_t iterations)
+{
+    const crc_case_t *c = ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += crc8_bitwise(c->data, c->length);
+    }
+}
+
+static void run_crc8(void *ctx, size_t iterations)
+{
+    const crc_case_t *c = ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += compute_crc8(c->data, c->length);
+    }
+}
+
+static void run_crc16(void *ctx, size_t iterations)
+{
+    const crc_case_t *c = ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += compute_crc16_ccitt(c->data, c->length);
+    }
+}
+
+int main(void)
+{
+    // Command frame, full telemetry frame, a JSON report, largest 802.15.4 payload
+    static const size_t sizes[] = { 8, 24, 96, 127 };
+    uint8_t data[128];
+    srand(1);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)rand();
+    }
+
+    bench_begin("crc");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        crc_case_t c = { data, sizes[i] };
+        char name[48];
+        snprintf(name, sizeof(name), "crc8_bitwise/%zu", c.length);
+        bench_run(name, run_bitwise, &c, c.length);
+        snprintf(name, sizeof(name), "crc8_table/%zu", c.length);
+        bench_run(name, run_crc8, &c, c.length);
+        snprintf(name, sizeof(name), "crc16_ccitt_table/%zu", c.length);
+        bench_run(name, run_crc16, &c, c.length);
+    }
+    bench_end();
+    return 0;
+}
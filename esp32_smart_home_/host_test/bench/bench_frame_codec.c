@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <string.h>
+#include "frame_codec.h"
+#include "bench.h"
+#if HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+/*
+ * Telemetry frame codec against the cJSON path it replaced on the sensor
+ * node: size on the air and cost per report.
+ */
+
+static const telemetry_frame_t k_report = {
+    .seq = 42,
+    .fields = TELEMETRY_F_TEMPERATURE | TELEMETRY_F_HUMIDITY | TELEMETRY_F_CO2
+            | TELEMETRY_F_TVOC | TELEMETRY_F_LIGHT | TELEMETRY_F_FLAGS | TELEMETRY_F_NODE,
+    .temperature = 2287, .humidity = 4512, .co2 = 612, .tvoc = 35, .light = 418,
+    .flags = TELEMETRY_FLAG_MOTION, .node = 0x60554400001A2B3Cull,
+};
+
+static void run_encode(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    uint8_t buf[TELEMETRY_MAX_LEN];
+    telemetry_frame_t frame = k_report;
+    for (size_t i = 0; i < iterations; i++) {
+        frame.seq = (uint8_t)i;
+        bench_sink += (uint32_t)telemetry_encode(&frame, buf, sizeof(buf)) + buf[2];
+    }
+}
+
+static void run_decode(void *ctx, size_t iterations)
+{
+    const uint8_t *buf = ctx;
+    telemetry_frame_t frame;
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += telemetry_decode(buf, TELEMETRY_MAX_LEN, &frame) + frame.co2;
+    }
+}
+
+static void run_to_json(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    char json[128];
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += (uint32_t)telemetry_to_json(&k_report, json, sizeof(json));
+    }
+}
+
+#if HAVE_CJSON
+/* The report as the sensor node used to build it, before the binary frame */
+static char *cjson_print_report(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "temperature", k_report.temperature / 100.0);
+    cJSON_AddNumberToObject(root, "humidity", k_report.humidity / 100.0);
+    cJSON_AddNumberToObject(root, "co2", k_report.co2);
+    cJSON_AddNumberToObject(root, "light", k_report.light);
+    cJSON_AddBoolToObject(root, "motion", k_report.flags & TELEMETRY_FLAG_MOTION);
+    cJSON_AddBoolToObject(root, "leak", k_report.flags & TELEMETRY_FLAG_LEAK);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
+
+static void run_cjson_build(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        char *json = cjson_print_report();
+        bench_sink += (uint32_t)strlen(json);
+        cJSON_free(json);
+    }
+}
+
+static void run_cjson_parse(void *ctx, size_t iterations)
+{
+    const char *json = ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        cJSON *root = cJSON_Parse(json);
+        bench_sink += (uint32_t)cJSON_GetObjectItem(root, "co2")->valueint;
+        cJSON_Delete(root);
+    }
+}
+#endif
+
+int main(void)
+{
+    uint8_t frame[TELEMETRY_MAX_LEN];
+    size_t frame_len = telemetry_encode(&k_report, frame, sizeof(frame));
+    char json[128];
+    int json_len = telemetry_to_json(&k_report, json, sizeof(json));
+
+    bench_begin("frame_codec");
+    // Bytes on the air per report, including the CRC8 trailer
+    bench_value("size/binary", (double)frame_len + 1, "bytes");
+    bench_value("size/json_hub_edge", (double)json_len, "bytes");
+    bench_run("telemetry_encode", run_encode, NULL, frame_len);
+    bench_run("telemetry_decode", run_decode, frame, frame_len);
+    bench_run("telemetry_to_json", run_to_json, NULL, (size_t)json_len);
+#if HAVE_CJSON
+    char *old_json = cjson_print_report();
+    bench_value("size/cjson", (double)strlen(old_json) + 1, "bytes");
+    bench_run("cjson_build_print", run_cjson_build, NULL, strlen(old_json));
+    bench_run("cjson_parse", run_cjson_parse, old_json, strlen(old_json));
+    cJSON_free(old_json);
+#endif
+    bench_end();
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "fx_filter.h"
+#include "bench.h"
+
+/*
+ * Cost per sample of the fixed-point filters, next to the float
+ * moving_avg_t they replaced and float versions of EMA and Kalman.
+ * The host has an FPU, so the float figures here are a floor: on the
+ * ESP32-H2 every float operation is a soft-float library call.
+ */
+
+#define SIGNAL_LEN 1024
+
+static int32_t s_signal[SIGNAL_LEN];
+
+/* moving_avg_t from the original sensor node */
+typedef struct {
+    float buffer[5];
+    int   index;
+    int   count;
+    float sum;
+} moving_avg_t;
+
+static float moving_avg_update(moving_avg_t *ma, float new_val)
+{
+    if (ma->count < 5) {
+        ma->buffer[ma->index] = new_val;
+        ma->sum += new_val;
+        ma->count++;
+    } else {
+        ma->sum -= ma->buffer[ma->index];
+        ma->buffer[ma->index] = new_val;
+        ma->sum += new_val;
+    }
+    ma->index = (ma->index + 1) % 5;
+    return ma->sum / ma->count;
+}
+
+static void run_float_ma(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    moving_avg_t ma = { 0 };
+    float acc = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        acc += moving_avg_update(&ma, (float)s_signal[i % SIGNAL_LEN] / 100.0f);
+    }
+    bench_sink += (uint32_t)acc;
+}
+
+static void run_float_ema(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    float y = (float)s_signal[0];
+    for (size_t i = 0; i < iterations; i++) {
+        y += 0.1f * ((float)s_signal[i % SIGNAL_LEN] - y);
+        bench_sink += (uint32_t)(int32_t)y;
+    }
+}
+
+static void run_float_kalman(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    float x = (float)s_signal[0], p = 400, q = 1, r = 400;
+    for (size_t i = 0; i < iterations; i++) {
+        p += q;
+        float k = p / (p + r);
+        x += k * ((float)s_signal[i % SIGNAL_LEN] - x);
+        p *= 1 - k;
+        bench_sink += (uint32_t)(int32_t)x;
+    }
+}
+
+static void run_chain(void *ctx, size_t iterations)
+{
+    const fx_chain_cfg_t *cfg = ctx;
+    fx_chain_t f;
+    fx_chain_init(&f, cfg);
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += (uint32_t)fx_chain_update(&f, s_signal[i % SIGNAL_LEN]);
+    }
+}
+
+int main(void)
+{
+    uint32_t lcg = 1;
+    for (int i = 0; i < SIGNAL_LEN; i++) {
+        lcg = lcg * 1103515245u + 12345u;
+        s_signal[i] = 2150 + (int32_t)((lcg >> 16) % 101) - 50;
+    }
+
+    static const fx_chain_cfg_t ma = { .smooth = FX_SMOOTH_MA, .ma_window = 5 };
+    static const fx_chain_cfg_t ema = { .smooth = FX_SMOOTH_EMA, .ema_alpha = FX_Q16(0.1) };
+    static const fx_chain_cfg_t kalman = { .smooth = FX_SMOOTH_KALMAN, .kalman_q = 1,
+                                           .kalman_r = 400 };
+    static const fx_chain_cfg_t median = { .median = 5, .smooth = FX_SMOOTH_NONE };
+    static const fx_chain_cfg_t median_ema = { .median = 3, .smooth = FX_SMOOTH_EMA,
+                                               .ema_alpha = FX_Q16(0.1) };
+
+    // "cycles" in each entry is cycles per sample
+    bench_begin("fx_filter");
+    bench_run("fixed/ma5", run_chain, (void *)&ma, sizeof(int32_t));
+    bench_run("fixed/ema", run_chain, (void *)&ema, sizeof(int32_t));
+    bench_run("fixed/kalman", run_chain, (void *)&kalman, sizeof(int32_t));
+    bench_run("fixed/median5", run_chain, (void *)&median, sizeof(int32_t));
+    bench_run("fixed/median3_ema", run_chain, (void *)&median_ema, sizeof(int32_t));
+    bench_run("float/moving_avg5", run_float_ma, NULL, sizeof(int32_t));
+    bench_run("float/ema", run_float_ema, NULL, sizeof(int32_t));
+    bench_run("float/kalman", run_float_kalman, NULL, sizeof(int32_t));
+    bench_end();
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_codec.h"
+#include "crc_utils.h"
+#include "node_registry.h"
+#include "hub_pipeline.h"
+#include "bench.h"
+#if HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+/*
+ * Per-message work on the hub and the actuator node, outside the codec
+ * and CRC suites: MQTT topic handling, the registry lookup that replaced
+ * per-packet topic formatting, the hub's hub_pipeline_frame() and the
+ * actuator's command decode.
+ */
+
+#define HUB_CMD_ACK_TOPIC  "home/acks/%u"      // as in hub_esp32s3/main/main.c
+#define BENCH_NODES        300
+
+static node_entry_t    s_entries[HUB_NODE_CAPACITY];
+static node_registry_t s_nodes;
+static uint8_t         s_frames[BENCH_NODES][TELEMETRY_MAX_LEN + 1];
+static size_t          s_frame_len[BENCH_NODES];
+static tsdb_t          s_history;
+static hub_pipeline_t  s_pipeline;
+
+/* Stand-ins for the hub's MQTT client and clock, as in hub_sim */
+int mqtt_publish_len(const char *topic, const char *payload, size_t length)
+{
+    bench_sink += (uint32_t)topic[13] + (uint32_t)payload[length - 1];
+    return 0;
+}
+
+int mqtt_publish(const char *topic, const char *payload)
+{
+    return mqtt_publish_len(topic, payload, strlen(payload));
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)(bench_now_ns() / 1000u);
+}
+
+static uint64_t node_key(uint32_t i)
+{
+    return 0x6055F90000000000ull | (i * 2654435761u);
+}
+
+static void setup(void)
+{
+    node_registry_init(&s_nodes, s_entries, HUB_NODE_CAPACITY, HUB_DUP_WINDOW_MS);
+    // The hub's per-node configuration, with history and without rules
+    tsdb_init(&s_history, aligned_alloc(8, tsdb_mem_size(HUB_HISTORY_MAX_NODES)),
+              HUB_HISTORY_MAX_NODES);
+    s_pipeline = (hub_pipeline_t){
+        .nodes = &s_nodes, .history = &s_history, .publish_mode = HUB_PUBLISH_PER_NODE,
+    };
+    for (uint32_t i = 0; i < BENCH_NODES; i++) {
+        node_registry_touch(&s_nodes, node_key(i), (uint16_t)(0x0400 + i), 0);
+        telemetry_frame_t frame = {
+            .seq = 1, .fields = TELEMETRY_F_ALL & ~TELEMETRY_F_TVOC,
+            .temperature = (int16_t)(2000 + i), .humidity = 4500, .co2 = 600,
+            .light = 300, .node = node_key(i),
+        };
+        size_t n = telemetry_encode(&frame, s_frames[i], TELEMETRY_MAX_LEN);
+        s_frames[i][n] = compute_crc8(s_frames[i], n);
+        s_frame_len[i] = n + 1;
+    }
+}
+
+/* mqtt_event_handler: node id out of home/control/<id> */
+static void run_control_topic_sscanf(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        int node_id = -1;
+        bench_sink += (uint32_t)sscanf("home/control/17409", "home/control/%d", &node_id);
+        bench_sink += (uint32_t)node_id;
+    }
+}
+
+/* publish_cmd_done: topic and payload of one completion */
+static void run_cmd_done_format(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    char topic[32], payload[128];
+    for (size_t i = 0; i < iterations; i++) {
+        uint32_t rtt_us = 41237 + (uint32_t)i;
+        bench_sink += (uint32_t)snprintf(topic, sizeof(topic), HUB_CMD_ACK_TOPIC,
+                                         (unsigned)(0x4400 + (i & 0xFF)));
+        bench_sink += (uint32_t)snprintf(payload, sizeof(payload),
+            "{\"seq\":%u,\"group\":%u,\"result\":\"%s\",\"status\":%u,\"attempts\":%u,"
+            "\"rtt_ms\":%lu.%03lu}", (unsigned)(i & 0xFF), 0u, "acked", 0u, 1u,
+            (unsigned long)(rtt_us / 1000), (unsigned long)(rtt_us % 1000));
+    }
+}
+
+/* Topic built per packet, as the hub did before node_registry */
+static void run_node_topic_snprintf(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    char topic[48];
+    for (size_t i = 0; i < iterations; i++) {
+        bench_sink += (uint32_t)snprintf(topic, sizeof(topic), "home/sensors/%u",
+                                         (unsigned)(0x0400 + i % BENCH_NODES));
+    }
+}
+
+/* The precomputed topic, found by extended address */
+static void run_node_registry_find(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        node_entry_t *node = node_registry_find(&s_nodes, node_key((uint32_t)(i % BENCH_NODES)));
+        bench_sink += (uint32_t)node->topic[13];
+    }
+}
+
+/* thread_receive_callback + hub_pipeline_frame() up to the MQTT call */
+static void run_publish_path(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        uint32_t n = (uint32_t)(i % BENCH_NODES);
+        const uint8_t *data = s_frames[n];
+        size_t length = s_frame_len[n] - 1;
+        if (data[length] != compute_crc8(data, length)) {
+            continue;
+        }
+        // A node's frames are BENCH_NODES * 3 s apart, outside the
+        // duplicate window, so none counts as a duplicate
+        bench_sink += hub_pipeline_frame(&s_pipeline, (uint16_t)(0x0400 + n), data, length,
+                                         (int64_t)i * 3000, NULL);
+    }
+}
+
+/* Actuator node: binary command as received over Thread */
+static uint8_t s_cmd_buf[ACTUATOR_CMD_MAX_LEN];
+static size_t  s_cmd_len;
+
+static void run_actuator_cmd_decode(void *ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        actuator_cmd_t cmd;
+        bench_sink += actuator_cmd_decode(s_cmd_buf, s_cmd_len, &cmd) + cmd.relay_values;
+    }
+}
+
+#if HAVE_CJSON
+/* The JSON command the actuator parsed before actuator_cmd_t */
+static void run_actuator_cjson_parse(void *ctx, size_t iterations)
+{
+    const char *json = ctx;
+    for (size_t i = 0; i < iterations; i++) {
+        cJSON *root = cJSON_Parse(json);
+        bench_sink += (uint32_t)cJSON_GetObjectItem(root, "relay")->valueint;
+        bench_sink += (uint32_t)cJSON_GetObjectItem(root, "state")->valueint;
+        cJSON_Delete(root);
+    }
+}
+#endif
+
+int main(void)
+{
+    setup();
+
+    actuator_cmd_t cmd = { .relay_mask = 0x01, .relay_values = 0x01, .servo_mask = 0x01 };
+    cmd.servo_angle[0] = 90;
+    s_cmd_len = actuator_cmd_encode(&cmd, s_cmd_buf, sizeof(s_cmd_buf));
+
+    bench_begin("hot_paths");
+    bench_run("hub/control_topic_sscanf", run_control_topic_sscanf, NULL, 0);
+    bench_run("hub/cmd_done_format", run_cmd_done_format, NULL, 0);
+    bench_run("hub/node_topic_snprintf", run_node_topic_snprintf, NULL, 0);
+    bench_run("hub/node_registry_find", run_node_registry_find, NULL, 0);
+    bench_run("hub/publish_path", run_publish_path, NULL, s_frame_len[0]);
+    bench_run("actuator/cmd_decode", run_actuator_cmd_decode, NULL, s_cmd_len);
+#if HAVE_CJSON
+    const char *json = "{\"relay\":1,\"state\":1}";
+    bench_run("actuator/cjson_parse", run_actuator_cjson_parse, (void *)json, strlen(json));
+#endif
+    bench_end();
+    return 0;
+}
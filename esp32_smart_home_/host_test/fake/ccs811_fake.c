@@ -0,0 +1,147 @@
+#include <string.h>
+#include "ccs811_fake.h"
+
+static uint32_t s_last_delay_us;
+
+void ccs811_fake_init(ccs811_fake_t *fake)
+{
+    *fake = (ccs811_fake_t){ .hw_id = CCS811_HW_ID, .app_valid = true };
+    s_last_delay_us = 0;
+}
+
+static uint8_t fake_status(const ccs811_fake_t *fake)
+{
+    return (fake->error_id ? CCS811_STATUS_ERROR : 0)
+         | (fake->data_ready ? CCS811_STATUS_DATA_READY : 0)
+         | (fake->app_valid ? CCS811_STATUS_APP_VALID : 0)
+         | (fake->app_mode ? CCS811_STATUS_FW_MODE : 0);
+}
+
+static esp_err_t fake_write_reg(void *ctx, uint8_t reg, const uint8_t *data, size_t length)
+{
+    ccs811_fake_t *fake = ctx;
+    fake->transactions++;
+    if (fake->nack) {
+        return ESP_FAIL;
+    }
+
+    if (reg == CCS811_REG_APP_START) {
+        if (length != 0 || !fake->app_valid) {
+            fake->error_id = CCS811_FAKE_ERR_WRITE_REG_INVALID;
+            return ESP_OK;
+        }
+        fake->app_start_writes++;
+        fake->app_mode = true;
+        return ESP_OK;
+    }
+
+    // Application registers only exist once APP_START has run
+    if (!fake->app_mode) {
+        fake->error_id = CCS811_FAKE_ERR_WRITE_REG_INVALID;
+        return ESP_OK;
+    }
+    switch (reg) {
+    case CCS811_REG_MEAS_MODE:
+        if (length != 1) break;
+        fake->meas_mode_writes++;
+        fake->meas_mode = data[0];
+        fake->data_ready = false;   // a mode change restarts the algorithm
+        return ESP_OK;
+    case CCS811_REG_ENV_DATA:
+        if (length != 4) break;
+        fake->env_writes++;
+        memcpy(fake->env, data, 4);
+        return ESP_OK;
+    case CCS811_REG_BASELINE:
+        if (length != 2) break;
+        fake->baseline = (uint16_t)((data[0] << 8) | data[1]);
+        return ESP_OK;
+    default:
+        break;
+    }
+    fake->error_id = CCS811_FAKE_ERR_WRITE_REG_INVALID;
+    return ESP_OK;
+}
+
+static esp_err_t fake_read_reg(void *ctx, uint8_t reg, uint8_t *data, size_t length)
+{
+    ccs811_fake_t *fake = ctx;
+    fake->transactions++;
+    if (fake->nack) {
+        return ESP_FAIL;
+    }
+
+    uint8_t regs[8] = {0};
+    size_t size = 1;
+    switch (reg) {
+    case CCS811_REG_STATUS:
+        regs[0] = fake_status(fake);
+        break;
+    case CCS811_REG_HW_ID:
+        regs[0] = fake->hw_id;
+        break;
+    case CCS811_REG_ERROR_ID:
+        regs[0] = fake->error_id;
+        fake->error_id = 0;
+        break;
+    case CCS811_REG_MEAS_MODE:
+        regs[0] = fake->meas_mode;
+        break;
+    case CCS811_REG_ALG_RESULT_DATA:
+        regs[0] = (uint8_t)(fake->co2 >> 8);
+        regs[1] = (uint8_t)fake->co2;
+        regs[2] = (uint8_t)(fake->tvoc >> 8);
+        regs[3] = (uint8_t)fake->tvoc;
+        regs[4] = fake_status(fake);
+        regs[5] = fake->error_id;
+        size = 8;
+        fake->data_ready = false;
+        break;
+    case CCS811_REG_BASELINE:
+        regs[0] = (uint8_t)(fake->baseline >> 8);
+        regs[1] = (uint8_t)fake->baseline;
+        size = 2;
+        break;
+    default:
+        fake->error_id = CCS811_FAKE_ERR_READ_REG_INVALID;
+        size = 0;
+        break;
+    }
+    if (reg != CCS811_REG_STATUS && reg != CCS811_REG_HW_ID && reg != CCS811_REG_ERROR_ID
+        && !fake->app_mode) {
+        fake->error_id = CCS811_FAKE_ERR_READ_REG_INVALID;
+    }
+    memset(data, 0, length);
+    memcpy(data, regs, length < size ? length : size);
+    return ESP_OK;
+}
+
+static void fake_delay_us(uint32_t us)
+{
+    s_last_delay_us = us;
+}
+
+ccs811_bus_t ccs811_fake_bus(ccs811_fake_t *fake)
+{
+    return (ccs811_bus_t){
+        .write_reg = fake_write_reg,
+        .read_reg  = fake_read_reg,
+        .delay_us  = fake_delay_us,
+        .ctx       = fake,
+    };
+}
+
+void ccs811_fake_sample(ccs811_fake_t *fake, uint16_t co2, uint16_t tvoc)
+{
+    if (!fake->app_mode || ((fake->meas_mode >> 4) & 0x07) == CCS811_MODE_IDLE) {
+        return;
+    }
+    fake->co2 = co2;
+    fake->tvoc = tvoc;
+    fake->data_ready = true;
+}
+
+uint32_t ccs811_fake_last_delay_us(void)
+{
+    return s_last_delay_us;
+}
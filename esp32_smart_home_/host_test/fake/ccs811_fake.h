@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ccs811.h"
+
+/*
+ * Register-level model of a CCS811 behind ccs811_bus_t, for driving the
+ * driver without hardware. It keeps the boot/application state machine,
+ * STATUS bits, the result and environment registers and counts the
+ * writes that restart the sensor's algorithm.
+ */
+
+#define CCS811_FAKE_ERR_WRITE_REG_INVALID  0x01
+#define CCS811_FAKE_ERR_READ_REG_INVALID   0x02
+
+typedef struct {
+    uint8_t  hw_id;
+    bool     app_valid;         ///< Application firmware present
+    bool     app_mode;          ///< STATUS.FW_MODE: APP_START has run
+    uint8_t  meas_mode;
+    uint8_t  env[4];            ///< Last ENV_DATA written
+    uint16_t baseline;
+    uint16_t co2;
+    uint16_t tvoc;
+    bool     data_ready;        ///< Cleared by reading ALG_RESULT_DATA
+    uint8_t  error_id;          ///< Non-zero sets STATUS.ERROR until ERROR_ID is read
+    bool     nack;              ///< Fail every transaction, as with no device on the bus
+
+    unsigned app_start_writes;
+    unsigned meas_mode_writes;
+    unsigned env_writes;
+    unsigned transactions;
+} ccs811_fake_t;
+
+/**
+ * @brief Power-on state: boot mode, valid application, no data.
+ */
+void ccs811_fake_init(ccs811_fake_t *fake);
+
+/**
+ * @brief Bus operations that talk to @p fake.
+ */
+ccs811_bus_t ccs811_fake_bus(ccs811_fake_t *fake);
+
+/**
+ * @brief Complete a measurement, as the sensor does once per drive-mode
+ *        period. Ignored while the drive mode is idle.
+ */
+void ccs811_fake_sample(ccs811_fake_t *fake, uint16_t co2, uint16_t tvoc);
+
+/**
+ * @brief Delay requested by the driver through the bus, in microseconds.
+ */
+uint32_t ccs811_fake_last_delay_us(void);
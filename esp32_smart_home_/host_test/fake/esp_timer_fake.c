@@ -0,0 +1,100 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_timer_fake.h"
+#include "esp_random.h"
+
+#define FAKE_TIMER_COUNT 8
+
+struct esp_timer {
+    bool                    used;
+    bool                    armed;
+    int64_t                 deadline_us;
+    esp_timer_create_args_t args;
+};
+
+static struct esp_timer s_timers[FAKE_TIMER_COUNT];
+static int64_t          s_now_us;
+static uint32_t         s_random = 1;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+        if (!s_timers[i].used) {
+            s_timers[i] = (struct esp_timer){ .used = true, .args = *args };
+            *out_handle = &s_timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    // As in ESP-IDF, a running timer has to be stopped first
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->deadline_us = s_now_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+/**
+ * @brief Earliest armed timer, or NULL.
+ */
+static struct esp_timer *fake_next_timer(void)
+{
+    struct esp_timer *next = NULL;
+    for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+        if (s_timers[i].armed && (!next || s_timers[i].deadline_us < next->deadline_us)) {
+            next = &s_timers[i];
+        }
+    }
+    return next;
+}
+
+void esp_timer_fake_advance(int64_t us)
+{
+    int64_t target = s_now_us + us;
+    struct esp_timer *timer;
+    while ((timer = fake_next_timer()) != NULL && timer->deadline_us <= target) {
+        s_now_us = timer->deadline_us;
+        timer->armed = false;
+        timer->args.callback(timer->args.arg);
+    }
+    s_now_us = target;
+}
+
+int64_t esp_timer_fake_next_deadline(void)
+{
+    struct esp_timer *timer = fake_next_timer();
+    return timer ? timer->deadline_us : INT64_MAX;
+}
+
+void esp_random_fake_seed(uint32_t seed)
+{
+    s_random = seed ? seed : 1;
+}
+
+uint32_t esp_random(void)
+{
+    // xorshift32: repeatable across runs, never stuck at zero
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+/*
+ * Manual clock behind the esp_timer.h and esp_random.h stand-ins. Time only
+ * moves when a test advances it; one-shot timers that come due fire from
+ * that call, in deadline order, with the clock set to their deadline.
+ */
+
+/**
+ * @brief Move the clock forward by @p us, firing every timer due on the way.
+ */
+void esp_timer_fake_advance(int64_t us);
+
+/**
+ * @brief Deadline of the earliest armed timer, or INT64_MAX if none is.
+ */
+int64_t esp_timer_fake_next_deadline(void);
+
+/**
+ * @brief Restart the esp_random() sequence.
+ */
+void esp_random_fake_seed(uint32_t seed);
@@ -0,0 +1,533 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_codec.h"
+#include "crc_utils.h"
+#include "frame_ring.h"
+#include "node_registry.h"
+#include "hub_pipeline.h"
+#include "esp_timer.h"
+#include "bench.h"
+
+/*
+ * Host simulation of the hub's receive path with N sensor nodes running
+ * as threads. Stand-ins take the place of the radio, the stack and the
+ * broker:
+ *   - sim_bus is the Thread network: a bounded queue shared by all nodes
+ *     that drops frames when full, like the radio's receive queue (in
+ *     the saturated run senders wait for room instead, as MAC retries
+ *     would make them, so the hub's own limit shows);
+ *   - the radio thread plays the OpenThread task and does what
+ *     thread_receive_callback() does: CRC check, then push into the
+ *     frame_ring the publisher drains;
+ *   - the publisher thread runs the hub's own hub_pipeline_frame() (decode,
+ *     registry, duplicate check, local rules, history, JSON, batching and
+ *     hub_stats) with the hub's table sizes from hub_pipeline.h;
+ *     mqtt_publish_len() is a broker stub that records topic and latency,
+ *     and the rule action counts the commands the hub would send;
+ *   - each node's sensors are scripted waveforms.
+ *
+ * For 10, 100 and 1000 nodes it reports the hub's throughput with every
+ * node sending flat out, per-node and batched, and the end-to-end latency
+ * (node send to broker) at a fixed offered load. Node counts given as
+ * arguments run instead of the defaults. The hub keeps at most 3/4 of
+ * HUB_NODE_CAPACITY nodes; frames from the nodes beyond are rejected as
+ * on the hub and reported. Exits non-zero if a frame goes unaccounted.
+ */
+
+#define SIM_MAX_NODES         4096      // threads, not hub capacity
+#define SIM_HUB_MAX_NODES     (HUB_NODE_CAPACITY * 3 / 4)
+#define SIM_BUS_DEPTH         64        // frames the radio queues
+#define SIM_OFFERED_FPS       2000      // paced run: frames/s from all nodes together
+#define SIM_PACED_MS          2000
+#define SIM_BURST_FRAMES      20000     // saturated run: frames from all nodes together
+#define SIM_NODE_STACK        (64 * 1024)
+
+typedef struct sim_frame {
+    struct sim_frame *next;
+    uint64_t          tx_ns;
+    uint16_t          src_id;
+    uint8_t           length;
+    uint8_t           data[TELEMETRY_MAX_LEN + 1];
+} sim_frame_t;
+
+/* Thread/UDP stand-in: many senders, one receiver */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+    pthread_cond_t  space;
+    sim_frame_t    *head;
+    sim_frame_t    *tail;
+    uint32_t        depth;
+    uint32_t        dropped;
+    bool            blocking;   // senders wait when full instead of dropping
+    bool            closed;
+} sim_bus_t;
+
+/* MQTT broker stand-in; only the publisher thread calls it */
+typedef struct {
+    uint64_t *latency_ns;
+    size_t    count;            // readings, a batch counts each of its records
+    size_t    samples;          // latency_ns entries (per-node topics only)
+    size_t    capacity;
+    uint64_t  last_pub_ns;
+    uint32_t  bad_topic;
+} sim_broker_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t frames;
+    uint64_t period_ns;     // 0 = send back to back
+    uint64_t start_ns;
+} sim_node_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t published;
+    uint32_t bus_dropped;
+    uint32_t ring_dropped;
+    uint32_t crc_errors;
+    uint32_t malformed;
+    uint32_t duplicates;
+    uint32_t rejected;
+    uint32_t rules_fired;
+    uint32_t known_nodes;
+    uint64_t elapsed_ns;
+    double   p50_us, p99_us, max_us;
+} sim_result_t;
+
+static sim_bus_t      s_bus;
+static sim_broker_t   s_broker;
+static frame_slot_t   s_rx_slots[HUB_RX_RING_CAPACITY];
+static frame_ring_t   s_rx_ring;
+static sem_t          s_rx_sem;
+static atomic_bool    s_radio_done;
+static atomic_uint    s_ring_dropped;
+static atomic_uint    s_sent;
+static uint32_t       s_crc_errors;
+static uint32_t       s_results[HUB_FRAME_TOO_LONG + 1];   // by hub_frame_result_t
+static uint32_t       s_rules_fired;
+static uint64_t       s_first_tx_ns;
+static uint64_t       s_current_tx_ns;    // frame in hub_pipeline_frame(), for the broker
+static node_entry_t   s_node_entries[HUB_NODE_CAPACITY];
+static node_registry_t s_nodes;
+static rule_table_t   s_rules;
+static tsdb_t         s_history;
+static void          *s_history_mem;
+static mqtt_batch_t   s_batch;
+static hub_pipeline_t s_pipeline;
+
+static void bus_send(sim_frame_t *frame)
+{
+    pthread_mutex_lock(&s_bus.lock);
+    while (s_bus.blocking && s_bus.depth >= SIM_BUS_DEPTH) {
+        pthread_cond_wait(&s_bus.space, &s_bus.lock);
+    }
+    if (s_bus.depth >= SIM_BUS_DEPTH) {
+        s_bus.dropped++;
+        pthread_mutex_unlock(&s_bus.lock);
+        free(frame);
+        return;
+    }
+    frame->next = NULL;
+    if (s_bus.tail) {
+        s_bus.tail->next = frame;
+    } else {
+        s_bus.head = frame;
+    }
+    s_bus.tail = frame;
+    s_bus.depth++;
+    pthread_cond_signal(&s_bus.ready);
+    pthread_mutex_unlock(&s_bus.lock);
+}
+
+/* Next frame, or NULL once the bus is closed and drained */
+static sim_frame_t *bus_recv(void)
+{
+    pthread_mutex_lock(&s_bus.lock);
+    while (!s_bus.head && !s_bus.closed) {
+        pthread_cond_wait(&s_bus.ready, &s_bus.lock);
+    }
+    sim_frame_t *frame = s_bus.head;
+    if (frame) {
+        s_bus.head = frame->next;
+        if (!s_bus.head) {
+            s_bus.tail = NULL;
+        }
+        s_bus.depth--;
+        pthread_cond_signal(&s_bus.space);
+    }
+    pthread_mutex_unlock(&s_bus.lock);
+    return frame;
+}
+
+static void bus_close(void)
+{
+    pthread_mutex_lock(&s_bus.lock);
+    s_bus.closed = true;
+    pthread_cond_broadcast(&s_bus.ready);
+    pthread_mutex_unlock(&s_bus.lock);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)(bench_now_ns() / 1000u);
+}
+
+/* Broker stand-in for the MQTT client: per-node topics and batches */
+int mqtt_publish_len(const char *topic, const char *payload, size_t length)
+{
+    uint64_t now = bench_now_ns();
+    if (strcmp(topic, HUB_BATCH_TOPIC) == 0) {
+        // Readings of several frames: no single latency, only the count
+        size_t records = 0;
+        for (const char *p = payload; (p = strstr(p, "{\"node\":")) != NULL; p++) {
+            records++;
+        }
+        if (records == 0 || payload[0] != '[' || payload[length - 1] != ']') {
+            s_broker.bad_topic++;
+        }
+        s_broker.count += records;
+    } else {
+        if (strncmp(topic, NODE_REGISTRY_TOPIC_PREFIX, strlen(NODE_REGISTRY_TOPIC_PREFIX)) != 0
+            || length <= 2 || payload[0] != '{') {
+            s_broker.bad_topic++;
+        }
+        if (s_broker.samples < s_broker.capacity) {
+            s_broker.latency_ns[s_broker.samples++] = now - s_current_tx_ns;
+        }
+        s_broker.count++;
+    }
+    s_broker.last_pub_ns = now;
+    return 1;
+}
+
+int mqtt_publish(const char *topic, const char *payload)
+{
+    return mqtt_publish_len(topic, payload, strlen(payload));
+}
+
+/* Rule action: the hub sends the rule's command over Thread here */
+static void sim_rule_action(uint8_t index, const rule_t *rule, void *arg)
+{
+    (void)index;
+    (void)rule;
+    (void)arg;
+    s_rules_fired++;
+}
+
+/* One rule for every node: switch relay 1 on when motion is reported */
+static void sim_load_rules(void)
+{
+    actuator_cmd_t cmd = { .relay_mask = 0x01, .relay_values = 0x01 };
+    uint8_t table[64] = { RULE_ENGINE_VERSION, 1 };
+    size_t len = 2 + 8;                         // node 0: any node
+    table[len++] = 0x01;                        // dest RLOC16 0x0C01
+    table[len++] = 0x0C;
+    table[len++] = 1;                           // one condition
+    size_t cmd_len_at = len++;
+    table[len++] = (uint8_t)__builtin_ctz(TELEMETRY_F_FLAGS);
+    table[len++] = RULE_OP_BITS_SET;
+    table[len++] = TELEMETRY_FLAG_MOTION;
+    len += 3;
+    size_t n = actuator_cmd_encode(&cmd, &table[len], sizeof(table) - len);
+    table[cmd_len_at] = (uint8_t)n;
+    if (n == 0 || !rule_table_load(&s_rules, table, len + n)) {
+        fprintf(stderr, "hub_sim: rule table rejected\n");
+        abort();
+    }
+}
+
+/* Scripted sensor readings: slow ramps offset per node */
+static void node_sample(const sim_node_t *node, uint32_t k, telemetry_frame_t *frame)
+{
+    *frame = (telemetry_frame_t){
+        .seq    = (uint8_t)k,
+        .fields = TELEMETRY_F_TEMPERATURE | TELEMETRY_F_HUMIDITY | TELEMETRY_F_CO2
+                | TELEMETRY_F_LIGHT | TELEMETRY_F_FLAGS | TELEMETRY_F_NODE,
+        .temperature = (int16_t)(1800 + (node->id * 37 + k * 5) % 700),
+        .humidity    = (uint16_t)(3500 + (node->id * 11 + k * 3) % 2500),
+        .co2         = (uint16_t)(420 + (node->id + k * 7) % 900),
+        .light       = (uint16_t)((node->id * 101 + k * 13) % 2000),
+        .flags       = (k % 16 == 0) ? TELEMETRY_FLAG_MOTION : 0,
+        .node        = 0x6055F90000000000ull | node->id,
+    };
+}
+
+static void *node_thread(void *arg)
+{
+    const sim_node_t *node = arg;
+    for (uint32_t k = 0; k < node->frames; k++) {
+        if (node->period_ns) {
+            uint64_t due = node->start_ns + k * node->period_ns;
+            struct timespec ts = { .tv_sec = (time_t)(due / 1000000000ull),
+                                   .tv_nsec = (long)(due % 1000000000ull) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        sim_frame_t *frame = malloc(sizeof(*frame));
+        if (!frame) {
+            abort();
+        }
+        telemetry_frame_t telemetry;
+        node_sample(node, k, &telemetry);
+        size_t n = telemetry_encode(&telemetry, frame->data, TELEMETRY_MAX_LEN);
+        frame->data[n] = compute_crc8(frame->data, n);
+        frame->length = (uint8_t)(n + 1);
+        frame->src_id = (uint16_t)(0x0400 + node->id);
+        atomic_fetch_add(&s_sent, 1);
+        frame->tx_ns = bench_now_ns();
+        bus_send(frame);
+    }
+    return NULL;
+}
+
+static void release_frame(void *frame)
+{
+    atomic_fetch_add(&s_ring_dropped, 1);
+    free(frame);
+}
+
+/* The OpenThread task: receive callback up to the hand-off */
+static void *radio_thread(void *arg)
+{
+    (void)arg;
+    sim_frame_t *frame;
+    while ((frame = bus_recv()) != NULL) {
+        if (frame->data[frame->length - 1] != compute_crc8(frame->data, frame->length - 1u)) {
+            s_crc_errors++;
+            free(frame);
+            continue;
+        }
+        frame_ring_push(&s_rx_ring, frame);     // DROP_OLDEST always queues
+        sem_post(&s_rx_sem);
+    }
+    atomic_store(&s_radio_done, true);
+    sem_post(&s_rx_sem);
+    return NULL;
+}
+
+/* The hub's publisher task */
+static void *publisher_thread(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        sem_wait(&s_rx_sem);
+        bool done = atomic_load(&s_radio_done);
+        sim_frame_t *frame;
+        while ((frame = frame_ring_pop(&s_rx_ring)) != NULL) {
+            if (s_first_tx_ns == 0 || frame->tx_ns < s_first_tx_ns) {
+                s_first_tx_ns = frame->tx_ns;
+            }
+            s_current_tx_ns = frame->tx_ns;
+            hub_frame_result_t r = hub_pipeline_frame(&s_pipeline, frame->src_id, frame->data,
+                                                      frame->length - 1u,
+                                                      esp_timer_get_time() / 1000, frame);
+            s_results[r]++;
+            free(frame);
+        }
+        mqtt_batch_poll(&s_batch);
+        // The radio pushes everything before it sets done
+        if (done) {
+            mqtt_batch_flush(&s_batch);
+            return NULL;
+        }
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t *sorted, size_t count, double p)
+{
+    if (count == 0) {
+        return 0;
+    }
+    size_t i = (size_t)(p * (double)(count - 1) + 0.5);
+    return (double)sorted[i] / 1000.0;
+}
+
+static bool sim_run(uint32_t node_count, uint32_t frames_per_node, uint64_t period_ns,
+                    uint8_t publish_mode, sim_result_t *result)
+{
+    memset(&s_bus, 0, sizeof(s_bus));
+    pthread_mutex_init(&s_bus.lock, NULL);
+    pthread_cond_init(&s_bus.ready, NULL);
+    pthread_cond_init(&s_bus.space, NULL);
+    s_bus.blocking = period_ns == 0;
+    free(s_broker.latency_ns);
+    s_broker = (sim_broker_t){ .capacity = (size_t)node_count * frames_per_node };
+    s_broker.latency_ns = calloc(s_broker.capacity, sizeof(uint64_t));
+    frame_ring_init(&s_rx_ring, s_rx_slots, HUB_RX_RING_CAPACITY, FRAME_RING_DROP_OLDEST,
+                    release_frame);
+
+    // The hub's publisher state, as app_main() and the publisher task set it up
+    node_registry_init(&s_nodes, s_node_entries, HUB_NODE_CAPACITY, HUB_DUP_WINDOW_MS);
+    sim_load_rules();
+    tsdb_init(&s_history, s_history_mem, HUB_HISTORY_MAX_NODES);
+    mqtt_batch_init(&s_batch, HUB_BATCH_TOPIC, HUB_BATCH_WINDOW_MS, HUB_BATCH_MAX_MSGS);
+    s_pipeline.publish_mode = publish_mode;
+
+    sem_init(&s_rx_sem, 0, 0);
+    atomic_store(&s_radio_done, false);
+    atomic_store(&s_ring_dropped, 0);
+    atomic_store(&s_sent, 0);
+    s_crc_errors = 0;
+    memset(s_results, 0, sizeof(s_results));
+    s_rules_fired = 0;
+    s_first_tx_ns = 0;
+
+    pthread_t radio, publisher;
+    pthread_create(&publisher, NULL, publisher_thread, NULL);
+    pthread_create(&radio, NULL, radio_thread, NULL);
+
+    sim_node_t *nodes = calloc(node_count, sizeof(*nodes));
+    pthread_t *threads = calloc(node_count, sizeof(*threads));
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SIM_NODE_STACK);
+    // Start times are spread over one period so the nodes do not send in step
+    uint64_t start = bench_now_ns() + 20000000u;
+    for (uint32_t i = 0; i < node_count; i++) {
+        nodes[i] = (sim_node_t){
+            .id        = i + 1,
+            .frames    = frames_per_node,
+            .period_ns = period_ns,
+            .start_ns  = start + period_ns * i / node_count,
+        };
+        if (pthread_create(&threads[i], &attr, node_thread, &nodes[i]) != 0) {
+            fprintf(stderr, "hub_sim: cannot start node %u\n", i + 1);
+            abort();
+        }
+    }
+    for (uint32_t i = 0; i < node_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    bus_close();
+    pthread_join(radio, NULL);
+    pthread_join(publisher, NULL);
+    pthread_attr_destroy(&attr);
+    pthread_cond_destroy(&s_bus.space);
+    pthread_cond_destroy(&s_bus.ready);
+    pthread_mutex_destroy(&s_bus.lock);
+    free(threads);
+    free(nodes);
+    sem_destroy(&s_rx_sem);
+
+    size_t samples = s_broker.samples;
+    qsort(s_broker.latency_ns, samples, sizeof(uint64_t), cmp_u64);
+    *result = (sim_result_t){
+        .sent         = atomic_load(&s_sent),
+        .published    = (uint32_t)s_broker.count,
+        .bus_dropped  = s_bus.dropped,
+        .ring_dropped = atomic_load(&s_ring_dropped),
+        .crc_errors   = s_crc_errors,
+        .malformed    = s_results[HUB_FRAME_MALFORMED] + s_results[HUB_FRAME_TOO_LONG],
+        .duplicates   = s_results[HUB_FRAME_DUPLICATE],
+        .rejected     = s_results[HUB_FRAME_REJECTED],
+        .rules_fired  = s_rules_fired,
+        .known_nodes  = s_nodes.count,
+        .elapsed_ns   = s_broker.count ? s_broker.last_pub_ns - s_first_tx_ns : 0,
+        .p50_us       = percentile_us(s_broker.latency_ns, samples, 0.50),
+        .p99_us       = percentile_us(s_broker.latency_ns, samples, 0.99),
+        .max_us       = percentile_us(s_broker.latency_ns, samples, 1.0),
+    };
+
+    // Every frame a node sent is published or counted where it was lost.
+    // Frames are only rejected once the hub's node table is full (a node
+    // whose every frame the ring shed is never seen at all)
+    uint32_t accounted = result->published + result->bus_dropped + result->ring_dropped
+                       + result->crc_errors + result->malformed + result->duplicates
+                       + result->rejected;
+    bool ok = accounted == result->sent && s_broker.bad_topic == 0
+              && result->crc_errors == 0 && result->malformed == 0 && result->duplicates == 0
+              && result->known_nodes <= node_count && result->known_nodes <= SIM_HUB_MAX_NODES
+              && (result->rejected == 0 || result->known_nodes == SIM_HUB_MAX_NODES)
+              && result->rules_fired != 0;
+    if (!ok) {
+        fprintf(stderr, "hub_sim: %u nodes: sent %u, accounted %u, bad topics %u, "
+                "crc %u, malformed %u, duplicates %u, rejected %u, known nodes %u, "
+                "rules fired %u\n",
+                node_count, result->sent, accounted, s_broker.bad_topic, result->crc_errors,
+                result->malformed, result->duplicates, result->rejected, result->known_nodes,
+                result->rules_fired);
+    }
+    return ok;
+}
+
+static void report(uint32_t node_count, const char *what, double value, const char *unit)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "nodes_%u/%s", node_count, what);
+    bench_value(name, value, unit);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t default_counts[] = { 10, 100, 1000 };
+    uint32_t counts[16];
+    size_t n_counts = 0;
+    for (int i = 1; i < argc && n_counts < 16; i++) {
+        counts[n_counts++] = (uint32_t)strtoul(argv[i], NULL, 10);
+    }
+    if (n_counts == 0) {
+        memcpy(counts, default_counts, sizeof(default_counts));
+        n_counts = 3;
+    }
+
+    s_history_mem = aligned_alloc(8, tsdb_mem_size(HUB_HISTORY_MAX_NODES));
+    s_pipeline = (hub_pipeline_t){
+        .nodes       = &s_nodes,
+        .rules       = &s_rules,
+        .rules_lock  = xSemaphoreCreateMutex(),
+        .rule_action = sim_rule_action,
+        .history     = &s_history,
+        .batch       = &s_batch,
+    };
+
+    bool ok = true;
+    bench_begin("hub_sim");
+    for (size_t c = 0; c < n_counts; c++) {
+        uint32_t nodes = counts[c];
+        if (nodes == 0 || nodes > SIM_MAX_NODES) {
+            fprintf(stderr, "hub_sim: node count must be 1..%u\n", SIM_MAX_NODES);
+            return EXIT_FAILURE;
+        }
+        sim_result_t r;
+
+        // Every node flat out: what the hub sustains and what its RX ring sheds
+        uint32_t burst = (SIM_BURST_FRAMES + nodes - 1) / nodes;
+        ok &= sim_run(nodes, burst, 0, HUB_PUBLISH_PER_NODE, &r);
+        report(nodes, "saturated/throughput", r.elapsed_ns ? r.published * 1e9 / r.elapsed_ns : 0,
+               "frames/s");
+        report(nodes, "saturated/ring_dropped", r.ring_dropped, "frames");
+        report(nodes, "saturated/rejected", r.rejected, "frames");
+        report(nodes, "known_nodes", r.known_nodes, "nodes");
+
+        // The same with HUB_PUBLISH_BATCHED: readings per second in batches
+        ok &= sim_run(nodes, burst, 0, HUB_PUBLISH_BATCHED, &r);
+        report(nodes, "batched/throughput", r.elapsed_ns ? r.published * 1e9 / r.elapsed_ns : 0,
+               "frames/s");
+        report(nodes, "batched/ring_dropped", r.ring_dropped, "frames");
+
+        // Fixed offered load spread over the nodes: end-to-end latency
+        uint64_t period_ns = 1000000000ull * nodes / SIM_OFFERED_FPS;
+        uint32_t frames = (uint32_t)((uint64_t)SIM_PACED_MS * 1000000u / period_ns);
+        ok &= sim_run(nodes, frames ? frames : 1, period_ns, HUB_PUBLISH_PER_NODE, &r);
+        report(nodes, "paced/offered", SIM_OFFERED_FPS, "frames/s");
+        report(nodes, "paced/latency_p50", r.p50_us, "us");
+        report(nodes, "paced/latency_p99", r.p99_us, "us");
+        report(nodes, "paced/latency_max", r.max_us, "us");
+        report(nodes, "paced/lost", r.bus_dropped + r.ring_dropped, "frames");
+        report(nodes, "paced/rules_fired", r.rules_fired, "commands");
+    }
+    bench_end();
+    free(s_broker.latency_ns);
+    free(s_history_mem);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/*
+ * Host stand-in for binlog.h: records are dropped. Not format-checked like
+ * printf, because binlog stores every argument as a uint32_t and formats
+ * it later, so "%u" is right for any integer argument.
+ */
+
+static inline void binlog_host_drop(const char *tag, const char *fmt, ...)
+{
+    (void)tag;
+    (void)fmt;
+}
+
+#define BINLOG_E(tag, fmt, ...)  binlog_host_drop(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_W(tag, fmt, ...)  binlog_host_drop(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_I(tag, fmt, ...)  binlog_host_drop(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_D(tag, fmt, ...)  binlog_host_drop(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_V(tag, fmt, ...)  binlog_host_drop(tag, fmt, ##__VA_ARGS__)
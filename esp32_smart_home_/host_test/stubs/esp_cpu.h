@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+/* Host stand-in for esp_cpu.h: one core, and a nanosecond clock as the cycle counter */
+
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static inline int esp_cpu_get_core_id(void)
+{
+    return 0;
+}
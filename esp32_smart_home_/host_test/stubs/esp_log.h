@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+ * Host stand-in for esp_log.h: errors and warnings go to stderr, the rest is
+ * dropped. Targets that are driven into warnings on purpose (e.g. the
+ * simulation filling the node table) define ESP_LOG_HOST_QUIET to drop
+ * warnings too.
+ */
+
+#define ESP_LOG_DROP(tag, fmt, ...) do { (void)(tag); if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#ifdef ESP_LOG_HOST_QUIET
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+#else
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#endif
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
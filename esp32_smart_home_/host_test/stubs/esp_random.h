@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Host stand-in for esp_random.h; fake/esp_timer_fake.c gives a repeatable sequence */
+
+uint32_t esp_random(void);
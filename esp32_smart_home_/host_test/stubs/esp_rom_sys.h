@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Host stand-in for esp_rom_sys.h; matches the nanosecond "cycles" of esp_cpu.h */
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return 1000;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Host stand-in for the FreeRTOS types used by the shared components */
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+
+#define pdFALSE         0
+#define pdTRUE          1
+#define portMAX_DELAY   ((TickType_t)0xFFFFFFFF)
+
+#define portDISABLE_INTERRUPTS()   ((void)0)
+#define portENABLE_INTERRUPTS()    ((void)0)
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+/*
+ * Host stand-in for FreeRTOS mutexes. The host tests run on one thread, so
+ * a mutex only records that it is held; taking it twice would deadlock on
+ * the target and aborts here.
+ */
+
+typedef struct {
+    int held;
+} host_mutex_t;
+
+typedef host_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(host_mutex_t));
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    (void)ticks;
+    if (mutex->held) {
+        fprintf(stderr, "xSemaphoreTake: mutex already held, would deadlock\n");
+        abort();
+    }
+    mutex->held = 1;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    mutex->held = 0;
+    return pdTRUE;
+}
@@ -0,0 +1,150 @@
+#include "ccs811.h"
+#include "ccs811_fake.h"
+#include "unit_test.h"
+
+static ccs811_fake_t s_fake;
+static ccs811_t s_dev;
+
+static esp_err_t start(ccs811_mode_t mode, bool use_int)
+{
+    ccs811_bus_t bus = ccs811_fake_bus(&s_fake);
+    return ccs811_init(&s_dev, &bus, mode, use_int);
+}
+
+static void test_init_from_boot_mode(void)
+{
+    ccs811_fake_init(&s_fake);
+    CHECK_EQ(start(CCS811_MODE_10S, true), ESP_OK);
+    CHECK(s_dev.running);
+    CHECK(s_fake.app_mode);
+    CHECK_EQ(s_fake.app_start_writes, 1);
+    CHECK_EQ(s_fake.meas_mode_writes, 1);
+    CHECK_EQ(s_fake.meas_mode, 0x28);   // DRIVE_MODE 2, INTERRUPT on data ready
+    CHECK_EQ(ccs811_fake_last_delay_us(), 1000);
+    CHECK_EQ(s_fake.error_id, 0);
+}
+
+static void test_init_already_running(void)
+{
+    // After a soft reset of the MCU the sensor stays in application mode
+    ccs811_fake_init(&s_fake);
+    s_fake.app_mode = true;
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_OK);
+    CHECK_EQ(s_fake.app_start_writes, 0);
+    CHECK_EQ(s_fake.meas_mode, 0x10);
+}
+
+static void test_init_failures(void)
+{
+    ccs811_fake_init(&s_fake);
+    s_fake.hw_id = 0x55;
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_ERR_NOT_FOUND);
+    CHECK(!s_dev.running);
+
+    ccs811_fake_init(&s_fake);
+    s_fake.app_valid = false;
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(s_fake.app_start_writes, 0);
+
+    ccs811_fake_init(&s_fake);
+    s_fake.nack = true;
+    CHECK(start(CCS811_MODE_1S, false) != ESP_OK);
+    CHECK(!s_dev.running);
+
+    // Reads fail cleanly before a successful init
+    uint16_t co2, tvoc;
+    CHECK_EQ(ccs811_read(&s_dev, &co2, &tvoc), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(ccs811_set_env(&s_dev, 2500, 5000), ESP_ERR_INVALID_STATE);
+}
+
+static void test_data_ready_polling(void)
+{
+    ccs811_fake_init(&s_fake);
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_OK);
+
+    bool ready = true;
+    uint16_t co2 = 0, tvoc = 0;
+    CHECK_EQ(ccs811_data_ready(&s_dev, &ready), ESP_OK);
+    CHECK(!ready);
+    CHECK_EQ(ccs811_read(&s_dev, &co2, &tvoc), ESP_ERR_NOT_FINISHED);
+
+    // Many measurement periods: every sample is read once, and the
+    // algorithm is never restarted
+    for (uint16_t i = 0; i < 50; i++) {
+        ccs811_fake_sample(&s_fake, (uint16_t)(400 + i), (uint16_t)(10 + i));
+        CHECK_EQ(ccs811_data_ready(&s_dev, &ready), ESP_OK);
+        CHECK(ready);
+        CHECK_EQ(ccs811_read(&s_dev, &co2, &tvoc), ESP_OK);
+        CHECK_EQ(co2, 400 + i);
+        CHECK_EQ(tvoc, 10 + i);
+        CHECK_EQ(ccs811_read(&s_dev, &co2, &tvoc), ESP_ERR_NOT_FINISHED);
+    }
+    CHECK_EQ(s_fake.app_start_writes, 1);
+    CHECK_EQ(s_fake.meas_mode_writes, 1);
+}
+
+static void test_sensor_error(void)
+{
+    ccs811_fake_init(&s_fake);
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_OK);
+
+    bool ready;
+    s_fake.error_id = 0x10;     // HEATER_FAULT
+    CHECK_EQ(ccs811_data_ready(&s_dev, &ready), ESP_FAIL);
+    CHECK(!ready);
+    CHECK_EQ(s_dev.last_error, 0x10);
+    CHECK_EQ(s_fake.error_id, 0);   // reading ERROR_ID clears it
+
+    uint16_t co2, tvoc;
+    ccs811_fake_sample(&s_fake, 500, 20);
+    s_fake.error_id = 0x08;     // MAX_RESISTANCE, reported inside ALG_RESULT_DATA
+    CHECK_EQ(ccs811_read(&s_dev, &co2, &tvoc), ESP_FAIL);
+    CHECK_EQ(s_dev.last_error, 0x08);
+}
+
+static void test_environment_compensation(void)
+{
+    ccs811_fake_init(&s_fake);
+    CHECK_EQ(start(CCS811_MODE_1S, false), ESP_OK);
+
+    // Datasheet examples: 48.5 %RH -> 0x6100, 25 °C -> 0x6400
+    CHECK_EQ(ccs811_set_env(&s_dev, 2500, 4850), ESP_OK);
+    CHECK_EQ(s_fake.env[0], 0x61);
+    CHECK_EQ(s_fake.env[1], 0x00);
+    CHECK_EQ(s_fake.env[2], 0x64);
+    CHECK_EQ(s_fake.env[3], 0x00);
+
+    // -10.25 °C: (25 - 10.25) * 512 = 7552
+    CHECK_EQ(ccs811_set_env(&s_dev, -1025, 0), ESP_OK);
+    CHECK_EQ((s_fake.env[2] << 8) | s_fake.env[3], 7552);
+
+    // Out-of-range input is clamped instead of wrapping
+    CHECK_EQ(ccs811_set_env(&s_dev, -4000, 12000), ESP_OK);
+    CHECK_EQ((s_fake.env[0] << 8) | s_fake.env[1], 100 * 512);
+    CHECK_EQ((s_fake.env[2] << 8) | s_fake.env[3], 0);
+    CHECK_EQ(s_fake.env_writes, 3);
+    CHECK_EQ(s_fake.error_id, 0);
+}
+
+static void test_baseline(void)
+{
+    ccs811_fake_init(&s_fake);
+    CHECK_EQ(start(CCS811_MODE_60S, false), ESP_OK);
+    uint16_t baseline = 0;
+    CHECK_EQ(ccs811_set_baseline(&s_dev, 0xA5C3), ESP_OK);
+    CHECK_EQ(ccs811_get_baseline(&s_dev, &baseline), ESP_OK);
+    CHECK_EQ(baseline, 0xA5C3);
+    CHECK_EQ(s_fake.error_id, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init_from_boot_mode);
+    RUN_TEST(test_init_already_running);
+    RUN_TEST(test_init_failures);
+    RUN_TEST(test_data_ready_polling);
+    RUN_TEST(test_sensor_error);
+    RUN_TEST(test_environment_compensation);
+    RUN_TEST(test_baseline);
+    TEST_EXIT();
+}
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include "crc_utils.h"
+#include "unit_test.h"
+
+static const uint8_t k_check[] = "123456789";
+
+/* Bit-by-bit CRC-8 the table has to reproduce */
+static uint8_t crc8_bitwise(const uint8_t *data, size_t length)
+{
+    uint8_t crc = 0x00;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t extract = data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t sum = (crc ^ extract) & 0x01;
+            crc >>= 1;
+            if (sum) crc ^= 0x8C;
+            extract >>= 1;
+        }
+    }
+    return crc;
+}
+
+static void test_check_values(void)
+{
+    CHECK_EQ(compute_crc8(k_check, 9), 0xA1);           // CRC-8/MAXIM
+    CHECK_EQ(compute_crc16_ccitt(k_check, 9), 0x29B1);  // CRC-16/CCITT-FALSE
+    CHECK_EQ(compute_crc16_modbus(k_check, 9), 0x4B37);
+    CHECK_EQ(compute_crc8(k_check, 0), 0x00);
+    CHECK_EQ(compute_crc16_ccitt(k_check, 0), 0xFFFF);
+}
+
+static void test_crc8_matches_bitwise(void)
+{
+    uint8_t data[300];
+    srand(7);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)rand();
+    }
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        CHECK_EQ(compute_crc8(data, len), crc8_bitwise(data, len));
+    }
+    for (int b = 0; b < 256; b++) {
+        uint8_t byte = (uint8_t)b;
+        CHECK_EQ(compute_crc8(&byte, 1), crc8_bitwise(&byte, 1));
+    }
+}
+
+static void test_streaming(void)
+{
+    uint8_t data[64];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+    // Any split into chunks gives the one-shot result
+    for (size_t split = 0; split <= sizeof(data); split++) {
+        crc_ctx_t ctx;
+        crc_init(&ctx, CRC_MODE_8);
+        crc_update(&ctx, data, split);
+        crc_update(&ctx, data + split, sizeof(data) - split);
+        CHECK_EQ(crc_final(&ctx), compute_crc8(data, sizeof(data)));
+
+        crc_init(&ctx, CRC_MODE_16);
+        crc_update(&ctx, data, split);
+        crc_update(&ctx, data + split, sizeof(data) - split);
+        CHECK_EQ(crc_final(&ctx), compute_crc16_ccitt(data, sizeof(data)));
+    }
+    CHECK_EQ(crc_size(CRC_MODE_8), 1);
+    CHECK_EQ(crc_size(CRC_MODE_16), 2);
+}
+
+int main(void)
+{
+    RUN_TEST(test_check_values);
+    RUN_TEST(test_crc8_matches_bitwise);
+    RUN_TEST(test_streaming);
+    TEST_EXIT();
+}
@@ -0,0 +1,175 @@
+#include <string.h>
+#include "frame_codec.h"
+#include "unit_test.h"
+
+static const telemetry_frame_t k_full = {
+    .seq = 200, .fields = TELEMETRY_F_ALL,
+    .temperature = -1234, .humidity = 6543, .co2 = 1250, .tvoc = 87, .light = 40000,
+    .flags = TELEMETRY_FLAG_MOTION | TELEMETRY_FLAG_LEAK,
+    .node = 0x0123456789ABCDEFull,
+};
+
+/* Field bytes a frame with @p fields must carry */
+static size_t expected_len(uint16_t fields)
+{
+    static const size_t sizes[] = { 2, 2, 2, 2, 2, 1, 8 };
+    size_t len = TELEMETRY_HEADER_LEN;
+    for (int i = 0; i < 7; i++) {
+        if (fields & (1u << i)) len += sizes[i];
+    }
+    return len;
+}
+
+static void test_full_round_trip(void)
+{
+    uint8_t buf[TELEMETRY_MAX_LEN];
+    telemetry_frame_t out;
+    size_t n = telemetry_encode(&k_full, buf, sizeof(buf));
+    CHECK_EQ(n, TELEMETRY_MAX_LEN);
+    CHECK(frame_is_telemetry(buf, n));
+    CHECK(telemetry_decode(buf, n, &out));
+    CHECK(memcmp(&out, &k_full, sizeof(out)) == 0);
+
+    // Header and little-endian layout are part of the wire format
+    CHECK_EQ(buf[0], FRAME_TYPE_TELEMETRY);
+    CHECK_EQ(buf[1], TELEMETRY_VERSION);
+    CHECK_EQ(buf[2], 200);
+    CHECK_EQ(buf[3], TELEMETRY_F_ALL);
+    CHECK_EQ(buf[4], 0);
+    CHECK_EQ(buf[5], (uint8_t)(-1234 & 0xFF));
+    CHECK_EQ(buf[6], (uint8_t)((uint16_t)-1234 >> 8));
+    CHECK_EQ(buf[15], k_full.flags);
+    CHECK_EQ(buf[16], 0xEF);
+    CHECK_EQ(buf[23], 0x01);
+}
+
+static void test_every_field_mask(void)
+{
+    for (uint16_t fields = 0; fields <= TELEMETRY_F_ALL; fields++) {
+        telemetry_frame_t in = k_full, out;
+        in.fields = fields;
+        uint8_t buf[TELEMETRY_MAX_LEN];
+        size_t n = telemetry_encode(&in, buf, sizeof(buf));
+        CHECK_EQ(n, expected_len(fields));
+        CHECK(telemetry_decode(buf, n, &out));
+        CHECK_EQ(out.fields, fields);
+        CHECK_EQ(out.seq, in.seq);
+        // Present fields survive, absent ones decode as zero
+        CHECK_EQ(out.temperature, (fields & TELEMETRY_F_TEMPERATURE) ? in.temperature : 0);
+        CHECK_EQ(out.humidity, (fields & TELEMETRY_F_HUMIDITY) ? in.humidity : 0);
+        CHECK_EQ(out.co2, (fields & TELEMETRY_F_CO2) ? in.co2 : 0);
+        CHECK_EQ(out.tvoc, (fields & TELEMETRY_F_TVOC) ? in.tvoc : 0);
+        CHECK_EQ(out.light, (fields & TELEMETRY_F_LIGHT) ? in.light : 0);
+        CHECK_EQ(out.flags, (fields & TELEMETRY_F_FLAGS) ? in.flags : 0);
+        CHECK(out.node == ((fields & TELEMETRY_F_NODE) ? in.node : 0));
+
+        // The encoder never writes past what it reports
+        if (n > 0) {
+            CHECK_EQ(telemetry_encode(&in, buf, n - 1), 0);
+        }
+    }
+}
+
+static void test_truncated_and_trailing(void)
+{
+    uint8_t buf[TELEMETRY_MAX_LEN + 1];
+    telemetry_frame_t out;
+    size_t n = telemetry_encode(&k_full, buf, sizeof(buf));
+    for (size_t len = 0; len < n; len++) {
+        CHECK(!telemetry_decode(buf, len, &out));
+    }
+    buf[n] = 0;
+    CHECK(!telemetry_decode(buf, n + 1, &out));
+}
+
+static void test_malformed_header(void)
+{
+    uint8_t buf[TELEMETRY_MAX_LEN];
+    telemetry_frame_t out;
+    size_t n = telemetry_encode(&k_full, buf, sizeof(buf));
+
+    buf[0] = '{';
+    CHECK(!frame_is_telemetry(buf, n));
+    CHECK(!telemetry_decode(buf, n, &out));
+    buf[0] = FRAME_TYPE_TELEMETRY;
+
+    buf[1] = TELEMETRY_VERSION + 1;
+    CHECK(!telemetry_decode(buf, n, &out));
+    buf[1] = TELEMETRY_VERSION;
+
+    // An unknown field bit cannot be skipped in the fixed layout
+    buf[3] |= 0x80;
+    CHECK(!telemetry_decode(buf, n, &out));
+    buf[3] = TELEMETRY_F_ALL;
+    buf[4] = 0x01;
+    CHECK(!telemetry_decode(buf, n, &out));
+    buf[4] = 0;
+    CHECK(telemetry_decode(buf, n, &out));
+}
+
+static void test_to_json(void)
+{
+    telemetry_frame_t frame = k_full;
+    frame.fields &= (uint16_t)~TELEMETRY_F_TVOC;
+    frame.flags = TELEMETRY_FLAG_LEAK;
+    char json[128];
+    int n = telemetry_to_json(&frame, json, sizeof(json));
+    const char *expected = "{\"temperature\":-12.34,\"humidity\":65.43,\"co2\":1250,"
+                           "\"light\":40000,\"motion\":false,\"leak\":true}";
+    CHECK_EQ(n, strlen(expected));
+    CHECK(strcmp(json, expected) == 0);
+
+    // Sub-degree negatives keep their sign
+    frame = (telemetry_frame_t){ .fields = TELEMETRY_F_TEMPERATURE, .temperature = -5 };
+    telemetry_to_json(&frame, json, sizeof(json));
+    CHECK(strcmp(json, "{\"temperature\":-0.05}") == 0);
+
+    frame.fields = 0;
+    CHECK_EQ(telemetry_to_json(&frame, json, sizeof(json)), 2);
+    CHECK(strcmp(json, "{}") == 0);
+
+    // Too small a buffer fails cleanly with an empty string
+    CHECK_EQ(telemetry_to_json(&k_full, json, 20), -1);
+    CHECK_EQ(json[0], '\0');
+    CHECK_EQ(telemetry_to_json(&k_full, json, 0), -1);
+}
+
+static void test_actuator_cmd(void)
+{
+    actuator_cmd_t in = { .relay_mask = 0x05, .relay_values = 0xFF, .servo_mask = 0x82 }, out;
+    in.servo_angle[1] = 90;
+    in.servo_angle[7] = 180;
+    uint8_t buf[ACTUATOR_CMD_MAX_LEN + 1];
+    size_t n = actuator_cmd_encode(&in, buf, sizeof(buf));
+    CHECK_EQ(n, ACTUATOR_CMD_HEADER_LEN + 2);
+    CHECK(actuator_cmd_decode(buf, n, &out));
+    CHECK_EQ(out.relay_mask, 0x05);
+    CHECK_EQ(out.relay_values, 0x05);   // values outside the mask are dropped
+    CHECK_EQ(out.servo_mask, 0x82);
+    CHECK_EQ(out.servo_angle[1], 90);
+    CHECK_EQ(out.servo_angle[7], 180);
+
+    for (size_t len = 0; len < n; len++) {
+        CHECK(!actuator_cmd_decode(buf, len, &out));
+    }
+    buf[n] = 0;
+    CHECK(!actuator_cmd_decode(buf, n + 1, &out));
+    buf[0] = ACTUATOR_CMD_VERSION + 1;
+    CHECK(!actuator_cmd_decode(buf, n, &out));
+    CHECK_EQ(actuator_cmd_encode(&in, buf, n - 1), 0);
+
+    // Every servo set gives the longest command
+    in.servo_mask = 0xFF;
+    CHECK_EQ(actuator_cmd_encode(&in, buf, sizeof(buf)), ACTUATOR_CMD_MAX_LEN);
+}
+
+int main(void)
+{
+    RUN_TEST(test_full_round_trip);
+    RUN_TEST(test_every_field_mask);
+    RUN_TEST(test_truncated_and_trailing);
+    RUN_TEST(test_malformed_header);
+    RUN_TEST(test_to_json);
+    RUN_TEST(test_actuator_cmd);
+    TEST_EXIT();
+}
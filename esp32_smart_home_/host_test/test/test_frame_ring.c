@@ -0,0 +1,163 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "frame_ring.h"
+#include "unit_test.h"
+
+#define CAPACITY 8
+
+static frame_slot_t s_slots[CAPACITY];
+static frame_ring_t s_ring;
+static int s_released[64];
+static int s_release_count;
+
+static void record_release(void *frame)
+{
+    s_released[s_release_count++] = (int)(intptr_t)frame;
+}
+
+/* Frames are small integers; 0 would read as "empty" */
+static void *frame(int n)
+{
+    return (void *)(intptr_t)n;
+}
+
+static void test_init(void)
+{
+    CHECK(!frame_ring_init(&s_ring, s_slots, 0, FRAME_RING_DROP_NEWEST, NULL));
+    CHECK(!frame_ring_init(&s_ring, s_slots, 6, FRAME_RING_DROP_NEWEST, NULL));
+    CHECK(frame_ring_init(&s_ring, s_slots, CAPACITY, FRAME_RING_DROP_NEWEST, NULL));
+    CHECK(frame_ring_pop(&s_ring) == NULL);
+    CHECK_EQ(frame_ring_depth(&s_ring), 0);
+}
+
+static void test_fifo_wraps(void)
+{
+    frame_ring_init(&s_ring, s_slots, CAPACITY, FRAME_RING_DROP_NEWEST, NULL);
+    int next_in = 1, next_out = 1;
+    // Uneven batches walk the indices around the ring several times
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < round % CAPACITY + 1; i++) {
+            CHECK(frame_ring_push(&s_ring, frame(next_in++)));
+        }
+        void *f;
+        while ((f = frame_ring_pop(&s_ring)) != NULL) {
+            CHECK(f == frame(next_out++));
+        }
+    }
+    CHECK_EQ(next_in, next_out);
+}
+
+static void test_drop_newest(void)
+{
+    frame_ring_init(&s_ring, s_slots, CAPACITY, FRAME_RING_DROP_NEWEST, record_release);
+    s_release_count = 0;
+    for (int i = 1; i <= CAPACITY; i++) {
+        CHECK(frame_ring_push(&s_ring, frame(i)));
+    }
+    // The caller keeps a rejected reference; nothing is released
+    CHECK(!frame_ring_push(&s_ring, frame(100)));
+    CHECK(!frame_ring_push(&s_ring, frame(101)));
+    CHECK_EQ(s_release_count, 0);
+
+    frame_ring_stats_t stats;
+    frame_ring_get_stats(&s_ring, &stats);
+    CHECK_EQ(stats.capacity, CAPACITY);
+    CHECK_EQ(stats.depth, CAPACITY);
+    CHECK_EQ(stats.high_water, CAPACITY);
+    CHECK_EQ(stats.dropped_full, 2);
+    CHECK(frame_ring_pop(&s_ring) == frame(1));
+    CHECK(frame_ring_push(&s_ring, frame(9)));
+}
+
+static void test_drop_oldest(void)
+{
+    frame_ring_init(&s_ring, s_slots, CAPACITY, FRAME_RING_DROP_OLDEST, record_release);
+    s_release_count = 0;
+    for (int i = 1; i <= CAPACITY + 3; i++) {
+        CHECK(frame_ring_push(&s_ring, frame(i)));
+    }
+    // The three oldest went to the release callback, in order
+    CHECK_EQ(s_release_count, 3);
+    CHECK_EQ(s_released[0], 1);
+    CHECK_EQ(s_released[2], 3);
+    for (int i = 4; i <= CAPACITY + 3; i++) {
+        CHECK(frame_ring_pop(&s_ring) == frame(i));
+    }
+    CHECK(frame_ring_pop(&s_ring) == NULL);
+
+    frame_ring_stats_t stats;
+    frame_ring_get_stats(&s_ring, &stats);
+    CHECK_EQ(stats.dropped_full, 3);
+    CHECK_EQ(stats.depth, 0);
+}
+
+/*
+ * Producer and consumer on separate threads with a ring much smaller than
+ * the burst: every frame must come out of the ring or the release
+ * callback exactly once, and the consumer must see them in order.
+ */
+#define SPSC_FRAMES 200000
+
+static frame_slot_t s_spsc_slots[4];
+static frame_ring_t s_spsc_ring;
+static atomic_int s_spsc_released;
+static _Atomic uint8_t s_spsc_seen[SPSC_FRAMES + 1];
+
+static void spsc_release(void *f)
+{
+    atomic_fetch_add(&s_spsc_released, 1);
+    atomic_fetch_add(&s_spsc_seen[(intptr_t)f], 1);
+}
+
+static void *spsc_producer(void *arg)
+{
+    for (int i = 1; i <= SPSC_FRAMES; i++) {
+        frame_ring_push(arg, frame(i));
+    }
+    return NULL;
+}
+
+static void test_spsc_threads(void)
+{
+    frame_ring_init(&s_spsc_ring, s_spsc_slots, 4, FRAME_RING_DROP_OLDEST, spsc_release);
+    pthread_t producer;
+    CHECK_EQ(pthread_create(&producer, NULL, spsc_producer, &s_spsc_ring), 0);
+
+    int popped = 0, ordered = 1;
+    intptr_t last = 0;
+    for (;;) {
+        void *f = frame_ring_pop(&s_spsc_ring);
+        if (f) {
+            ordered &= (intptr_t)f > last;
+            last = (intptr_t)f;
+            atomic_fetch_add(&s_spsc_seen[last], 1);
+            popped++;
+            continue;
+        }
+        // Only older frames are dropped, so the last one always arrives
+        if (last == SPSC_FRAMES) {
+            break;
+        }
+    }
+    pthread_join(producer, NULL);
+    CHECK(frame_ring_pop(&s_spsc_ring) == NULL);
+
+    CHECK(ordered);
+    CHECK_EQ(popped + atomic_load(&s_spsc_released), SPSC_FRAMES);
+    int once = 1;
+    for (int i = 1; i <= SPSC_FRAMES; i++) {
+        once &= atomic_load(&s_spsc_seen[i]) == 1;
+    }
+    CHECK(once);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_fifo_wraps);
+    RUN_TEST(test_drop_newest);
+    RUN_TEST(test_drop_oldest);
+    RUN_TEST(test_spsc_threads);
+    TEST_EXIT();
+}
@@ -0,0 +1,197 @@
+#include <math.h>
+#include <stdlib.h>
+#include "fx_filter.h"
+#include "unit_test.h"
+
+/*
+ * Fixed-point filters against float references of the same recurrences.
+ * Inputs are in 0.01 °C and cross zero, as outdoor temperatures do.
+ */
+
+#define SAMPLES 2000
+
+static int32_t s_signal[SAMPLES];
+
+/* Ramp from -15 °C to +15 °C with ±0.5 °C noise and a step in the middle */
+static void make_signal(void)
+{
+    uint32_t lcg = 12345;
+    for (int i = 0; i < SAMPLES; i++) {
+        lcg = lcg * 1103515245u + 12345u;
+        int32_t noise = (int32_t)((lcg >> 16) % 101) - 50;
+        int32_t base = -1500 + i * 3000 / SAMPLES;
+        if (i >= SAMPLES / 2 && i < SAMPLES / 2 + 200) {
+            base -= 2000;
+        }
+        s_signal[i] = base + noise;
+    }
+}
+
+/* Largest |fixed - round(float)| and mean fixed - float, in sample units */
+typedef struct {
+    int    max_err;
+    double bias;
+} fx_error_t;
+
+static void track(fx_error_t *e, int32_t fixed, double ref)
+{
+    int err = abs(fixed - (int32_t)lround(ref));
+    if (err > e->max_err) {
+        e->max_err = err;
+    }
+    e->bias += ((double)fixed - ref) / SAMPLES;
+}
+
+static void test_moving_average(void)
+{
+    for (uint8_t window = 1; window <= FX_MA_MAX_WINDOW; window++) {
+        fx_ma_t f;
+        fx_ma_init(&f, window);
+        // moving_avg_t from the original sensor node, in double
+        double buf[FX_MA_MAX_WINDOW] = { 0 }, sum = 0;
+        int index = 0, count = 0;
+        fx_error_t e = { 0 };
+        for (int i = 0; i < SAMPLES; i++) {
+            if (count < window) {
+                count++;
+            } else {
+                sum -= buf[index];
+            }
+            buf[index] = s_signal[i];
+            sum += s_signal[i];
+            index = (index + 1) % window;
+            track(&e, fx_ma_update(&f, s_signal[i]), sum / count);
+        }
+        // Integer sums are exact, only the final rounding can differ
+        CHECK_EQ(e.max_err, 0);
+    }
+}
+
+static void test_ema(void)
+{
+    static const double alphas[] = { 0.05, 0.1, 0.25, 0.5, 1.0 };
+    for (size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); a++) {
+        fx_ema_t f;
+        int32_t alpha_q16 = (int32_t)(alphas[a] * 65536.0 + 0.5);
+        fx_ema_init(&f, alpha_q16);
+        double y = s_signal[0], alpha = alpha_q16 / 65536.0;
+        fx_error_t e = { 0 };
+        for (int i = 0; i < SAMPLES; i++) {
+            if (i > 0) {
+                y += alpha * (s_signal[i] - y);
+            }
+            track(&e, fx_ema_update(&f, s_signal[i]), y);
+        }
+        CHECK(e.max_err <= 1);
+        CHECK(fabs(e.bias) < 0.05);
+    }
+}
+
+static void test_kalman(void)
+{
+    static const int32_t cases[][2] = { { 1, 2500 }, { 4, 900 }, { 25, 400 }, { 25, 100 } };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        fx_kalman_t f;
+        fx_kalman_init(&f, cases[c][0], cases[c][1]);
+        double x = s_signal[0], p = cases[c][1], q = cases[c][0], r = cases[c][1];
+        fx_error_t e = { 0 };
+        for (int i = 0; i < SAMPLES; i++) {
+            if (i > 0) {
+                p += q;
+                double k = p / (p + r);
+                x += k * (s_signal[i] - x);
+                p *= 1 - k;
+            }
+            track(&e, fx_kalman_update(&f, s_signal[i]), x);
+        }
+        CHECK(e.max_err <= 1);
+        CHECK(fabs(e.bias) < 0.05);
+    }
+}
+
+static int cmp_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void test_median(void)
+{
+    for (uint8_t size = 1; size <= FX_MEDIAN_MAX; size += 2) {
+        fx_median_t f;
+        fx_median_init(&f, size);
+        int mismatches = 0;
+        for (int i = 0; i < SAMPLES; i++) {
+            int32_t got = fx_median_update(&f, s_signal[i]);
+            int n = i + 1 < size ? i + 1 : size;
+            int32_t window[FX_MEDIAN_MAX];
+            for (int j = 0; j < n; j++) {
+                window[j] = s_signal[i - j];
+            }
+            qsort(window, (size_t)n, sizeof(int32_t), cmp_i32);
+            mismatches += got != window[n / 2];
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+
+    // A single-sample spike never reaches the output of a median of 3
+    fx_median_t f;
+    fx_median_init(&f, 3);
+    static const int32_t spiky[] = { -500, -501, 8000, -502, -499, -32000, -500 };
+    for (size_t i = 0; i < sizeof(spiky) / sizeof(spiky[0]); i++) {
+        int32_t y = fx_median_update(&f, spiky[i]);
+        CHECK(y <= -499 && y >= -502);
+    }
+}
+
+static void test_negative_steady_state(void)
+{
+    // A constant sub-zero input settles exactly on itself
+    fx_ema_t ema;
+    fx_kalman_t kalman;
+    fx_ema_init(&ema, FX_Q16(0.1));
+    fx_kalman_init(&kalman, 1, 400);
+    int32_t y_ema = 0, y_kalman = 0;
+    for (int i = 0; i < 500; i++) {
+        y_ema = fx_ema_update(&ema, -2735);
+        y_kalman = fx_kalman_update(&kalman, -2735);
+    }
+    CHECK_EQ(y_ema, -2735);
+    CHECK_EQ(y_kalman, -2735);
+
+    // The widest channel range still fits Q8 in int32: 65535 lux
+    fx_ema_init(&ema, FX_Q16(0.5));
+    for (int i = 0; i < 50; i++) {
+        y_ema = fx_ema_update(&ema, 65535);
+    }
+    CHECK_EQ(y_ema, 65535);
+}
+
+static void test_chain(void)
+{
+    fx_chain_cfg_t cfg = { .median = 3, .smooth = FX_SMOOTH_EMA, .ema_alpha = FX_Q16(0.25) };
+    fx_chain_t f;
+    fx_chain_init(&f, &cfg);
+    int32_t y = 0;
+    for (int i = 0; i < 100; i++) {
+        // A spike every tenth sample is removed before the EMA sees it
+        y = fx_chain_update(&f, i % 10 == 5 ? 9000 : -1200);
+        CHECK_EQ(y, -1200);
+    }
+
+    cfg = (fx_chain_cfg_t){ .smooth = FX_SMOOTH_NONE };
+    fx_chain_init(&f, &cfg);
+    CHECK_EQ(fx_chain_update(&f, -17), -17);
+}
+
+int main(void)
+{
+    make_signal();
+    RUN_TEST(test_moving_average);
+    RUN_TEST(test_ema);
+    RUN_TEST(test_kalman);
+    RUN_TEST(test_median);
+    RUN_TEST(test_negative_steady_state);
+    RUN_TEST(test_chain);
+    TEST_EXIT();
+}
@@ -0,0 +1,163 @@
+#include <string.h>
+#include "node_registry.h"
+#include "unit_test.h"
+
+#define CAPACITY 16
+
+static node_entry_t s_entries[CAPACITY];
+static node_registry_t s_reg;
+
+static void reset(void)
+{
+    CHECK(node_registry_init(&s_reg, s_entries, CAPACITY, 2000));
+}
+
+static void test_init_capacity(void)
+{
+    CHECK(!node_registry_init(&s_reg, s_entries, 0, 2000));
+    CHECK(!node_registry_init(&s_reg, s_entries, 12, 2000));
+    reset();
+    CHECK_EQ(s_reg.count, 0);
+    CHECK(node_registry_find(&s_reg, 0x1122334455667788ull) == NULL);
+}
+
+static void test_touch_and_find(void)
+{
+    reset();
+    node_entry_t *a = node_registry_touch(&s_reg, 0x60554400001A2B3Cull, 0x4400, 1000);
+    CHECK(a != NULL);
+    CHECK_EQ(s_reg.count, 1);
+    CHECK(strcmp(a->id, "60554400001a2b3c") == 0);
+    CHECK(strcmp(a->topic, "home/sensors/60554400001a2b3c") == 0);
+    CHECK_EQ(a->last_seen_ms, 1000);
+
+    // Same key after re-attach: same entry, new RLOC16, no new slot
+    node_entry_t *again = node_registry_touch(&s_reg, 0x60554400001A2B3Cull, 0x8001, 5000);
+    CHECK(again == a);
+    CHECK_EQ(a->rloc16, 0x8001);
+    CHECK_EQ(a->last_seen_ms, 5000);
+    CHECK_EQ(s_reg.count, 1);
+    CHECK(node_registry_find(&s_reg, 0x60554400001A2B3Cull) == a);
+
+    // Key 0 marks an empty slot and is never a node
+    CHECK(node_registry_touch(&s_reg, 0, 0x4400, 0) == NULL);
+    CHECK(node_registry_find(&s_reg, 0) == NULL);
+}
+
+static void test_rloc_keys(void)
+{
+    reset();
+    node_entry_t *legacy = node_registry_touch(&s_reg, NODE_REGISTRY_RLOC_KEY(0x4401), 0x4401, 0);
+    CHECK(legacy != NULL);
+    CHECK(strcmp(legacy->id, "17409") == 0);   // decimal, as the JSON path published it
+    CHECK(strcmp(legacy->topic, "home/sensors/17409") == 0);
+
+    // An extended address with the same low bytes is a different node
+    node_entry_t *ext = node_registry_touch(&s_reg, 0x0000000000004401ull, 0x4401, 0);
+    CHECK(ext != NULL && ext != legacy);
+    CHECK(strcmp(ext->id, "0000000000004401") == 0);
+    CHECK_EQ(s_reg.count, 2);
+}
+
+static void test_find_rloc(void)
+{
+    reset();
+    node_entry_t *a = node_registry_touch(&s_reg, 0x60554400001A2B3Cull, 0x4400, 1000);
+    node_entry_t *legacy = node_registry_touch(&s_reg, NODE_REGISTRY_RLOC_KEY(0x8001), 0x8001, 1000);
+    CHECK(node_registry_find_rloc(&s_reg, 0x4400) == a);
+    CHECK(node_registry_find_rloc(&s_reg, 0x8001) == legacy);
+    CHECK(node_registry_find_rloc(&s_reg, 0x1234) == NULL);
+
+    // After a re-attach two entries may share an RLOC16; the newer one wins
+    node_entry_t *b = node_registry_touch(&s_reg, 0x6055440000FFEE01ull, 0x4400, 2000);
+    CHECK(node_registry_find_rloc(&s_reg, 0x4400) == b);
+    node_registry_touch(&s_reg, 0x60554400001A2B3Cull, 0x4400, 3000);
+    CHECK(node_registry_find_rloc(&s_reg, 0x4400) == a);
+}
+
+static void test_probe_collisions(void)
+{
+    // Keys that differ only in the top byte must still spread out and be
+    // found again through their probe sequences
+    reset();
+    node_entry_t *entries[12];
+    for (uint64_t i = 0; i < 12; i++) {
+        entries[i] = node_registry_touch(&s_reg, (i + 1) << 56, 0, 0);
+        CHECK(entries[i] != NULL);
+    }
+    for (uint64_t i = 0; i < 12; i++) {
+        CHECK(node_registry_find(&s_reg, (i + 1) << 56) == entries[i]);
+        CHECK(entries[i]->key == (i + 1) << 56);
+    }
+    CHECK(node_registry_find(&s_reg, 13ull << 56) == NULL);
+}
+
+static void test_full_table(void)
+{
+    reset();
+    // 3/4 of the slots may be used; the rest stay empty so probes end
+    for (uint64_t key = 1; key <= CAPACITY * 3 / 4; key++) {
+        CHECK(node_registry_touch(&s_reg, key, 0, 0) != NULL);
+    }
+    CHECK_EQ(s_reg.count, CAPACITY * 3 / 4);
+    CHECK(node_registry_touch(&s_reg, 1000, 0, 0) == NULL);
+    CHECK(node_registry_touch(&s_reg, 1001, 0, 0) == NULL);
+    CHECK_EQ(s_reg.rejected, 2);
+    CHECK_EQ(s_reg.count, CAPACITY * 3 / 4);
+
+    // Known nodes keep working, and a miss on the full table terminates
+    CHECK(node_registry_touch(&s_reg, 5, 0x1234, 10) != NULL);
+    CHECK(node_registry_find(&s_reg, 1000) == NULL);
+    int empty = 0;
+    for (int i = 0; i < CAPACITY; i++) {
+        empty += s_entries[i].key == 0;
+    }
+    CHECK_EQ(empty, CAPACITY / 4);
+}
+
+static void test_duplicate_seq(void)
+{
+    reset();
+    node_entry_t *e = node_registry_touch(&s_reg, 42, 0, 0);
+    CHECK(node_registry_accept_seq(&s_reg, e, 7, 0));
+    CHECK(!node_registry_accept_seq(&s_reg, e, 7, 500));    // retransmission
+    CHECK(!node_registry_accept_seq(&s_reg, e, 7, 1999));
+    CHECK(node_registry_accept_seq(&s_reg, e, 8, 2100));
+    // The same seq long after the window is a wrapped counter, not a duplicate
+    CHECK(node_registry_accept_seq(&s_reg, e, 8, 4100));
+    CHECK_EQ(e->packets, 3);
+    CHECK_EQ(e->duplicates, 2);
+}
+
+static void test_merge(void)
+{
+    reset();
+    node_entry_t *e = node_registry_touch(&s_reg, 42, 0, 0);
+    telemetry_frame_t f = {
+        .fields = TELEMETRY_F_TEMPERATURE | TELEMETRY_F_CO2 | TELEMETRY_F_NODE,
+        .temperature = 2150, .co2 = 600, .node = 42,
+    };
+    // First sighting of a field counts as a change; the node id never does
+    CHECK_EQ(node_registry_merge(e, &f), TELEMETRY_F_TEMPERATURE | TELEMETRY_F_CO2);
+    CHECK_EQ(node_registry_merge(e, &f), 0);
+
+    // A partial frame only touches its own fields
+    telemetry_frame_t g = { .fields = TELEMETRY_F_CO2 | TELEMETRY_F_FLAGS, .co2 = 650 };
+    CHECK_EQ(node_registry_merge(e, &g), TELEMETRY_F_CO2 | TELEMETRY_F_FLAGS);
+    CHECK_EQ(e->last.temperature, 2150);
+    CHECK_EQ(e->last.co2, 650);
+    CHECK_EQ(e->last.fields, TELEMETRY_F_TEMPERATURE | TELEMETRY_F_CO2 | TELEMETRY_F_FLAGS);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init_capacity);
+    RUN_TEST(test_touch_and_find);
+    RUN_TEST(test_rloc_keys);
+    RUN_TEST(test_find_rloc);
+    RUN_TEST(test_probe_collisions);
+    RUN_TEST(test_full_table);
+    RUN_TEST(test_duplicate_seq);
+    RUN_TEST(test_merge);
+    TEST_EXIT();
+}
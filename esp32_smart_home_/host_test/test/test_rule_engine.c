@@ -0,0 +1,299 @@
+#include <string.h>
+#include "rule_engine.h"
+#include "unit_test.h"
+
+#define NODE_A   0x60554400001A2B3Cull
+#define NODE_B   0x6055440000FFEE01ull
+
+static rule_table_t s_table;
+
+/* Binary table writer, in the layout documented in rule_engine.h */
+typedef struct {
+    uint8_t buf[512];
+    size_t  len;
+} table_buf_t;
+
+static void put_le(table_buf_t *t, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        t->buf[t->len++] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void begin_table(table_buf_t *t, uint8_t count)
+{
+    t->len = 0;
+    t->buf[t->len++] = RULE_ENGINE_VERSION;
+    t->buf[t->len++] = count;
+}
+
+/* Rule with one condition and a command that switches relay 1 to @p on */
+static void add_rule(table_buf_t *t, uint64_t node, uint8_t field, uint8_t op, int32_t value,
+                     uint8_t on)
+{
+    actuator_cmd_t cmd = { .relay_mask = 0x01, .relay_values = on };
+    uint8_t enc[ACTUATOR_CMD_MAX_LEN];
+    size_t n = actuator_cmd_encode(&cmd, enc, sizeof(enc));
+    put_le(t, node, 8);
+    put_le(t, 0x8401, 2);
+    t->buf[t->len++] = 1;
+    t->buf[t->len++] = (uint8_t)n;
+    t->buf[t->len++] = field;
+    t->buf[t->len++] = op;
+    put_le(t, (uint32_t)value, 4);
+    memcpy(t->buf + t->len, enc, n);
+    t->len += n;
+}
+
+/* Action callback: remembers which rules fired, in order */
+typedef struct {
+    int     count;
+    uint8_t index[8];
+} fired_t;
+
+static void record(uint8_t index, const rule_t *rule, void *arg)
+{
+    fired_t *f = arg;
+    (void)rule;
+    f->index[f->count++] = index;
+}
+
+static telemetry_frame_t temp_state(int16_t temperature)
+{
+    return (telemetry_frame_t){ .fields = TELEMETRY_F_TEMPERATURE, .temperature = temperature };
+}
+
+static size_t eval(uint64_t node, telemetry_frame_t state, fired_t *f)
+{
+    return rule_table_eval(&s_table, node, &state, record, f);
+}
+
+static void test_load(void)
+{
+    table_buf_t t;
+    begin_table(&t, 2);
+    add_rule(&t, 0, 0, RULE_OP_GT, 2600, 1);
+    add_rule(&t, NODE_A, 1, RULE_OP_LT, 3000, 0);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+    CHECK_EQ(s_table.count, 2);
+
+    const rule_t *r = &s_table.rules[1];
+    CHECK(r->node == NODE_A);
+    CHECK_EQ(r->dest, 0x8401);
+    CHECK_EQ(r->cond_count, 1);
+    CHECK_EQ(r->conds[0].field, 1);
+    CHECK_EQ(r->conds[0].op, RULE_OP_LT);
+    CHECK_EQ(r->conds[0].value, 3000);
+    CHECK_EQ(r->latched, 0);
+
+    actuator_cmd_t cmd;
+    CHECK(actuator_cmd_decode(r->cmd, r->cmd_len, &cmd));
+    CHECK_EQ(cmd.relay_mask, 0x01);
+    CHECK_EQ(cmd.relay_values, 0);
+
+    // Negative thresholds survive the little-endian round trip
+    begin_table(&t, 1);
+    add_rule(&t, 0, 0, RULE_OP_LT, -500, 1);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+    CHECK_EQ(s_table.rules[0].conds[0].value, -500);
+
+    // An empty table is valid
+    begin_table(&t, 0);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+    CHECK_EQ(s_table.count, 0);
+}
+
+/* Load @p t after @p corrupt changes it; must be rejected and leave no rules */
+static void check_rejected(const table_buf_t *good, void (*corrupt)(table_buf_t *), int line)
+{
+    table_buf_t t = *good;
+    corrupt(&t);
+    s_table.count = 7;
+    bool ok = rule_table_load(&s_table, t.buf, t.len);
+    if (ok || s_table.count != 0) {
+        fprintf(stderr, "%s:%d: malformed table accepted\n", __FILE__, line);
+        s_test_failures++;
+    }
+}
+
+// Offsets into a table of one rule: header 2, fixed part 12, condition 6
+static void bad_version(table_buf_t *t)     { t->buf[0] = RULE_ENGINE_VERSION + 1; }
+static void too_many_rules(table_buf_t *t)  { t->buf[1] = RULE_ENGINE_MAX_RULES + 1; }
+static void count_past_end(table_buf_t *t)  { t->buf[1] = 2; }
+static void no_conds(table_buf_t *t)        { t->buf[12] = 0; }
+static void too_many_conds(table_buf_t *t)  { t->buf[12] = RULE_ENGINE_MAX_CONDS + 1; }
+static void cmd_too_long(table_buf_t *t)    { t->buf[13] = ACTUATOR_CMD_MAX_LEN + 1; }
+static void bad_field(table_buf_t *t)       { t->buf[14] = 6; }
+static void bad_op(table_buf_t *t)          { t->buf[15] = RULE_OP_COUNT; }
+static void bad_cmd(table_buf_t *t)         { t->buf[20] = ACTUATOR_CMD_VERSION + 1; }
+static void truncated(table_buf_t *t)       { t->len--; }
+static void trailing(table_buf_t *t)        { t->buf[t->len++] = 0; }
+static void header_only(table_buf_t *t)     { t->len = 1; }
+
+static void test_malformed(void)
+{
+    table_buf_t good;
+    begin_table(&good, 1);
+    add_rule(&good, NODE_A, 0, RULE_OP_GT, 2600, 1);
+    CHECK(rule_table_load(&s_table, good.buf, good.len));
+
+    check_rejected(&good, bad_version, __LINE__);
+    check_rejected(&good, too_many_rules, __LINE__);
+    check_rejected(&good, count_past_end, __LINE__);
+    check_rejected(&good, no_conds, __LINE__);
+    check_rejected(&good, too_many_conds, __LINE__);
+    check_rejected(&good, cmd_too_long, __LINE__);
+    check_rejected(&good, bad_field, __LINE__);
+    check_rejected(&good, bad_op, __LINE__);
+    check_rejected(&good, bad_cmd, __LINE__);
+    check_rejected(&good, truncated, __LINE__);
+    check_rejected(&good, trailing, __LINE__);
+    check_rejected(&good, header_only, __LINE__);
+
+    // Every prefix of a valid table is rejected without reading past it
+    for (size_t len = 0; len < good.len; len++) {
+        CHECK(!rule_table_load(&s_table, good.buf, len));
+    }
+
+    // One bad rule after a good one drops the whole table
+    table_buf_t t;
+    begin_table(&t, 2);
+    add_rule(&t, NODE_A, 0, RULE_OP_GT, 2600, 1);
+    add_rule(&t, NODE_B, 0, RULE_OP_GT, 2600, 1);
+    t.buf[t.len - good.len + 2 + 12] = 9;      // field of the second rule
+    CHECK(!rule_table_load(&s_table, t.buf, t.len));
+    CHECK_EQ(s_table.count, 0);
+}
+
+static void test_latch_and_rearm(void)
+{
+    table_buf_t t;
+    begin_table(&t, 1);
+    add_rule(&t, NODE_A, 0, RULE_OP_GT, 2600, 1);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+
+    fired_t f = { 0 };
+    CHECK_EQ(eval(NODE_A, temp_state(2500), &f), 0);
+    CHECK_EQ(eval(NODE_A, temp_state(2650), &f), 1);
+    // Still true: latched, no repeat
+    CHECK_EQ(eval(NODE_A, temp_state(2700), &f), 0);
+    CHECK_EQ(eval(NODE_A, temp_state(2800), &f), 0);
+    CHECK(s_table.rules[0].latched == NODE_A);
+
+    // Another node's frames do not touch a rule bound to NODE_A
+    CHECK_EQ(eval(NODE_B, temp_state(2500), &f), 0);
+    CHECK(s_table.rules[0].latched == NODE_A);
+
+    // Back to normal re-arms; the next crossing fires again
+    CHECK_EQ(eval(NODE_A, temp_state(2600), &f), 0);
+    CHECK_EQ(s_table.rules[0].latched, 0);
+    CHECK_EQ(eval(NODE_A, temp_state(2601), &f), 1);
+    CHECK_EQ(f.count, 2);
+    CHECK_EQ(s_table.rules[0].fired, 2);
+
+    // A state without the field never matches, so it re-arms as well
+    telemetry_frame_t no_temp = { .fields = TELEMETRY_F_HUMIDITY, .humidity = 4000 };
+    CHECK_EQ(eval(NODE_A, no_temp, &f), 0);
+    CHECK_EQ(s_table.rules[0].latched, 0);
+    CHECK_EQ(eval(NODE_A, temp_state(2700), &f), 1);
+}
+
+static void test_any_node(void)
+{
+    table_buf_t t;
+    begin_table(&t, 1);
+    add_rule(&t, 0, 2, RULE_OP_GT, 1000, 1);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+
+    telemetry_frame_t high = { .fields = TELEMETRY_F_CO2, .co2 = 1200 };
+    telemetry_frame_t low = { .fields = TELEMETRY_F_CO2, .co2 = 800 };
+    fired_t f = { 0 };
+    CHECK_EQ(eval(NODE_A, high, &f), 1);
+    // Latched to NODE_A: NODE_B neither fires it nor re-arms it
+    CHECK_EQ(eval(NODE_B, high, &f), 0);
+    CHECK_EQ(eval(NODE_B, low, &f), 0);
+    CHECK(s_table.rules[0].latched == NODE_A);
+    CHECK_EQ(eval(NODE_A, low, &f), 0);
+    CHECK_EQ(eval(NODE_B, high, &f), 1);
+    CHECK(s_table.rules[0].latched == NODE_B);
+}
+
+static void test_operators(void)
+{
+    static const struct {
+        uint8_t op;
+        int32_t value;
+        int32_t field;
+        bool    match;
+    } cases[] = {
+        { RULE_OP_LT, -100, -101, true },  { RULE_OP_LT, -100, -100, false },
+        { RULE_OP_GT, -100, -99, true },   { RULE_OP_GT, -100, -100, false },
+        { RULE_OP_EQ, 42, 42, true },      { RULE_OP_EQ, 42, 43, false },
+        { RULE_OP_NE, 42, 43, true },      { RULE_OP_NE, 42, 42, false },
+        { RULE_OP_BITS_SET, 0x05, 0x07, true },   { RULE_OP_BITS_SET, 0x05, 0x06, false },
+        { RULE_OP_BITS_CLEAR, 0x05, 0x02, true }, { RULE_OP_BITS_CLEAR, 0x05, 0x04, false },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        table_buf_t t;
+        begin_table(&t, 1);
+        // Bit-mask cases test the flags field, the others temperature
+        uint8_t field = cases[c].op >= RULE_OP_BITS_SET ? 5 : 0;
+        add_rule(&t, 0, field, cases[c].op, cases[c].value, 1);
+        CHECK(rule_table_load(&s_table, t.buf, t.len));
+        telemetry_frame_t state = { .fields = (uint16_t)(1u << field) };
+        if (field == 5) {
+            state.flags = (uint8_t)cases[c].field;
+        } else {
+            state.temperature = (int16_t)cases[c].field;
+        }
+        fired_t f = { 0 };
+        CHECK_EQ(eval(NODE_A, state, &f), cases[c].match);
+    }
+}
+
+static void test_multiple_conditions(void)
+{
+    // Cooling on above 26 °C only while the window contact (flag 0x01) is closed
+    table_buf_t t;
+    begin_table(&t, 2);
+    add_rule(&t, NODE_A, 0, RULE_OP_GT, 2600, 1);
+    t.buf[12] = 2;                              // second condition follows the first
+    uint8_t cmd[ACTUATOR_CMD_MAX_LEN];
+    size_t cmd_len = t.len - (2 + 12 + 6);
+    memcpy(cmd, t.buf + 2 + 12 + 6, cmd_len);
+    t.len = 2 + 12 + 6;
+    t.buf[t.len++] = 5;
+    t.buf[t.len++] = RULE_OP_BITS_CLEAR;
+    put_le(&t, 0x01, 4);
+    memcpy(t.buf + t.len, cmd, cmd_len);
+    t.len += cmd_len;
+    add_rule(&t, NODE_A, 0, RULE_OP_LT, 2400, 0);
+    CHECK(rule_table_load(&s_table, t.buf, t.len));
+    CHECK_EQ(s_table.rules[0].cond_count, 2);
+
+    fired_t f = { 0 };
+    telemetry_frame_t state = {
+        .fields = TELEMETRY_F_TEMPERATURE | TELEMETRY_F_FLAGS, .temperature = 2700, .flags = 0x01,
+    };
+    CHECK_EQ(eval(NODE_A, state, &f), 0);
+    state.flags = 0;
+    CHECK_EQ(eval(NODE_A, state, &f), 1);
+    CHECK_EQ(f.index[0], 0);
+
+    // Rules are independent: cooling off fires by itself on the way down
+    state.temperature = 2300;
+    CHECK_EQ(eval(NODE_A, state, &f), 1);
+    CHECK_EQ(f.index[1], 1);
+    CHECK_EQ(s_table.rules[0].latched, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_load);
+    RUN_TEST(test_malformed);
+    RUN_TEST(test_latch_and_rearm);
+    RUN_TEST(test_any_node);
+    RUN_TEST(test_operators);
+    RUN_TEST(test_multiple_conditions);
+    TEST_EXIT();
+}
@@ -0,0 +1,459 @@
+#include <string.h>
+#include "thread_cmd.h"
+#include "thread_utils.h"
+#include "frame_codec.h"
+#include "crc_utils.h"
+#include "esp_timer_fake.h"
+#include "unit_test.h"
+
+/*
+ * One transport instance plays both ends: frames it sends are captured by
+ * the thread_send() stand-ins below, and the test answers them (or sends
+ * it commands) through thread_cmd_handle_rx().
+ */
+
+#define MS 1000
+
+typedef struct {
+    uint16_t dest_id;       ///< Unicast destination, or 0 for multicast
+    uint16_t group;         ///< Multicast group, or 0 for unicast
+    size_t   length;        ///< Without the CRC
+    uint8_t  data[THREAD_CMD_MAX_PAYLOAD + 16];
+} sent_frame_t;
+
+static sent_frame_t       s_sent[64];
+static int                s_n_sent;
+static thread_cmd_event_t s_events[32];
+static int                s_n_events;
+static int                s_handler_calls;
+static uint8_t            s_handler_status;
+static uint8_t            s_handler_seq;
+static uint16_t           s_handler_group;
+
+static void capture(const uint8_t *data, size_t length, uint16_t dest_id, uint16_t group)
+{
+    CHECK(length >= 2 && length - 1 <= sizeof(s_sent[0].data));
+    CHECK_EQ(data[length - 1], compute_crc8(data, length - 1));
+    if (s_n_sent < (int)(sizeof(s_sent) / sizeof(s_sent[0]))) {
+        sent_frame_t *f = &s_sent[s_n_sent++];
+        f->dest_id = dest_id;
+        f->group = group;
+        f->length = length - 1;
+        memcpy(f->data, data, length - 1);
+    }
+}
+
+void thread_send(const uint8_t *data, size_t length, uint16_t dest_id)
+{
+    capture(data, length, dest_id, 0);
+}
+
+void thread_send_group(const uint8_t *data, size_t length, uint16_t group)
+{
+    capture(data, length, 0, group);
+}
+
+static void on_done(const thread_cmd_event_t *event)
+{
+    s_events[s_n_events++] = *event;
+}
+
+static uint8_t on_command(uint16_t src_id, uint16_t group, uint8_t seq,
+                          const uint8_t *payload, size_t length)
+{
+    (void)src_id;
+    (void)payload;
+    (void)length;
+    s_handler_calls++;
+    s_handler_seq = seq;
+    s_handler_group = group;
+    return s_handler_status;
+}
+
+static void reset(void)
+{
+    s_n_sent = 0;
+    s_n_events = 0;
+    s_handler_calls = 0;
+    s_handler_status = 0;
+}
+
+static uint16_t frame_epoch(const sent_frame_t *f)
+{
+    return (uint16_t)(f->data[1] | (f->data[2] << 8));
+}
+
+/**
+ * @brief Feed [type][epoch][seq](+[group])(+@p tail) to the transport, as
+ *        the radio would after the CRC check.
+ */
+static void receive(uint16_t src_id, uint8_t type, uint16_t epoch, uint8_t seq, uint16_t group,
+                    const uint8_t *tail, size_t tail_len)
+{
+    uint8_t frame[32];
+    size_t len = 0;
+    frame[len++] = type;
+    frame[len++] = (uint8_t)(epoch & 0xFF);
+    frame[len++] = (uint8_t)(epoch >> 8);
+    frame[len++] = seq;
+    if (group) {
+        frame[len++] = (uint8_t)(group & 0xFF);
+        frame[len++] = (uint8_t)(group >> 8);
+    }
+    memcpy(&frame[len], tail, tail_len);
+    CHECK(thread_cmd_handle_rx(src_id, frame, len + tail_len));
+}
+
+/**
+ * @brief Answer captured command @p f from @p src_id with @p status.
+ */
+static void ack(const sent_frame_t *f, uint16_t src_id, uint8_t status)
+{
+    if (f->data[0] == FRAME_TYPE_GROUP_CMD) {
+        uint16_t group = (uint16_t)(f->data[4] | (f->data[5] << 8));
+        receive(src_id, FRAME_TYPE_GROUP_ACK, frame_epoch(f), f->data[3], group, &status, 1);
+    } else {
+        receive(src_id, FRAME_TYPE_ACK, frame_epoch(f), f->data[3], 0, &status, 1);
+    }
+}
+
+static void test_unicast_ack(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x01, 0x02, 0x03 };
+    uint8_t seq;
+    CHECK_EQ(thread_cmd_send(0x0400, payload, sizeof(payload), &seq), ESP_OK);
+    CHECK_EQ(s_n_sent, 1);
+    const sent_frame_t *f = &s_sent[0];
+    CHECK_EQ(f->dest_id, 0x0400);
+    CHECK_EQ(f->data[0], FRAME_TYPE_CMD);
+    CHECK_EQ(f->data[3], seq);
+    CHECK_EQ(f->length, 4 + sizeof(payload));
+    CHECK(memcmp(&f->data[4], payload, sizeof(payload)) == 0);
+
+    esp_timer_fake_advance(50 * MS);
+    ack(f, 0x0400, 0x21);
+    CHECK_EQ(s_n_events, 1);
+    CHECK_EQ(s_events[0].dest_id, 0x0400);
+    CHECK_EQ(s_events[0].result, THREAD_CMD_ACKED);
+    CHECK_EQ(s_events[0].status, 0x21);
+    CHECK_EQ(s_events[0].attempts, 1);
+    CHECK_EQ(s_events[0].rtt_us, 50 * MS);
+    CHECK_EQ(esp_timer_fake_next_deadline(), INT64_MAX);
+
+    // A repeated ACK, or one from another node, completes nothing
+    ack(f, 0x0400, 0x21);
+    ack(f, 0x0401, 0x21);
+    CHECK_EQ(s_n_events, 1);
+
+    CHECK_EQ(thread_cmd_send(0x0400, payload, THREAD_CMD_MAX_PAYLOAD + 1, NULL),
+             ESP_ERR_INVALID_SIZE);
+}
+
+static void test_retransmit_backoff(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x10 };
+    CHECK_EQ(thread_cmd_send(0x0410, payload, sizeof(payload), NULL), ESP_OK);
+
+    // Resent 200, 400, 800 and 1600 ms after the previous try
+    const int64_t gaps_ms[] = { 200, 400, 800, 1600 };
+    for (int i = 0; i < 4; i++) {
+        esp_timer_fake_advance((gaps_ms[i] - 1) * MS);
+        CHECK_EQ(s_n_sent, i + 1);
+        esp_timer_fake_advance(1 * MS);
+        CHECK_EQ(s_n_sent, i + 2);
+        CHECK(memcmp(s_sent[i + 1].data, s_sent[0].data, s_sent[0].length) == 0);
+    }
+    CHECK_EQ(s_n_events, 0);
+
+    // ... and times out 3200 ms after the last one
+    esp_timer_fake_advance(3199 * MS);
+    CHECK_EQ(s_n_events, 0);
+    esp_timer_fake_advance(1 * MS);
+    CHECK_EQ(s_n_sent, 5);
+    CHECK_EQ(s_n_events, 1);
+    CHECK_EQ(s_events[0].result, THREAD_CMD_TIMEOUT);
+    CHECK_EQ(s_events[0].attempts, THREAD_CMD_MAX_ATTEMPTS);
+    CHECK_EQ(esp_timer_fake_next_deadline(), INT64_MAX);
+
+    // An ACK after the timeout is ignored
+    ack(&s_sent[0], 0x0410, 0);
+    CHECK_EQ(s_n_events, 1);
+}
+
+static void test_one_command_on_air(void)
+{
+    reset();
+    const uint8_t a[] = { 0xA }, b[] = { 0xB };
+    uint8_t seq_a, seq_b;
+    CHECK_EQ(thread_cmd_send(0x0420, a, 1, &seq_a), ESP_OK);
+    CHECK_EQ(thread_cmd_send(0x0420, b, 1, &seq_b), ESP_OK);
+    CHECK_EQ((uint8_t)(seq_b - seq_a), 1);
+    CHECK_EQ(s_n_sent, 1);
+
+    // The second one goes out once the first is acknowledged
+    ack(&s_sent[0], 0x0420, 0);
+    CHECK_EQ(s_n_sent, 2);
+    CHECK_EQ(s_sent[1].data[3], seq_b);
+    CHECK_EQ(s_sent[1].data[4], 0xB);
+    CHECK_EQ(frame_epoch(&s_sent[1]), frame_epoch(&s_sent[0]));
+
+    // An ACK with the right seq but another epoch is not for it
+    receive(0x0420, FRAME_TYPE_ACK, (uint16_t)(frame_epoch(&s_sent[1]) + 1), seq_b, 0,
+            (const uint8_t[]){ 0 }, 1);
+    CHECK_EQ(s_n_events, 1);
+    ack(&s_sent[1], 0x0420, 0);
+    CHECK_EQ(s_n_events, 2);
+    CHECK_EQ(s_events[1].seq, seq_b);
+}
+
+static void test_dedup(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x55 };
+    s_handler_status = 0x07;
+    receive(0x0500, FRAME_TYPE_CMD, 0x1234, 9, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_handler_seq, 9);
+    CHECK_EQ(s_n_sent, 1);
+    CHECK_EQ(s_sent[0].dest_id, 0x0500);
+    CHECK_EQ(s_sent[0].data[0], FRAME_TYPE_ACK);
+    CHECK_EQ(frame_epoch(&s_sent[0]), 0x1234);
+    CHECK_EQ(s_sent[0].data[3], 9);
+    CHECK_EQ(s_sent[0].data[4], 0x07);
+
+    // A retransmission is answered from the cache, not run again
+    s_handler_status = 0x08;
+    receive(0x0500, FRAME_TYPE_CMD, 0x1234, 9, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_n_sent, 2);
+    CHECK_EQ(s_sent[1].data[4], 0x07);
+
+    // A sender that restarted its numbering at the same seq is not a repeat
+    receive(0x0500, FRAME_TYPE_CMD, 0x1235, 9, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 2);
+    CHECK_EQ(s_n_sent, 3);
+    CHECK_EQ(frame_epoch(&s_sent[2]), 0x1235);
+    CHECK_EQ(s_sent[2].data[4], 0x08);
+
+    // Nor is the same (epoch, seq) from another node
+    receive(0x0501, FRAME_TYPE_CMD, 0x1235, 9, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 3);
+}
+
+static void test_deferred_ack(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x66 };
+    s_handler_status = THREAD_CMD_STATUS_PENDING;
+    receive(0x0510, FRAME_TYPE_CMD, 0x0042, 3, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_n_sent, 0);
+
+    // Retransmissions while the command runs get no answer
+    receive(0x0510, FRAME_TYPE_CMD, 0x0042, 3, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_n_sent, 0);
+
+    thread_cmd_complete(0x0510, 0, 3, 0x31);
+    CHECK_EQ(s_n_sent, 1);
+    CHECK_EQ(s_sent[0].data[0], FRAME_TYPE_ACK);
+    CHECK_EQ(frame_epoch(&s_sent[0]), 0x0042);
+    CHECK_EQ(s_sent[0].data[3], 3);
+    CHECK_EQ(s_sent[0].data[4], 0x31);
+
+    // Later repeats get the final status
+    receive(0x0510, FRAME_TYPE_CMD, 0x0042, 3, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_n_sent, 2);
+    CHECK_EQ(s_sent[1].data[4], 0x31);
+
+    // A command completed after a newer one arrived is not answered
+    receive(0x0510, FRAME_TYPE_CMD, 0x0042, 4, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 2);
+    thread_cmd_complete(0x0510, 0, 3, 0x32);
+    CHECK_EQ(s_n_sent, 2);
+    thread_cmd_complete(0x0510, 0, 4, 0x33);
+    CHECK_EQ(s_n_sent, 3);
+    CHECK_EQ(s_sent[2].data[3], 4);
+}
+
+static void test_group_send(void)
+{
+    reset();
+    const uint16_t members[] = { 0x0600, 0x0601, 0x0602 };
+    const uint8_t payload[] = { 0x77 };
+    uint8_t seq;
+    CHECK_EQ(thread_cmd_send_group(0, members, 3, payload, 1, NULL), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(thread_cmd_send_group(7, members, 0, payload, 1, NULL), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(thread_cmd_send_group(7, members, 3, payload, 1, &seq), ESP_OK);
+
+    // One multicast for all members
+    CHECK_EQ(s_n_sent, 1);
+    CHECK_EQ(s_sent[0].group, 7);
+    CHECK_EQ(s_sent[0].data[0], FRAME_TYPE_GROUP_CMD);
+    CHECK_EQ(s_sent[0].data[3], seq);
+    CHECK_EQ(s_sent[0].data[4] | (s_sent[0].data[5] << 8), 7);
+    CHECK_EQ(s_sent[0].data[6], 0x77);
+
+    ack(&s_sent[0], 0x0600, 0);
+    ack(&s_sent[0], 0x0601, 2);
+    ack(&s_sent[0], 0x0999, 0);     // not a member
+    CHECK_EQ(s_n_events, 2);
+    CHECK_EQ(s_events[0].dest_id, 0x0600);
+    CHECK_EQ(s_events[0].group, 7);
+    CHECK_EQ(s_events[1].dest_id, 0x0601);
+    CHECK_EQ(s_events[1].status, 2);
+
+    // The repeat goes by unicast to the member that has not answered,
+    // after the RTO plus the ACK spread
+    esp_timer_fake_advance((THREAD_CMD_RTO_MS + THREAD_CMD_GROUP_ACK_SPREAD_MS - 1) * MS);
+    CHECK_EQ(s_n_sent, 1);
+    esp_timer_fake_advance(1 * MS);
+    CHECK_EQ(s_n_sent, 2);
+    CHECK_EQ(s_sent[1].dest_id, 0x0602);
+    CHECK_EQ(s_sent[1].group, 0);
+    CHECK(memcmp(s_sent[1].data, s_sent[0].data, s_sent[0].length) == 0);
+
+    ack(&s_sent[0], 0x0602, 0);
+    CHECK_EQ(s_n_events, 3);
+    CHECK_EQ(s_events[2].dest_id, 0x0602);
+    CHECK_EQ(s_events[2].attempts, 2);
+    CHECK_EQ(esp_timer_fake_next_deadline(), INT64_MAX);
+}
+
+static void test_group_receive(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x88 };
+    s_handler_status = 0x05;
+    receive(0x0700, FRAME_TYPE_GROUP_CMD, 0x0010, 1, 9, payload, 1);
+    CHECK_EQ(s_handler_calls, 1);
+    CHECK_EQ(s_handler_group, 9);
+
+    // The ACK waits for its random share of the spread
+    CHECK_EQ(s_n_sent, 0);
+    esp_timer_fake_advance(THREAD_CMD_GROUP_ACK_SPREAD_MS * MS);
+    CHECK_EQ(s_n_sent, 1);
+    const sent_frame_t *f = &s_sent[0];
+    CHECK_EQ(f->dest_id, 0x0700);
+    CHECK_EQ(f->data[0], FRAME_TYPE_GROUP_ACK);
+    CHECK_EQ(frame_epoch(f), 0x0010);
+    CHECK_EQ(f->data[3], 1);
+    CHECK_EQ(f->data[4] | (f->data[5] << 8), 9);
+    CHECK_EQ(f->data[6], 0x05);
+
+    // Group and unicast commands of one sender are numbered apart
+    receive(0x0700, FRAME_TYPE_CMD, 0x0010, 1, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 2);
+    CHECK_EQ(s_handler_group, 0);
+    receive(0x0700, FRAME_TYPE_GROUP_CMD, 0x0010, 1, 9, payload, 1);
+    CHECK_EQ(s_handler_calls, 2);
+
+    // Group 0 is not a group
+    receive(0x0700, FRAME_TYPE_GROUP_CMD, 0x0010, 2, 0, payload, 1);
+    CHECK_EQ(s_handler_calls, 2);
+}
+
+/**
+ * @brief Send one command to @p dest_id, acknowledge it and return its
+ *        frame.
+ */
+static sent_frame_t send_acked(uint16_t dest_id)
+{
+    const uint8_t payload[] = { 0x99 };
+    int before = s_n_sent;
+    CHECK_EQ(thread_cmd_send(dest_id, payload, 1, NULL), ESP_OK);
+    CHECK_EQ(s_n_sent, before + 1);
+    sent_frame_t f = s_sent[before];
+    ack(&f, dest_id, 0);
+    s_n_sent = before;
+    return f;
+}
+
+static void test_rx_does_not_evict_tx(void)
+{
+    reset();
+    sent_frame_t first = send_acked(0x0800);
+
+    // Commands from many senders only churn the receive table
+    const uint8_t payload[] = { 0x11 };
+    for (uint16_t src = 0x0900; src < 0x0900 + 4 * THREAD_CMD_MAX_PEERS; src++) {
+        receive(src, FRAME_TYPE_CMD, 1, 1, 0, payload, 1);
+    }
+    s_n_sent = 0;
+
+    sent_frame_t next = send_acked(0x0800);
+    CHECK_EQ(frame_epoch(&next), frame_epoch(&first));
+    CHECK_EQ((uint8_t)(next.data[3] - first.data[3]), 1);
+}
+
+static void test_evicted_sender_new_epoch(void)
+{
+    reset();
+    sent_frame_t first = send_acked(0x0A00);
+    for (uint16_t dest = 0x0A01; dest <= 0x0A00 + 2 * THREAD_CMD_MAX_PEERS; dest++) {
+        send_acked(dest);
+    }
+
+    // The entry was evicted: its numbering restarts under a new epoch, so
+    // even an equal seq cannot be taken for a retransmission
+    sent_frame_t again = send_acked(0x0A00);
+    CHECK(frame_epoch(&again) != frame_epoch(&first));
+
+    // The receiver's view of the same thing
+    reset();
+    s_handler_status = 0;
+    receive(0x0B00, FRAME_TYPE_CMD, frame_epoch(&first), first.data[3], 0, &first.data[4], 1);
+    receive(0x0B00, FRAME_TYPE_CMD, frame_epoch(&again), first.data[3], 0, &first.data[4], 1);
+    CHECK_EQ(s_handler_calls, 2);
+}
+
+static void test_busy_sender_not_evicted(void)
+{
+    reset();
+    const uint8_t payload[] = { 0x42 };
+    uint8_t seq_a, seq_b;
+    CHECK_EQ(thread_cmd_send(0x0C00, payload, 1, &seq_a), ESP_OK);
+    CHECK_EQ(thread_cmd_send(0x0C00, payload, 1, &seq_b), ESP_OK);
+    sent_frame_t in_flight = s_sent[0];
+
+    // Churn every other entry while 0x0C00 still has commands outstanding
+    for (uint16_t dest = 0x0C01; dest <= 0x0C00 + 2 * THREAD_CMD_MAX_PEERS; dest++) {
+        send_acked(dest);
+    }
+    s_n_sent = 0;
+    s_n_events = 0;
+
+    ack(&in_flight, 0x0C00, 0);
+    CHECK_EQ(s_n_events, 1);
+    CHECK_EQ(s_n_sent, 1);
+    CHECK_EQ(frame_epoch(&s_sent[0]), frame_epoch(&in_flight));
+    CHECK_EQ(s_sent[0].data[3], seq_b);
+    ack(&s_sent[0], 0x0C00, 0);
+
+    uint8_t seq_c;
+    CHECK_EQ(thread_cmd_send(0x0C00, payload, 1, &seq_c), ESP_OK);
+    CHECK_EQ((uint8_t)(seq_c - seq_b), 1);
+    ack(&s_sent[1], 0x0C00, 0);
+    CHECK_EQ(esp_timer_fake_next_deadline(), INT64_MAX);
+}
+
+int main(void)
+{
+    esp_random_fake_seed(0x5EED);
+    CHECK_EQ(thread_cmd_init(on_done, on_command), ESP_OK);
+
+    RUN_TEST(test_unicast_ack);
+    RUN_TEST(test_retransmit_backoff);
+    RUN_TEST(test_one_command_on_air);
+    RUN_TEST(test_dedup);
+    RUN_TEST(test_deferred_ack);
+    RUN_TEST(test_group_send);
+    RUN_TEST(test_group_receive);
+    RUN_TEST(test_rx_does_not_evict_tx);
+    RUN_TEST(test_evicted_sender_new_epoch);
+    RUN_TEST(test_busy_sender_not_evicted);
+    TEST_EXIT();
+}
@@ -0,0 +1,318 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tsdb.h"
+#include "unit_test.h"
+
+#define NODE_A   0x60554400001A2B3Cull
+#define NODE_B   0x6055440000FFEE01ull
+#define T0       1000020u       // 20 s into a minute, 2820 s into an hour
+
+static tsdb_t s_db;
+static void  *s_mem;
+static tsdb_point_t s_points[2048];
+
+static void reset(uint32_t max_nodes)
+{
+    free(s_mem);
+    s_mem = malloc(tsdb_mem_size(max_nodes));
+    CHECK(tsdb_init(&s_db, s_mem, max_nodes));
+}
+
+static void add_temp(uint64_t key, uint32_t t, int16_t temperature)
+{
+    telemetry_frame_t frame = { .fields = TELEMETRY_F_TEMPERATURE, .temperature = temperature };
+    CHECK(tsdb_add(&s_db, key, t, &frame));
+}
+
+static size_t query(uint64_t key, tsdb_metric_t metric, tsdb_res_t res, uint32_t from,
+                    uint32_t to, size_t max_points, bool *more)
+{
+    return tsdb_query(&s_db, key, metric, res, from, to, s_points, max_points, more);
+}
+
+static void test_init_and_names(void)
+{
+    uint32_t dummy;
+    CHECK(!tsdb_init(&s_db, &dummy, 0));
+    reset(4);
+    CHECK_EQ(s_db.count, 0);
+    CHECK(strcmp(tsdb_metric_name(TSDB_METRIC_TEMPERATURE), "temperature") == 0);
+    CHECK(strcmp(tsdb_metric_name(TSDB_METRIC_LIGHT), "light") == 0);
+    CHECK(tsdb_metric_name(TSDB_METRIC_COUNT) == NULL);
+
+    // Key 0 is never a node, an unknown node has no history
+    telemetry_frame_t frame = { .fields = TELEMETRY_F_TEMPERATURE };
+    CHECK(!tsdb_add(&s_db, 0, T0, &frame));
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 0);
+}
+
+static void test_minute_rollup(void)
+{
+    reset(4);
+    // Three samples in one minute, one in the next
+    uint32_t m0 = T0 - T0 % 60;
+    add_temp(NODE_A, m0 + 5, -120);
+    add_temp(NODE_A, m0 + 25, -100);
+    add_temp(NODE_A, m0 + 45, -95);
+    // The open minute is not returned
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 0);
+
+    add_temp(NODE_A, m0 + 65, 300);
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 1);
+    CHECK_EQ(s_points[0].t, m0);
+    CHECK_EQ(s_points[0].min, -120);
+    CHECK_EQ(s_points[0].max, -95);
+    CHECK_EQ(s_points[0].avg, -105);       // -315 / 3, rounded away from zero on ties
+
+    // Metrics the frames did not carry stay empty
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_HUMIDITY, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 0);
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_COUNT, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 0);
+}
+
+/*
+ * Extreme values and large swings between periods go through multi-byte
+ * varints and both zigzag signs; everything must decode exactly.
+ */
+static void test_varint_round_trip(void)
+{
+    static const int32_t temps[] = { -32768, 32767, 0, -1, 1, -32768, -32768, 63, -64, 8191,
+                                     -8192, 32767, 100 };
+    static const int32_t lights[] = { 0, 65535, 127, 128, 16383, 16384, 65535, 0 };
+    reset(4);
+    uint32_t m0 = T0 - T0 % 60;
+    size_t nt = sizeof(temps) / sizeof(temps[0]), nl = sizeof(lights) / sizeof(lights[0]);
+    for (size_t i = 0; i <= nt; i++) {
+        telemetry_frame_t frame = { .fields = TELEMETRY_F_TEMPERATURE | TELEMETRY_F_LIGHT };
+        frame.temperature = (int16_t)temps[i % nt];
+        frame.light = (uint16_t)lights[i % nl];
+        CHECK(tsdb_add(&s_db, NODE_A, m0 + (uint32_t)i * 60, &frame));
+        // A second sample spanning the whole range makes min and max wide
+        if (i % 3 == 1) {
+            frame.temperature = (int16_t)(temps[i % nt] > 0 ? -32768 : 32767);
+            frame.light = (uint16_t)(lights[i % nl] > 0 ? 0 : 65535);
+            CHECK(tsdb_add(&s_db, NODE_A, m0 + (uint32_t)i * 60 + 30, &frame));
+        }
+    }
+
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 64, NULL), nt);
+    for (size_t i = 0; i < nt; i++) {
+        int32_t a = temps[i], b = a > 0 ? -32768 : 32767;
+        bool two = i % 3 == 1;
+        CHECK_EQ(s_points[i].t, m0 + i * 60);
+        CHECK_EQ(s_points[i].min, two && b < a ? b : a);
+        CHECK_EQ(s_points[i].max, two && b > a ? b : a);
+        int32_t sum = two ? a + b : a;
+        int32_t avg = two ? (sum >= 0 ? (sum + 1) / 2 : -((-sum + 1) / 2)) : a;
+        CHECK_EQ(s_points[i].avg, avg);
+    }
+
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_LIGHT, TSDB_RES_MINUTE, 0, UINT32_MAX, 64, NULL), nt);
+    for (size_t i = 0; i < nt; i++) {
+        int32_t a = lights[i % nl], b = a > 0 ? 0 : 65535;
+        bool two = i % 3 == 1;
+        CHECK_EQ(s_points[i].min, two && b < a ? b : a);
+        CHECK_EQ(s_points[i].max, two && b > a ? b : a);
+        CHECK_EQ(s_points[i].avg, two ? (a + b + 1) / 2 : a);
+    }
+}
+
+static void test_gap_runs(void)
+{
+    reset(4);
+    uint32_t m0 = T0 - T0 % 60;
+    // Minutes 0, 1, 5, 6, 100 and 101 (open); gaps of 3 and of 93 minutes
+    static const uint32_t minutes[] = { 0, 1, 5, 6, 100, 101 };
+    for (size_t i = 0; i < sizeof(minutes) / sizeof(minutes[0]); i++) {
+        add_temp(NODE_A, m0 + minutes[i] * 60 + 10, (int16_t)(2000 + i));
+    }
+    size_t n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL);
+    CHECK_EQ(n, 5);
+    for (size_t i = 0; i < n; i++) {
+        CHECK_EQ(s_points[i].t, m0 + minutes[i] * 60);
+        CHECK_EQ(s_points[i].avg, 2000 + (int32_t)i);
+    }
+    // A range that falls inside a gap is empty
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, m0 + 120, m0 + 299, 16, NULL), 0);
+
+    // A gap longer than the minute tier spans still decodes; the hours
+    // see the same samples
+    add_temp(NODE_A, m0 + 30 * 24 * 3600, 2100);
+    n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL);
+    CHECK_EQ(n, 6);
+    CHECK_EQ(s_points[5].t, m0 + 101 * 60);
+    CHECK_EQ(s_points[5].avg, 2005);
+    n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_HOUR, 0, UINT32_MAX, 16, NULL);
+    CHECK(n >= 2);
+    CHECK_EQ(s_points[0].t, T0 - T0 % 3600);
+    CHECK_EQ(s_points[0].min, 2000);
+    CHECK_EQ(s_points[n - 1].max, 2005);
+}
+
+/*
+ * A long noisy series against a straightforward reference: the minute
+ * and hour tiers must return an exact tail of the reference rollups.
+ */
+#define REF_MINUTES  (3 * 24 * 60)
+
+typedef struct {
+    int32_t min, max, sum;
+    int     n;
+} ref_t;
+
+static ref_t s_ref_min[REF_MINUTES];
+static ref_t s_ref_hour[REF_MINUTES / 60];
+
+static void ref_add(ref_t *r, int32_t v)
+{
+    if (r->n == 0 || v < r->min) r->min = v;
+    if (r->n == 0 || v > r->max) r->max = v;
+    r->sum += v;
+    r->n++;
+}
+
+static int32_t ref_avg(const ref_t *r)
+{
+    return r->sum >= 0 ? (r->sum + r->n / 2) / r->n : -((-r->sum + r->n / 2) / r->n);
+}
+
+/* Points must be the last @p n periods with samples of @p ref */
+static void check_tail(const ref_t *ref, int periods, uint32_t t0, uint32_t period, size_t n)
+{
+    int p = periods - 1;
+    while (p >= 0 && ref[p].n == 0) p--;
+    p--;        // the newest period is still open
+    int mismatches = 0;
+    for (size_t i = n; i-- > 0; p--) {
+        while (p >= 0 && ref[p].n == 0) p--;
+        if (p < 0) {
+            mismatches++;
+            break;
+        }
+        mismatches += s_points[i].t != t0 + (uint32_t)p * period
+                      || s_points[i].min != ref[p].min || s_points[i].max != ref[p].max
+                      || s_points[i].avg != ref_avg(&ref[p]);
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_against_reference(void)
+{
+    reset(4);
+    memset(s_ref_min, 0, sizeof(s_ref_min));
+    memset(s_ref_hour, 0, sizeof(s_ref_hour));
+    uint32_t t0 = T0 - T0 % 3600;
+    uint32_t lcg = 7;
+    int32_t temp = 2100;
+    for (uint32_t t = t0; t < t0 + REF_MINUTES * 60u; t += 20) {
+        lcg = lcg * 1103515245u + 12345u;
+        // Occasional outages of up to ~40 minutes
+        if ((lcg >> 16) % 500 == 0) {
+            t += ((lcg >> 8) % 40) * 60;
+            continue;
+        }
+        temp += (int32_t)((lcg >> 16) % 7) - 3;
+        add_temp(NODE_A, t, (int16_t)temp);
+        ref_add(&s_ref_min[(t - t0) / 60], temp);
+        ref_add(&s_ref_hour[(t - t0) / 3600], temp);
+    }
+
+    size_t n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 2048, NULL);
+    // Roughly the last 5 hours survive in the minute ring
+    CHECK(n >= 4 * 60 && n < 8 * 60);
+    check_tail(s_ref_min, REF_MINUTES, t0, 60, n);
+
+    n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_HOUR, 0, UINT32_MAX, 2048, NULL);
+    CHECK_EQ(n, REF_MINUTES / 60 - 1);      // three days of hours fit entirely
+    check_tail(s_ref_hour, REF_MINUTES / 60, t0, 3600, n);
+}
+
+static void test_paging(void)
+{
+    reset(4);
+    uint32_t m0 = T0 - T0 % 60;
+    for (uint32_t i = 0; i <= 150; i++) {
+        // Every seventh minute is missing
+        if (i % 7 != 3) {
+            add_temp(NODE_A, m0 + i * 60, (int16_t)(i * 10 - 500));
+        }
+    }
+    bool more;
+    size_t all = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 2048,
+                       &more);
+    CHECK(!more);
+    tsdb_point_t expected[256];
+    memcpy(expected, s_points, all * sizeof(tsdb_point_t));
+
+    // Pages of 16 from the last t + 1 give the same points, in order
+    size_t got = 0, pages = 0;
+    uint32_t from = 0;
+    do {
+        size_t n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, from, UINT32_MAX, 16,
+                         &more);
+        CHECK(n == 16 || !more);
+        for (size_t i = 0; i < n && got < all; i++, got++) {
+            CHECK(memcmp(&s_points[i], &expected[got], sizeof(tsdb_point_t)) == 0);
+        }
+        from = s_points[n - 1].t + 1;
+        pages++;
+    } while (more && pages < 100);
+    CHECK_EQ(got, all);
+    CHECK_EQ(pages, (all + 15) / 16);
+
+    // A page that ends exactly at the last point reports no more
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, all, &more),
+             all);
+    CHECK(!more);
+
+    // Bounds are inclusive and in period start times
+    size_t n = query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, m0 + 60, m0 + 120, 16,
+                     NULL);
+    CHECK_EQ(n, 2);
+    CHECK_EQ(s_points[0].t, m0 + 60);
+    CHECK_EQ(s_points[1].t, m0 + 120);
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, m0 + 61, m0 + 119, 16,
+                   NULL), 0);
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, m0 + 180, m0 + 239, 16,
+                   NULL), 0);   // minute 3 is missing
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, m0 + 120, m0 + 60, 16,
+                   NULL), 0);
+}
+
+static void test_nodes_and_capacity(void)
+{
+    reset(2);
+    uint32_t m0 = T0 - T0 % 60;
+    add_temp(NODE_A, m0, 100);
+    add_temp(NODE_B, m0, -100);
+    add_temp(NODE_A, m0 + 60, 0);
+    add_temp(NODE_B, m0 + 60, 0);
+    CHECK_EQ(s_db.count, 2);
+
+    // Series are independent
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 1);
+    CHECK_EQ(s_points[0].avg, 100);
+    CHECK_EQ(query(NODE_B, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 1);
+    CHECK_EQ(s_points[0].avg, -100);
+
+    // A third node is refused and counted, known nodes still record
+    telemetry_frame_t frame = { .fields = TELEMETRY_F_TEMPERATURE, .temperature = 5 };
+    CHECK(!tsdb_add(&s_db, 0x1234ull, m0 + 60, &frame));
+    CHECK(!tsdb_add(&s_db, 0x1234ull, m0 + 120, &frame));
+    CHECK_EQ(s_db.rejected, 2);
+    CHECK_EQ(s_db.count, 2);
+    add_temp(NODE_A, m0 + 120, 0);
+    CHECK_EQ(query(NODE_A, TSDB_METRIC_TEMPERATURE, TSDB_RES_MINUTE, 0, UINT32_MAX, 16, NULL), 2);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init_and_names);
+    RUN_TEST(test_minute_rollup);
+    RUN_TEST(test_varint_round_trip);
+    RUN_TEST(test_gap_runs);
+    RUN_TEST(test_against_reference);
+    RUN_TEST(test_paging);
+    RUN_TEST(test_nodes_and_capacity);
+    free(s_mem);
+    TEST_EXIT();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Minimal harness for the host tests: a failed CHECK prints its location
+ * and the test carries on, RUN_TEST reports each test and TEST_EXIT turns
+ * the failure count into the process exit code for ctest.
+ */
+
+static int s_test_failures;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_test_failures++;                                                      \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                  \
+    do {                                                                            \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);             \
+        if (a_ != e_) {                                                             \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %lld, expected %lld\n",   \
+                    __FILE__, __LINE__, #actual, a_, e_);                           \
+            s_test_failures++;                                                      \
+        }                                                                           \
+    } while (0)
+
+#define RUN_TEST(fn)                                                                \
+    do {                                                                            \
+        int before_ = s_test_failures;                                              \
+        fn();                                                                       \
+        printf("%s %s\n", s_test_failures == before_ ? "PASS" : "FAIL", #fn);       \
+    } while (0)
+
+#define TEST_EXIT() return s_test_failures ? EXIT_FAILURE : EXIT_SUCCESS
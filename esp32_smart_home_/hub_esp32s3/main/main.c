@@ -1,56 +1,543 @@
 // hub_main.c
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 #include "thread_utils.h"
+#include "thread_cmd.h"
 #include "mqtt_utils.h"
+#include "crc_utils.h"
+#include "frame_codec.h"
+#include "frame_ring.h"
+#include "json_arena.h"
+#include "node_registry.h"
+#include "hub_pipeline.h"
+#include "hub_stats.h"
+#include "rule_engine.h"
+#include "tsdb.h"
+#include "esp_heap_caps.h"
+#include "binlog.h"
+#include "esp_timer.h"
 
 static const char *TAG = "hub_main";
 
+// Thread RX → MQTT publisher queue; sizes shared with the host
+// simulation are in hub_pipeline.h
+#define HUB_STATS_PERIOD_MS    60000   // how often queue counters are logged
+
+// Pipeline counters and latency histograms (hub_stats), published with the
+// log lines above
+#define HUB_STATS_TOPIC        "home/hub/stats"
+#define HUB_STATS_JSON_SIZE    2560
+#define HUB_PUBLISHER_CORE     1       // see xTaskCreatePinnedToCore in app_main
+
+// How readings are published (HUB_PUBLISH_* in hub_pipeline.h). Per-node
+// topics stay the default so existing subscribers keep working; set
+// HUB_PUBLISH_MODE in the build to opt into batching
+#ifndef HUB_PUBLISH_MODE
+#define HUB_PUBLISH_MODE       HUB_PUBLISH_PER_NODE
+#endif
+
+// Command completions (ACK or timeout) → MQTT, published by the same task
+#define HUB_CMD_DONE_QUEUE_LEN 16
+#define HUB_CMD_ACK_TOPIC      "home/acks/%u"   // outside home/control/# on purpose
+
+// cJSON arena for control messages (parsed and built on the MQTT task)
+#define HUB_JSON_ARENA_SIZE    1024
+
+// Local automation rules (rule_engine binary table). Publish the table
+// retained, so the hub gets it back from the broker after a reboot
+#define HUB_RULES_TOPIC        "home/hub/rules"
+
+// Multicast groups: home/control/group/<name> is sent once to the group's
+// Thread multicast address. Names, group numbers and the members expected
+// to ACK come from HUB_GROUPS_TOPIC (retained), e.g.
+// {"blinds":{"id":1,"members":[1024,2048]}}; {} removes all groups
+#define HUB_GROUPS_TOPIC       "home/hub/groups"
+#define HUB_GROUP_TOPIC_PREFIX "home/control/group/"
+#define HUB_GROUP_MAX          8
+#define HUB_GROUP_NAME_LEN     24
+
+// Reading history in PSRAM (tsdb). Requests on HUB_HISTORY_QUERY_TOPIC:
+// {"id":"<node id>","metric":"temperature","res":"1m"|"1h","from":-3600,
+//  "to":0,"reply":"<tag>"}, times in seconds relative to now. The answer
+// goes to HUB_HISTORY_REPLY_PREFIX<tag>; "more":true means another request
+// from the last returned t + 1 is needed
+#define HUB_HISTORY_QUERY_TOPIC  "home/hub/history/query"
+#define HUB_HISTORY_REPLY_PREFIX "home/hub/history/reply/"
+#define HUB_HISTORY_MAX_POINTS   96
+#define HUB_HISTORY_JSON_SIZE    4096
+#define HUB_HISTORY_QUEUE_LEN    4      // parsed on the MQTT task, answered by the publisher
+#define HUB_HISTORY_MAX_SPAN_S   (366 * 24 * 3600)  // |from|, |to| are clamped to this
+
+/**
+ * @brief History query, validated on the MQTT task for the publisher.
+ */
+typedef struct {
+    uint64_t      key;
+    tsdb_metric_t metric;
+    bool          hourly;
+    int64_t       now_s;            ///< Time the request arrived
+    int64_t       from_s;
+    int64_t       to_s;
+    char          id[17];           ///< As in the request, echoed in the reply
+    char          topic[96];        ///< Reply topic
+} history_query_t;
+
+/**
+ * @brief Named multicast group and the members expected to answer.
+ */
+typedef struct {
+    char     name[HUB_GROUP_NAME_LEN];
+    uint16_t id;
+    uint8_t  member_count;
+    uint16_t members[THREAD_CMD_GROUP_MAX_MEMBERS];
+} hub_group_t;
+
+static frame_slot_t s_rx_slots[HUB_RX_RING_CAPACITY];   // thread_buf_t references
+static frame_ring_t s_rx_ring;
+static TaskHandle_t s_publisher_task;
+static mqtt_batch_t s_batch;
+static QueueHandle_t   s_cmd_done_queue;
+static node_entry_t    s_node_entries[HUB_NODE_CAPACITY];
+static node_registry_t s_nodes;
+static uint8_t      s_json_arena_buf[HUB_JSON_ARENA_SIZE];
+static json_arena_t s_json_arena;
+static rule_table_t      s_rules;           // evaluated by the publisher task
+static rule_table_t      s_rules_staging;   // compiled by the MQTT task
+static SemaphoreHandle_t s_rules_lock;
+static hub_group_t       s_groups[HUB_GROUP_MAX];   // MQTT task only
+static size_t            s_group_count;
+static tsdb_t            s_history;         // publisher task only
+static bool              s_history_ready;
+static QueueHandle_t     s_history_queue;   // history_query_t
+static hub_pipeline_t    s_pipeline;        // publisher task; set up in app_main
+
+/**
+ * @brief Rule action: send the rule's command straight to the actuator.
+ *        Runs in the publisher task, before the frame is published.
+ *
+ * @param arg  Frame that triggered the rule, for the latency histogram
+ */
+static void run_rule(uint8_t index, const rule_t *rule, void *arg)
+{
+    const thread_buf_t *frame = arg;
+    uint8_t seq;
+    if (thread_cmd_send(rule->dest, rule->cmd, rule->cmd_len, &seq) != ESP_OK) {
+        ESP_LOGW(TAG, "Rule %u: command to node %u not sent", index, rule->dest);
+        return;
+    }
+    HUB_STATS_RECORD(HUB_STAGE_RULE, (uint32_t)esp_timer_get_time() - frame->rx_us);
+    HUB_STATS_COUNT(HUB_CNT_RULE_FIRED);
+    BINLOG_I(TAG, "Rule %u fired: cmd %u to node %u", index, seq, rule->dest);
+}
+
+/**
+ * @brief Replace the rule table with one received on HUB_RULES_TOPIC.
+ *        Runs on the MQTT task; a malformed table keeps the old rules.
+ */
+static void load_rules(const uint8_t *data, size_t length)
+{
+    if (!rule_table_load(&s_rules_staging, data, length)) {
+        ESP_LOGW(TAG, "Rejected malformed rule table (%u bytes)", length);
+        return;
+    }
+    xSemaphoreTake(s_rules_lock, portMAX_DELAY);
+    s_rules.count = s_rules_staging.count;
+    memcpy(s_rules.rules, s_rules_staging.rules, s_rules_staging.count * sizeof(rule_t));
+    xSemaphoreGive(s_rules_lock);
+    ESP_LOGI(TAG, "Loaded %u local rules", s_rules_staging.count);
+}
+
+/**
+ * @brief Release callback for frames the RX ring drops on overflow.
+ */
+static void release_frame(void *frame)
+{
+    HUB_STATS_COUNT(HUB_CNT_DROPPED);
+    thread_buf_release(frame);
+}
+
+/**
+ * @brief Publish one command completion with its round-trip time.
+ */
+static void publish_cmd_done(const thread_cmd_event_t *event)
+{
+    char topic[32];
+    char payload[128];
+    snprintf(topic, sizeof(topic), HUB_CMD_ACK_TOPIC, event->dest_id);
+    snprintf(payload, sizeof(payload),
+             "{\"seq\":%u,\"group\":%u,\"result\":\"%s\",\"status\":%u,\"attempts\":%u,\"rtt_ms\":%lu.%03lu}",
+             event->seq, event->group, event->result == THREAD_CMD_ACKED ? "acked" : "timeout",
+             event->status, event->attempts,
+             (unsigned long)(event->rtt_us / 1000), (unsigned long)(event->rtt_us % 1000));
+    mqtt_publish(topic, payload);
+}
+
+/**
+ * @brief Command transport completion callback. Runs on the OpenThread or
+ *        esp_timer task, so the event is only queued for the publisher.
+ */
+static void on_cmd_done(const thread_cmd_event_t *event)
+{
+    if (xQueueSend(s_cmd_done_queue, event, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Completion of cmd %u to node %u dropped", event->seq, event->dest_id);
+        return;
+    }
+    xTaskNotifyGive(s_publisher_task);
+}
+
+/**
+ * @brief Append a stored value; temperature and humidity are hundredths.
+ */
+static int append_value(char *buf, size_t size, tsdb_metric_t metric, int32_t value)
+{
+    if (metric != TSDB_METRIC_TEMPERATURE && metric != TSDB_METRIC_HUMIDITY) {
+        return snprintf(buf, size, "%ld", (long)value);
+    }
+    const char *sign = value < 0 ? "-" : "";
+    if (value < 0) value = -value;
+    return snprintf(buf, size, "%s%ld.%02ld", sign, (long)(value / 100), (long)(value % 100));
+}
+
+/**
+ * @brief Answer a history range query queued by the MQTT task. Runs in the
+ *        publisher task, the only one that touches s_history and hub_stats.
+ */
+static void answer_history_query(const history_query_t *q)
+{
+    static tsdb_point_t points[HUB_HISTORY_MAX_POINTS];
+    static char json[HUB_HISTORY_JSON_SIZE];
+
+    size_t n = 0;
+    bool more = false;
+    if (q->to_s >= 0 && q->from_s <= q->to_s) {
+        n = tsdb_query(&s_history, q->key, q->metric, q->hourly ? TSDB_RES_HOUR : TSDB_RES_MINUTE,
+                       (uint32_t)(q->from_s > 0 ? q->from_s : 0), (uint32_t)q->to_s,
+                       points, HUB_HISTORY_MAX_POINTS, &more);
+    }
+
+    // [t relative to now, min, avg, max] per period, oldest first
+    size_t len = snprintf(json, sizeof(json), "{\"id\":\"%s\",\"metric\":\"%s\",\"res\":\"%s\",\"points\":[",
+                          q->id, tsdb_metric_name(q->metric), q->hourly ? "1h" : "1m");
+    for (size_t i = 0; i < n && len < sizeof(json); i++) {
+        len += snprintf(json + len, sizeof(json) - len, "%s[%ld,", i ? "," : "",
+                        (long)((int64_t)points[i].t - q->now_s));
+        const int32_t values[3] = { points[i].min, points[i].avg, points[i].max };
+        for (int v = 0; v < 3 && len < sizeof(json); v++) {
+            len += append_value(json + len, sizeof(json) - len, q->metric, values[v]);
+            if (len < sizeof(json)) {
+                json[len++] = v < 2 ? ',' : ']';
+            }
+        }
+    }
+    if (len < sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len, "],\"more\":%s}", more ? "true" : "false");
+    }
+    if (len >= sizeof(json)) {
+        ESP_LOGW(TAG, "History reply does not fit");
+        return;
+    }
+    mqtt_publish_len(q->topic, json, len);
+}
+
+/**
+ * @brief Drain the RX ring into MQTT. A slow broker or TLS renegotiation
+ *        only backs up the ring; Thread processing keeps running.
+ */
+static void mqtt_publisher_task(void *arg)
+{
+    thread_buf_t *frame;
+    thread_cmd_event_t cmd_done;
+    history_query_t query;
+    TickType_t last_stats = xTaskGetTickCount();
+
+    mqtt_batch_init(&s_batch, HUB_BATCH_TOPIC, HUB_BATCH_WINDOW_MS, HUB_BATCH_MAX_MSGS);
+
+    while (true) {
+        // Sleep until new frames or command completions arrive, or the
+        // open batch window closes. At least one tick: a window closing
+        // within the current tick would otherwise make this a busy loop
+        uint32_t wait_ms = MIN(mqtt_batch_time_left_ms(&s_batch), HUB_STATS_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, MAX(pdMS_TO_TICKS(wait_ms), 1));
+
+        while ((frame = frame_ring_pop(&s_rx_ring)) != NULL) {
+            HUB_STATS_RECORD(HUB_STAGE_QUEUE, (uint32_t)esp_timer_get_time() - frame->rx_us);
+            hub_pipeline_frame(&s_pipeline, frame->src_id, frame->data, frame->length - 1,
+                               esp_timer_get_time() / 1000, frame);
+            thread_buf_release(frame);
+        }
+        while (xQueueReceive(s_cmd_done_queue, &cmd_done, 0) == pdTRUE) {
+            publish_cmd_done(&cmd_done);
+        }
+        while (s_history_ready && xQueueReceive(s_history_queue, &query, 0) == pdTRUE) {
+            answer_history_query(&query);
+        }
+        mqtt_batch_poll(&s_batch);
+
+        if (xTaskGetTickCount() - last_stats >= pdMS_TO_TICKS(HUB_STATS_PERIOD_MS)) {
+            last_stats = xTaskGetTickCount();
+            frame_ring_stats_t stats;
+            frame_ring_get_stats(&s_rx_ring, &stats);
+            ESP_LOGI(TAG, "RX queue: depth=%lu/%lu high_water=%lu dropped_full=%lu",
+                     (unsigned long)stats.depth, (unsigned long)stats.capacity,
+                     (unsigned long)stats.high_water, (unsigned long)stats.dropped_full);
+            ESP_LOGI(TAG, "Nodes: %lu/%u known, %lu rejected",
+                     (unsigned long)s_nodes.count, HUB_NODE_CAPACITY,
+                     (unsigned long)s_nodes.rejected);
+            ESP_LOGI(TAG, "JSON arena: high_water=%u/%u heap_fallbacks=%lu",
+                     json_arena_high_water(&s_json_arena), HUB_JSON_ARENA_SIZE,
+                     (unsigned long)s_json_arena.fallbacks);
+            if (s_history_ready) {
+                ESP_LOGI(TAG, "History: %lu/%u nodes, %lu rejected",
+                         (unsigned long)s_history.count, HUB_HISTORY_MAX_NODES,
+                         (unsigned long)s_history.rejected);
+            }
+#if HUB_STATS_ENABLE
+            static char stats_json[HUB_STATS_JSON_SIZE];
+            if (hub_stats_to_json(stats_json, sizeof(stats_json)) > 0) {
+                mqtt_publish(HUB_STATS_TOPIC, stats_json);
+            }
+#endif
+        }
+    }
+}
+
 /**
  * @brief Callback invoked when data is received from the Thread network.
  *
- * @param data Pointer to received payload (last byte is CRC)
- * @param length Total length of received buffer (including CRC)
- * @param src_id  Thread node ID of sender
+ * Runs in the OpenThread tasklet context: it only validates the CRC and
+ * queues a reference to the buffer for the publisher task, it never copies
+ * the payload or touches the network.
+ *
+ * @param buf  Borrowed receive buffer: binary telemetry frame or JSON,
+ *             last byte is CRC
  */
-void thread_receive_callback(const uint8_t *data, size_t length, uint16_t src_id)
+void thread_receive_callback(thread_buf_t *buf)
 {
-    if (length < 2) {
+    HUB_STATS_COUNT(HUB_CNT_RX);
+    if (buf->length < 2) {
+        HUB_STATS_COUNT(HUB_CNT_TRUNCATED);
         ESP_LOGW(TAG, "Thread packet too short");
         return;
     }
 
-    ESP_LOGI(TAG, "Thread RX from node %d, len=%d", src_id, length);
+    BINLOG_I(TAG, "Thread RX from node %d, len=%d", buf->src_id, buf->length);
 
     // Verify CRC8
-    uint8_t received_crc = data[length - 1];
-    uint8_t computed_crc = compute_crc8(data, length - 1);
+    hub_stamp_t start = HUB_STATS_CYCLES();
+    uint8_t received_crc = buf->data[buf->length - 1];
+    uint8_t computed_crc = compute_crc8(buf->data, buf->length - 1);
+    HUB_STATS_SINCE(HUB_STAGE_RX_CRC, start);
     if (received_crc != computed_crc) {
+        HUB_STATS_COUNT(HUB_CNT_CRC_ERROR);
         ESP_LOGW(TAG, "CRC mismatch (got 0x%02X, expected 0x%02X)", received_crc, computed_crc);
         return;
     }
 
-    // Copy JSON payload (without CRC)
-    size_t json_len = length - 1;
-    char json_str[256];
-    if (json_len >= sizeof(json_str)) {
-        json_len = sizeof(json_str) - 1;
+    // Command ACKs complete their in-flight command and are not telemetry
+    if (thread_cmd_handle_rx(buf->src_id, buf->data, buf->length - 1)) {
+        return;
+    }
+
+    // Hand our own reference to the publisher task
+    thread_buf_retain(buf);
+    if (!frame_ring_push(&s_rx_ring, buf)) {
+        HUB_STATS_COUNT(HUB_CNT_DROPPED);
+        thread_buf_release(buf);
+        ESP_LOGW(TAG, "Frame from node %u not queued", buf->src_id);
+        return;
+    }
+    xTaskNotifyGive(s_publisher_task);
+}
+
+/**
+ * @brief Translate a control message into an actuator command.
+ *
+ * Accepts the single-relay form {"relay":1,"state":1} and the batch form
+ * {"relays":{"1":1,"2":0},"servos":{"0":90}}, where relays are numbered
+ * from 1 and servos from 0.
+ *
+ * @return false if the message names no valid output
+ */
+static bool control_to_cmd(const cJSON *root, actuator_cmd_t *cmd)
+{
+    *cmd = (actuator_cmd_t){0};
+
+    const cJSON *relay = cJSON_GetObjectItem(root, "relay");
+    const cJSON *state = cJSON_GetObjectItem(root, "state");
+    if (cJSON_IsNumber(relay) && cJSON_IsNumber(state)) {
+        if (relay->valueint < 1 || relay->valueint > 8) {
+            return false;
+        }
+        cmd->relay_mask = (uint8_t)(1u << (relay->valueint - 1));
+        cmd->relay_values = state->valueint ? cmd->relay_mask : 0;
+        return true;
+    }
+
+    // {"relays":{"<1..8>":0|1}, "servos":{"<0..7>":<deg>}}; both optional,
+    // but keys are indices, so anything other than an object is refused
+    const cJSON *relays = cJSON_GetObjectItem(root, "relays");
+    const cJSON *servos = cJSON_GetObjectItem(root, "servos");
+    if ((relays && !cJSON_IsObject(relays)) || (servos && !cJSON_IsObject(servos))) {
+        return false;
+    }
+    const cJSON *item;
+    cJSON_ArrayForEach(item, relays) {
+        if (!item->string) {
+            return false;
+        }
+        int n = atoi(item->string);
+        if (n < 1 || n > 8 || !cJSON_IsNumber(item)) {
+            return false;
+        }
+        uint8_t bit = (uint8_t)(1u << (n - 1));
+        cmd->relay_mask |= bit;
+        if (item->valueint) {
+            cmd->relay_values |= bit;
+        }
+    }
+    cJSON_ArrayForEach(item, servos) {
+        if (!item->string) {
+            return false;
+        }
+        int n = atoi(item->string);
+        if (n < 0 || n >= ACTUATOR_CMD_MAX_SERVOS || !cJSON_IsNumber(item)
+            || item->valueint < 0 || item->valueint > 180) {
+            return false;
+        }
+        cmd->servo_mask |= (uint8_t)(1u << n);
+        cmd->servo_angle[n] = (uint8_t)item->valueint;
     }
-    memcpy(json_str, data, json_len);
-    json_str[json_len] = '\0';
+    return cmd->relay_mask || cmd->servo_mask;
+}
 
-    ESP_LOGI(TAG, "Thread JSON: %s", json_str);
+/**
+ * @brief Replace the group table with the one in a HUB_GROUPS_TOPIC
+ *        message. The old table is kept if the message is not an object
+ *        or any entry is invalid; an empty object ({}) clears the table.
+ */
+static bool load_groups(const cJSON *root)
+{
+    static hub_group_t groups[HUB_GROUP_MAX];   // MQTT task only
+    size_t count = 0;
 
-    // Publish to MQTT under topic "home/sensors/<src_id>"
-    char topic[64];
-    snprintf(topic, sizeof(topic), "home/sensors/%u", src_id);
-    mqtt_publish(topic, json_str);
-    ESP_LOGI(TAG, "MQTT PUB → %s", topic);
+    if (!cJSON_IsObject(root)) {
+        return false;
+    }
+    const cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        const cJSON *id = cJSON_GetObjectItem(item, "id");
+        const cJSON *members = cJSON_GetObjectItem(item, "members");
+        int n = cJSON_GetArraySize(members);
+        if (count == HUB_GROUP_MAX || !cJSON_IsObject(item) || !item->string
+            || item->string[0] == '\0' || strlen(item->string) >= HUB_GROUP_NAME_LEN
+            || !cJSON_IsNumber(id) || id->valueint < 1 || id->valueint > 0xFFFF
+            || !cJSON_IsArray(members) || n < 1 || n > THREAD_CMD_GROUP_MAX_MEMBERS) {
+            return false;
+        }
+        hub_group_t *group = &groups[count++];
+        strcpy(group->name, item->string);
+        group->id = (uint16_t)id->valueint;
+        group->member_count = 0;
+        const cJSON *member;
+        cJSON_ArrayForEach(member, members) {
+            if (!cJSON_IsNumber(member) || member->valueint < 0 || member->valueint > 0xFFFF) {
+                return false;
+            }
+            group->members[group->member_count++] = (uint16_t)member->valueint;
+        }
+    }
+    memcpy(s_groups, groups, count * sizeof(groups[0]));
+    s_group_count = count;
+    return true;
+}
+
+/**
+ * @brief Group configured under @p name, or NULL.
+ */
+static const hub_group_t *find_group(const char *name)
+{
+    for (size_t i = 0; i < s_group_count; i++) {
+        if (strcmp(s_groups[i].name, name) == 0) {
+            return &s_groups[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Relative time of a query bound in seconds, clamped to a year
+ *        either way before the conversion; @p def if absent or not a number.
+ */
+static int64_t history_offset(const cJSON *item, int64_t def)
+{
+    if (!cJSON_IsNumber(item) || item->valuedouble != item->valuedouble) {
+        return def;
+    }
+    double v = item->valuedouble;
+    if (v < -HUB_HISTORY_MAX_SPAN_S) v = -HUB_HISTORY_MAX_SPAN_S;
+    if (v > HUB_HISTORY_MAX_SPAN_S) v = HUB_HISTORY_MAX_SPAN_S;
+    return (int64_t)v;
+}
+
+/**
+ * @brief Validate a history range query (HUB_HISTORY_QUERY_TOPIC) and hand
+ *        it to the publisher task. Runs on the MQTT task.
+ */
+static void queue_history_query(const cJSON *root)
+{
+    const cJSON *id     = cJSON_GetObjectItem(root, "id");
+    const cJSON *metric = cJSON_GetObjectItem(root, "metric");
+    const cJSON *res    = cJSON_GetObjectItem(root, "res");
+    const cJSON *from   = cJSON_GetObjectItem(root, "from");
+    const cJSON *to     = cJSON_GetObjectItem(root, "to");
+    const cJSON *reply  = cJSON_GetObjectItem(root, "reply");
+    history_query_t q;
+    if (!cJSON_IsString(id) || !cJSON_IsString(metric) || !cJSON_IsString(reply)
+        || snprintf(q.topic, sizeof(q.topic), HUB_HISTORY_REPLY_PREFIX "%s",
+                    reply->valuestring) >= (int)sizeof(q.topic)) {
+        ESP_LOGW(TAG, "Malformed history query");
+        return;
+    }
+
+    // Same id as in the node's telemetry topic: 16 hex digits of the
+    // extended address, or the decimal RLOC16. Both are echoed into the
+    // reply, so only well-formed IDs and known metrics pass
+    char *end;
+    if (strlen(id->valuestring) == 16) {
+        q.key = strtoull(id->valuestring, &end, 16);
+    } else {
+        unsigned long rloc = strtoul(id->valuestring, &end, 10);
+        q.key = NODE_REGISTRY_RLOC_KEY(rloc);
+        if (rloc > 0xFFFF) end = id->valuestring;
+    }
+    q.metric = 0;
+    while (q.metric < TSDB_METRIC_COUNT
+           && strcmp(tsdb_metric_name(q.metric), metric->valuestring) != 0) {
+        q.metric++;
+    }
+    if (*end != '\0' || end == id->valuestring || q.metric == TSDB_METRIC_COUNT
+        || snprintf(q.id, sizeof(q.id), "%s", id->valuestring) >= (int)sizeof(q.id)) {
+        ESP_LOGW(TAG, "History query for unknown node or metric");
+        return;
+    }
+    q.hourly = cJSON_IsString(res) && strcmp(res->valuestring, "1h") == 0;
+    q.now_s  = esp_timer_get_time() / 1000000;
+    q.from_s = q.now_s + history_offset(from, -3600);
+    q.to_s   = q.now_s + history_offset(to, 0);
+
+    if (xQueueSend(s_history_queue, &q, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "History query dropped, %u already pending", HUB_HISTORY_QUEUE_LEN);
+        return;
+    }
+    xTaskNotifyGive(s_publisher_task);
 }
 
 /**
@@ -65,48 +552,85 @@ static void mqtt_event_handler(void *handler_args,
 
     switch (event->event_id) {
     case MQTT_EVENT_DATA: {
-        // Copy topic and payload into C-strings
-        char topic[128], payload[128];
+        // Copy the topic into a C-string; the payload is parsed in place
+        char topic[128];
         int tlen = MIN(event->topic_len, sizeof(topic)-1);
-        int plen = MIN(event->data_len,  sizeof(payload)-1);
         memcpy(topic, event->topic, tlen); topic[tlen] = '\0';
-        memcpy(payload, event->data, plen); payload[plen] = '\0';
-
-        ESP_LOGI(TAG, "MQTT RX: %s → %s", topic, payload);
-
-        // Parse control topic: home/control/<node_id>
-        int node_id;
-        if (sscanf(topic, "home/control/%d", &node_id) == 1) {
-            cJSON *root = cJSON_Parse(payload);
-            if (root) {
-                cJSON *relay  = cJSON_GetObjectItem(root, "relay");
-                cJSON *state  = cJSON_GetObjectItem(root, "state");
-                if (cJSON_IsNumber(relay) && cJSON_IsNumber(state)) {
-                    uint8_t relay_id    = relay->valueint;
-                    uint8_t relay_state = state->valueint;
-
-                    // Build Thread command JSON
-                    cJSON *cmd = cJSON_CreateObject();
-                    cJSON_AddNumberToObject(cmd, "relay", relay_id);
-                    cJSON_AddNumberToObject(cmd, "state", relay_state);
-                    char *cmd_str = cJSON_PrintUnformatted(cmd);
-                    if (cmd_str) {
-                        size_t len = strlen(cmd_str);
-                        uint8_t buf[256];
-                        memcpy(buf, cmd_str, len);
-                        buf[len] = compute_crc8(buf, len);
-                        thread_send(buf, len + 1, (uint16_t)node_id);
-                        ESP_LOGI(TAG, "Thread TX to %d: %s", node_id, cmd_str);
-                        cJSON_free(cmd_str);
-                    }
-                    cJSON_Delete(cmd);
-                }
-                cJSON_Delete(root);
+
+        if (strcmp(topic, HUB_RULES_TOPIC) == 0) {
+            // Binary table; must arrive in one piece
+            if (event->data_len != event->total_data_len) {
+                ESP_LOGW(TAG, "Rule table larger than the MQTT buffer, ignored");
+            } else {
+                load_rules((const uint8_t *)event->data, event->data_len);
             }
+            break;
         }
+
+        ESP_LOGI(TAG, "MQTT RX: %s → %.*s", topic, event->data_len, event->data);
+
+        // Parse control topic: home/control/<node_id> or
+        // home/control/group/<name>
+        const hub_group_t *group = NULL;
+        int node_id = -1;
+        bool is_groups = strcmp(topic, HUB_GROUPS_TOPIC) == 0;
+        bool is_query  = strcmp(topic, HUB_HISTORY_QUERY_TOPIC) == 0;
+        if (strncmp(topic, HUB_GROUP_TOPIC_PREFIX, strlen(HUB_GROUP_TOPIC_PREFIX)) == 0) {
+            group = find_group(topic + strlen(HUB_GROUP_TOPIC_PREFIX));
+            if (!group) {
+                ESP_LOGW(TAG, "No group configured for %s", topic);
+                break;
+            }
+        } else if (!is_groups && !is_query && sscanf(topic, "home/control/%d", &node_id) != 1) {
+            break;
+        }
+
+        // All cJSON allocations below come from the arena
+        json_arena_begin(&s_json_arena);
+        cJSON *root = cJSON_ParseWithLength(event->data, event->data_len);
+        actuator_cmd_t cmd;
+        if (is_query) {
+            if (root && s_history_ready) {
+                queue_history_query(root);
+            }
+        } else if (is_groups) {
+            if (root && load_groups(root)) {
+                ESP_LOGI(TAG, "Loaded %u groups", s_group_count);
+            } else {
+                ESP_LOGW(TAG, "Rejected malformed group table");
+            }
+        } else if (root && control_to_cmd(root, &cmd)) {
+            // One binary command per message, however many outputs it
+            // touches; the transport adds header, CRC and retries. A group
+            // gets one multicast for all its members
+            uint8_t buf[ACTUATOR_CMD_MAX_LEN];
+            size_t len = actuator_cmd_encode(&cmd, buf, sizeof(buf));
+            uint8_t seq;
+            esp_err_t err = ESP_ERR_INVALID_SIZE;
+            if (len && group) {
+                err = thread_cmd_send_group(group->id, group->members, group->member_count,
+                                            buf, len, &seq);
+            } else if (len) {
+                err = thread_cmd_send((uint16_t)node_id, buf, len, &seq);
+            }
+            if (err == ESP_OK) {
+                ESP_LOGI(TAG, "Thread CMD %u to %s%d: relays 0x%02X=0x%02X, servos 0x%02X",
+                         seq, group ? "group " : "", group ? group->id : node_id,
+                         cmd.relay_mask, cmd.relay_values, cmd.servo_mask);
+            }
+        } else {
+            ESP_LOGW(TAG, "Ignoring malformed control message on %s", topic);
+        }
+        cJSON_Delete(root);
+        json_arena_end(&s_json_arena);
         break;
     }
 
+    case MQTT_EVENT_PUBLISHED:
+        // Broker PUBACK for a QoS 1 publish
+        HUB_STATS_PUBACK(event->msg_id);
+        break;
+
     default:
         break;
     }
@@ -116,8 +640,50 @@ void app_main(void)
 {
     ESP_LOGI(TAG, "=== Hub (ESP32-S3) Starting ===");
 
+    // Hot-path logs are queued as binary records and printed by this task
+    ESP_ERROR_CHECK(binlog_start());
+
+    // cJSON allocates from per-task arenas instead of the general heap
+    json_arena_install();
+    json_arena_init(&s_json_arena, s_json_arena_buf, sizeof(s_json_arena_buf));
+
+    // RX queue, node table and MQTT publisher must exist before Thread
+    // frames arrive
+    node_registry_init(&s_nodes, s_node_entries, HUB_NODE_CAPACITY, HUB_DUP_WINDOW_MS);
+    s_rules_lock = xSemaphoreCreateMutex();
+
+    // Reading history lives in PSRAM; without it the hub only forwards
+    s_history_queue = xQueueCreate(HUB_HISTORY_QUEUE_LEN, sizeof(history_query_t));
+    size_t history_size = tsdb_mem_size(HUB_HISTORY_MAX_NODES);
+    void *history_mem = heap_caps_malloc(history_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_history_ready = history_mem && tsdb_init(&s_history, history_mem, HUB_HISTORY_MAX_NODES);
+    if (s_history_ready) {
+        ESP_LOGI(TAG, "History store: %u bytes of PSRAM for %u nodes",
+                 history_size, HUB_HISTORY_MAX_NODES);
+    } else {
+        ESP_LOGW(TAG, "No PSRAM for the history store (%u bytes), history disabled",
+                 history_size);
+    }
+    s_pipeline = (hub_pipeline_t){
+        .nodes        = &s_nodes,
+        .rules        = &s_rules,
+        .rules_lock   = s_rules_lock,
+        .rule_action  = run_rule,
+        .history      = s_history_ready ? &s_history : NULL,
+        .batch        = &s_batch,
+        .publish_mode = HUB_PUBLISH_MODE,
+    };
+    s_cmd_done_queue = xQueueCreate(HUB_CMD_DONE_QUEUE_LEN, sizeof(thread_cmd_event_t));
+    frame_ring_init(&s_rx_ring, s_rx_slots, HUB_RX_RING_CAPACITY, FRAME_RING_DROP_OLDEST,
+                    release_frame);
+    // Pinned: its decode and publish stages are timed in CPU cycles, and the
+    // two cores' counters are not synchronized. Wi-Fi runs on core 0
+    xTaskCreatePinnedToCore(mqtt_publisher_task, "mqtt_pub", 6144, NULL, 4, &s_publisher_task,
+                            HUB_PUBLISHER_CORE);
+
     // Initialize Thread stack and register receive callback
     ESP_ERROR_CHECK(thread_init());
+    ESP_ERROR_CHECK(thread_cmd_init(on_cmd_done, NULL));
     thread_register_receive_cb(thread_receive_callback);
 
     // Initialize MQTT over TLS & register event handler
@@ -125,16 +691,17 @@ void app_main(void)
     const char *client_id = "hub_esp32s3";
     ESP_ERROR_CHECK(mqtt_init(mqtt_uri, client_id));
     mqtt_register_event_handler(mqtt_event_handler);
+#if HUB_STATS_ENABLE
+    mqtt_set_publish_hook(hub_stats_publish_sent);
+#endif
 
     // Subscribe to control topic for all nodes
     mqtt_subscribe("home/control/#", 1);
+    mqtt_subscribe(HUB_RULES_TOPIC, 1);
+    mqtt_subscribe(HUB_GROUPS_TOPIC, 1);
+    mqtt_subscribe(HUB_HISTORY_QUERY_TOPIC, 1);
 
-    // Main loop: poll Thread and yield to MQTT
-    while (true) {
-        // Process any pending Thread events
-        thread_process();
-
-        // Allow FreeRTOS to schedule MQTT tasks
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
+    // Thread events are handled on the OpenThread mainloop task, which
+    // only wakes when radio or tasklet work is pending
+    ESP_ERROR_CHECK(thread_start_mainloop());
 }
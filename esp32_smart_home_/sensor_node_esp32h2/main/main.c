@@ -2,124 +2,348 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#include <sys/time.h>
 #include "thread_utils.h"
 #include "sensor_utils.h"
-#include "actuator_utils.h" // Для compute_crc8
+#include "report_sched.h"
+#include "crc_utils.h"
+#include "frame_codec.h"
+#include "fx_filter.h"
 #include "esp_log.h"
-#include "cJSON.h"
+#include "binlog.h"
 
 static const char *TAG = "sensor_node";
 
-#define WINDOW_SIZE 5  // Розмір вікна для ковзного середнього
+/*
+ * Фільтри аналогових каналів (цілочисельні, H2 не має FPU): медіана
+ * з 3 відкидає поодинокі викиди, далі згладжування під характер каналу.
+ * Освітленість не фільтрується зовсім (і медіаною теж, вона затримала б
+ * крок на період опитування) - увімкнене світло має з'явитись одразу
+ */
+#define SENSOR_FILTERED_CH  (SENSOR_CH_LIGHT + 1)
+
+static const fx_chain_cfg_t s_filter_cfg[SENSOR_FILTERED_CH] = {
+    [SENSOR_CH_TEMPERATURE] = { .median = 3, .smooth = FX_SMOOTH_MA, .ma_window = 5 },
+    [SENSOR_CH_HUMIDITY]    = { .median = 3, .smooth = FX_SMOOTH_EMA, .ema_alpha = FX_Q16(0.5) },
+    [SENSOR_CH_CO2]         = { .median = 3, .smooth = FX_SMOOTH_KALMAN, .kalman_q = 25, .kalman_r = 400 },
+    [SENSOR_CH_TVOC]        = { .median = 3, .smooth = FX_SMOOTH_EMA, .ema_alpha = FX_Q16(0.25) },
+    [SENSOR_CH_LIGHT]       = { .median = 0, .smooth = FX_SMOOTH_NONE },
+};
 
-// Структура для зберігання останніх вимірів (ковзне середнє)
+/*
+ * Період опитування, зона нечутливості та heartbeat для кожного каналу.
+ * Рух і витік додатково надсилаються одразу за перериванням GPIO
+ */
+static const report_channel_cfg_t s_report_cfg[SENSOR_CH_COUNT] = {
+    [SENSOR_CH_TEMPERATURE] = { .sample_period_ms = 10000, .deadband = 10,  .heartbeat_ms = 300000 }, // 0.1 °C
+    [SENSOR_CH_HUMIDITY]    = { .sample_period_ms = 10000, .deadband = 100, .heartbeat_ms = 300000 }, // 1 %
+    [SENSOR_CH_CO2]         = { .sample_period_ms = 30000, .deadband = 50,  .heartbeat_ms = 300000 }, // ppm
+    [SENSOR_CH_TVOC]        = { .sample_period_ms = 30000, .deadband = 25,  .heartbeat_ms = 300000 }, // ppb
+    [SENSOR_CH_LIGHT]       = { .sample_period_ms = 10000, .deadband = 20,  .heartbeat_ms = 300000 }, // lx
+    [SENSOR_CH_MOTION]      = { .sample_period_ms = 60000, .deadband = 0,   .heartbeat_ms = 300000 },
+    [SENSOR_CH_LEAK]        = { .sample_period_ms = 60000, .deadband = 0,   .heartbeat_ms = 300000 },
+};
+
+#define EVENT_CHANNELS (SENSOR_VALID_MOTION | SENSOR_VALID_LEAK)
+
+/*
+ * Режим енергозбереження (menuconfig → «Вузол-датчик»):
+ *   без сну         - радіо слухає постійно, sensor_task чекає подій;
+ *   SED (типово)    - те саме, але радіо вимкнене між опитуваннями
+ *                     батьківського вузла; тривога йде за мілісекунди;
+ *   deep sleep      - після кожного звіту deep sleep, пробудження за
+ *                     таймером (наступне опитування) або від PIR/витоку
+ *
+ * Ціна deep sleep: подія руху чи витоку доходить до хаба лише після
+ * завантаження і повторного приєднання до Thread (сотні мс - до
+ * SENSOR_ATTACH_TIMEOUT_MS), а не за мілісекунди
+ */
+#if CONFIG_SENSOR_POWER_DEEP_SLEEP
+#define SENSOR_SLEEP_DEEP           1
+#else
+#define SENSOR_SLEEP_DEEP           0
+#endif
+#define SENSOR_SLEEPY               (CONFIG_SENSOR_POWER_SED || CONFIG_SENSOR_POWER_DEEP_SLEEP)
+#define SENSOR_RETRY_MS             CONFIG_SENSOR_RETRY_MS  // повтор відкладеного звіту
+#define SENSOR_POLL_PERIOD_MS       3000   // опитування батьківського вузла (SED)
+#define SENSOR_ATTACH_TIMEOUT_MS    5000   // очікування приєднання після пробудження
+#define SENSOR_TX_GRACE_MS          100    // час на відправку кадру перед сном
+#define SENSOR_RTC_MAGIC            0x53454E33
+
+/*
+ * Стан, що переживає deep sleep: фільтри каналів, планувальник
+ * звітів, останні значення, канали, які не вдалося надіслати,
+ * та лічильник кадрів
+ */
+typedef struct {
+    uint32_t       magic;
+    fx_chain_t     filters[SENSOR_FILTERED_CH];
+    report_sched_t sched;
+    int32_t        values[SENSOR_CH_COUNT];
+    uint32_t       unsent;
+    uint8_t        seq;
+    uint32_t       wake_count;
+} sensor_rtc_state_t;
+
+static RTC_DATA_ATTR sensor_rtc_state_t s_rtc;
+
+/*
+ * Часові мітки шляху «пробудження → відправка» (esp_timer, мкс від старту)
+ */
 typedef struct {
-    float buffer[WINDOW_SIZE];
-    int index;
-    int count;
-    float sum;
-} moving_avg_t;
+    int64_t start_us;       // вхід у app_main
+    int64_t attached_us;    // вузол приєднано до мережі Thread
+    int64_t sampled_us;     // датчики опитано
+    int64_t sent_us;        // кадр передано стеку
+} wake_timing_t;
+
+static wake_timing_t s_timing;
+static TaskHandle_t s_sensor_task;
+static uint64_t s_ext_addr;     // ідентичність вузла для хаба
+
+/*
+ * Монотонний час у мс, що не скидається deep sleep (RTC)
+ */
+static int64_t now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/*
+ * Переривання PIR/витоку: будимо sensor_task, передаючи маску каналу
+ */
+static void sensor_event_isr(uint32_t channels, void *arg) {
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(s_sensor_task, channels, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/*
+ * Формує кадр телеметрії з каналів report і надсилає його хабу
+ */
+static void send_report(uint8_t seq, const int32_t values[SENSOR_CH_COUNT], uint32_t report) {
+    // Розширена адреса в кожному кадрі: RLOC16 змінюється при повторному
+    // приєднанні, а хаб веде стан вузла за постійним ключем
+    telemetry_frame_t frame = { .seq = seq };
+    if (s_ext_addr) {
+        frame.fields |= TELEMETRY_F_NODE;
+        frame.node = s_ext_addr;
+    }
+    if (report & SENSOR_VALID_TEMPERATURE) {
+        frame.fields |= TELEMETRY_F_TEMPERATURE;
+        frame.temperature = (int16_t)values[SENSOR_CH_TEMPERATURE];
+    }
+    if (report & SENSOR_VALID_HUMIDITY) {
+        frame.fields |= TELEMETRY_F_HUMIDITY;
+        frame.humidity = (uint16_t)values[SENSOR_CH_HUMIDITY];
+    }
+    if (report & SENSOR_VALID_CO2) {
+        frame.fields |= TELEMETRY_F_CO2;
+        frame.co2 = (uint16_t)values[SENSOR_CH_CO2];
+    }
+    if (report & SENSOR_VALID_TVOC) {
+        frame.fields |= TELEMETRY_F_TVOC;
+        frame.tvoc = (uint16_t)values[SENSOR_CH_TVOC];
+    }
+    if (report & SENSOR_VALID_LIGHT) {
+        frame.fields |= TELEMETRY_F_LIGHT;
+        frame.light = (uint16_t)values[SENSOR_CH_LIGHT];
+    }
+    if (report & EVENT_CHANNELS) {
+        frame.fields |= TELEMETRY_F_FLAGS;
+        frame.flags = (values[SENSOR_CH_MOTION] ? TELEMETRY_FLAG_MOTION : 0)
+                    | (values[SENSOR_CH_LEAK] ? TELEMETRY_FLAG_LEAK : 0);
+    }
+
+    uint8_t send_buf[TELEMETRY_MAX_LEN + 1];
+    size_t len = telemetry_encode(&frame, send_buf, sizeof(send_buf) - 1);
+    if (len > 0) {
+        // Додаємо CRC до кінця і відправляємо через Thread до хаба (ID 0)
+        send_buf[len] = compute_crc8(send_buf, len);
+        thread_send(send_buf, len + 1, 0x00);
+        BINLOG_I(TAG, "Відправлено кадр #%u, канали 0x%02X, %u байт", frame.seq, report, len + 1);
+    }
+}
 
 /*
- * Ініціалізація структури ковзного середнього
+ * Один цикл: опитування каналів, для яких настав час (або які позначені
+ * у events), і відправка змінених значень. Увесь стан - у s_rtc
  */
-static void moving_avg_init(moving_avg_t *ma) {
-    for (int i = 0; i < WINDOW_SIZE; i++) {
-        ma->buffer[i] = 0.0f;
+static void sensor_cycle(uint32_t events) {
+    int64_t now = now_ms();
+    uint32_t due = report_sched_due(&s_rtc.sched, now) | (events & EVENT_CHANNELS)
+                 | s_rtc.unsent;
+    if (!due) {
+        return;
+    }
+
+    // 1. Опитуємо лише потрібні датчики
+    sensor_snapshot_t snap;
+    sensor_read_channels(&snap, due);
+    uint32_t sampled = snap.valid;
+    s_timing.sampled_us = esp_timer_get_time();
+
+    // 2. Знімок уже в одиницях кадру (соті частки для T/H); аналогові
+    //    канали проходять через свої фільтри
+    int32_t raw[SENSOR_FILTERED_CH] = {
+        [SENSOR_CH_TEMPERATURE] = snap.temperature,
+        [SENSOR_CH_HUMIDITY]    = snap.humidity,
+        [SENSOR_CH_CO2]         = snap.co2,
+        [SENSOR_CH_TVOC]        = snap.tvoc,
+        [SENSOR_CH_LIGHT]       = snap.light,
+    };
+    int32_t *values = s_rtc.values;
+    for (int ch = 0; ch < SENSOR_FILTERED_CH; ch++) {
+        if (sampled & (1u << ch)) {
+            values[ch] = fx_chain_update(&s_rtc.filters[ch], raw[ch]);
+        }
+    }
+    if (sampled & SENSOR_VALID_MOTION)   values[SENSOR_CH_MOTION] = snap.motion;
+    if (sampled & SENSOR_VALID_LEAK)     values[SENSOR_CH_LEAK] = snap.leak;
+
+    // 3. Надсилаємо лише те, що змінилося або чий heartbeat вичерпано
+    uint32_t report = report_sched_evaluate(&s_rtc.sched, now, values, sampled);
+    if (report & EVENT_CHANNELS) {
+        report |= sampled & EVENT_CHANNELS;  // рух і витік ідуть одним байтом
+    }
+    s_rtc.unsent &= ~sampled;
+    if (report && !thread_is_attached()) {
+        // Кадр загубився б: канали не позначаємо надісланими, а
+        // опитуємо знову в наступному циклі
+        s_rtc.unsent |= report;
+        ESP_LOGW(TAG, "Немає приєднання, звіт 0x%02lx відкладено", (unsigned long)report);
+        return;
+    }
+    if (report) {
+        send_report(s_rtc.seq++, values, report);
+        report_sched_mark_sent(&s_rtc.sched, now, values, report);
+        s_timing.sent_us = esp_timer_get_time();
     }
-    ma->index = 0;
-    ma->count = 0;
-    ma->sum = 0.0f;
 }
 
 /*
- * Оновлення ковзного середнього:
- * new_val: нове значення; повертає усереднене
+ * Час до наступного циклу: за планувальником, але поки є відкладені
+ * канали (зокрема тривога), не довше SENSOR_RETRY_MS
  */
-static float moving_avg_update(moving_avg_t *ma, float new_val) {
-    if (ma->count < WINDOW_SIZE) {
-        ma->buffer[ma->index] = new_val;
-        ma->sum += new_val;
-        ma->count++;
-    } else {
-        ma->sum -= ma->buffer[ma->index];
-        ma->buffer[ma->index] = new_val;
-        ma->sum += new_val;
-    }
-    ma->index = (ma->index + 1) % WINDOW_SIZE;
-    return ma->sum / ma->count;
+static uint32_t sensor_next_ms(void) {
+    uint32_t ms = report_sched_next_ms(&s_rtc.sched, now_ms());
+    return s_rtc.unsent && ms > SENSOR_RETRY_MS ? SENSOR_RETRY_MS : ms;
 }
 
 /*
- * Завдання для читання даних із датчиків і відправки їх у Thread
+ * Переводить пробудження від PIR/витоку у маску каналів
+ */
+static uint32_t wakeup_events(void) {
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1) {
+        return 0;
+    }
+    uint64_t pins = esp_sleep_get_ext1_wakeup_status();
+    uint32_t events = 0;
+    if (pins & (1ULL << SENSOR_PIR_GPIO))  events |= SENSOR_VALID_MOTION;
+    if (pins & (1ULL << SENSOR_LEAK_GPIO)) events |= SENSOR_VALID_LEAK;
+    return events;
+}
+
+/*
+ * Налаштовує джерела пробудження і переходить у deep sleep
+ */
+static void sensor_deep_sleep(void) {
+    uint32_t sleep_ms = sensor_next_ms();
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_ms * 1000);
+
+    // Пробудження за високим рівнем лише на входах, що зараз неактивні;
+    // зняття тривоги помітить наступне опитування за таймером, а
+    // невідправлену активну тривогу - повтор через SENSOR_RETRY_MS
+    uint64_t wake_pins = 0;
+    if (!read_motion()) wake_pins |= 1ULL << SENSOR_PIR_GPIO;
+    if (!read_leak())   wake_pins |= 1ULL << SENSOR_LEAK_GPIO;
+    if (wake_pins) {
+        esp_sleep_enable_ext1_wakeup(wake_pins, ESP_EXT1_WAKEUP_ANY_HIGH);
+    }
+
+    int64_t end_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Пробудження #%lu: приєднання %lld мкс, опитування %lld мкс, "
+             "відправка %lld мкс, активно %lld мкс; сон %lu мс",
+             (unsigned long)s_rtc.wake_count,
+             (long long)(s_timing.attached_us - s_timing.start_us),
+             (long long)(s_timing.sampled_us - s_timing.start_us),
+             (long long)(s_timing.sent_us ? s_timing.sent_us - s_timing.start_us : 0),
+             (long long)(end_us - s_timing.start_us), (unsigned long)sleep_ms);
+    // Відкладені записи в RAM не переживуть deep sleep
+    binlog_flush();
+    esp_deep_sleep_start();
+}
+
+/*
+ * Завдання для читання даних із датчиків і відправки їх у Thread:
+ * кожен канал опитується за власним періодом, а надсилаються лише
+ * змінені значення (або за heartbeat); рух і витік - одразу за подією
  */
 void sensor_task(void *pvParameters) {
-    moving_avg_t temp_avg;
-    moving_avg_init(&temp_avg);
+    // Холодний старт: скидаємо стан, що зберігається у RTC-пам'яті
+    if (s_rtc.magic != SENSOR_RTC_MAGIC) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        for (int ch = 0; ch < SENSOR_FILTERED_CH; ch++) {
+            fx_chain_init(&s_rtc.filters[ch], &s_filter_cfg[ch]);
+        }
+        report_sched_init(&s_rtc.sched, s_report_cfg, now_ms());
+        s_rtc.magic = SENSOR_RTC_MAGIC;
+    }
+    s_rtc.wake_count++;
 
     // Ініціалізуємо I2C для сенсорів
     if (sensor_i2c_init() != ESP_OK) {
         ESP_LOGE(TAG, "Помилка ініціалізації I2C для сенсорів");
         vTaskDelete(NULL);
     }
+    // Входи PIR і витоку з перериваннями
+    if (sensor_gpio_init(sensor_event_isr, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Переривання PIR/витоку недоступні, лише опитування");
+    }
 
+#if SENSOR_SLEEP_DEEP
+    // Датчики опитуються, поки вузол приєднується до мережі
+    uint32_t events = wakeup_events();
+    int64_t attach_deadline = esp_timer_get_time() + SENSOR_ATTACH_TIMEOUT_MS * 1000LL;
+    while (!thread_is_attached() && esp_timer_get_time() < attach_deadline) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    s_timing.attached_us = esp_timer_get_time();
+    sensor_cycle(events);
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_TX_GRACE_MS));
+    sensor_deep_sleep();
+#else
     while (1) {
-        // 1. Зчитуємо температуру та вологість (ковзне середнє для температури)
-        float raw_temp = read_temperature();
-        float avg_temp = moving_avg_update(&temp_avg, raw_temp);
-        float humidity = read_humidity();
-
-        // 2. Зчитуємо CO2 та TVOC (CCS811)
-        uint16_t co2 = read_co2();
-
-        // 3. Зчитуємо освітленість (BH1750)
-        uint16_t light = read_light();
-
-        // 4. Зчитуємо PIR-датчик руху 
-        bool motion = read_motion();
-
-        // 5. Зчитуємо датчик витоку води (GPIO)
-        bool leak = read_leak();
-
-        // 6. Формуємо JSON
-        cJSON *root = cJSON_CreateObject();
-        cJSON_AddNumberToObject(root, "temperature", avg_temp);
-        cJSON_AddNumberToObject(root, "humidity", humidity);
-        cJSON_AddNumberToObject(root, "co2", co2);
-        cJSON_AddNumberToObject(root, "light", light);
-        cJSON_AddBoolToObject(root, "motion", motion);
-        cJSON_AddBoolToObject(root, "leak", leak);
-        char *json_str = cJSON_PrintUnformatted(root);
-        cJSON_Delete(root);
-
-        if (json_str) {
-            size_t len = strlen(json_str);
-            // 7. Додаємо CRC до кінця
-            uint8_t send_buf[512];
-            memcpy(send_buf, json_str, len);
-            uint8_t crc = compute_crc8(send_buf, len);
-            send_buf[len] = crc;
-            size_t total_len = len + 1;
-
-            // 8. Відправляємо через Thread до хаба (ID 0)
-            thread_send(send_buf, total_len, 0x00);
-            ESP_LOGI(TAG, "Відправлено: %s", json_str);
-            cJSON_free(json_str);
-        }
-
-        // 9. Затримка 10 секунд, Deep-Sleep
-        vTaskDelay(pdMS_TO_TICKS(10000));
+        // Чекаємо наступного опитування або події від GPIO
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(sensor_next_ms()));
+        sensor_cycle(events);
     }
+#endif
 
     vTaskDelete(NULL);
 }
 
 void app_main(void) {
+    s_timing.start_us = esp_timer_get_time();
     ESP_LOGI(TAG, "Запуск вузла-датчика (ESP32-H2)");
+    // Логи гарячого шляху друкує окреме завдання з низьким пріоритетом
+    binlog_start();
 
     // Ініціалізуємо Thread-стек
     thread_init();
+    s_ext_addr = thread_get_ext_addr();
+#if SENSOR_SLEEPY
+    thread_set_sleepy(SENSOR_POLL_PERIOD_MS);
+#endif
 
     // Запускаємо завдання сенсора
-    xTaskCreate(sensor_task, "sensor_task", 8192, NULL, 5, NULL);
+    xTaskCreate(sensor_task, "sensor_task", 8192, NULL, 5, &s_sensor_task);
+
+    // Обробка подій Thread у власному завданні, без опитування
+    thread_start_mainloop();
 }